@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+#include "bench_util.h"
+#include "block_cache.h"
+#include "hasher.h"
+
+namespace
+{
+    constexpr size_t kFileSize = 16 << 20;
+}
+
+static void BM_BlockCacheHit(benchmark::State& state)
+{
+    size_t block_size = static_cast<size_t>(state.range(0));
+    BenchDir dir("cache_hit");
+    boost::filesystem::path file = dir.Path() / "data";
+    WriteFile(file, RandomBytes(kFileSize, 2));
+    
+    BlockCache cache(block_size, std::make_unique<Hasher>(HashType::CRC32));
+    cache.GetBlockHash(file, 0);
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.GetBlockHash(file, 0));
+    }
+}
+
+static void BM_BlockCacheMiss(benchmark::State& state)
+{
+    size_t block_size = static_cast<size_t>(state.range(0));
+    auto type = static_cast<HashType>(state.range(1));
+    BenchDir dir("cache_miss");
+    boost::filesystem::path file = dir.Path() / "data";
+    WriteFile(file, RandomBytes(kFileSize, 3));
+    
+    size_t blocks = kFileSize / block_size;
+    auto cache = std::make_unique<BlockCache>(block_size, std::make_unique<Hasher>(type));
+    size_t index = 0;
+    
+    // every block is read once per cache, the file itself stays in the page cache
+    for (auto _ : state) {
+        if (index == blocks) {
+            state.PauseTiming();
+            cache = std::make_unique<BlockCache>(block_size, std::make_unique<Hasher>(type));
+            index = 0;
+            state.ResumeTiming();
+        }
+        benchmark::DoNotOptimize(cache->GetBlockHash(file, index++));
+    }
+    
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(block_size));
+    state.SetLabel(type == HashType::CRC32 ? "crc32" : "md5");
+}
+
+BENCHMARK(BM_BlockCacheHit)->ArgName("block")->Arg(4096)->Arg(65536);
+BENCHMARK(BM_BlockCacheMiss)
+    ->ArgNames({"block", "hash"})
+    ->ArgsProduct({{4096, 65536}, {static_cast<int64_t>(HashType::CRC32), static_cast<int64_t>(HashType::MD5)}});
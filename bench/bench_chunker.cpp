@@ -0,0 +1,28 @@
+#include <benchmark/benchmark.h>
+#include "bench_util.h"
+#include "chunker.h"
+
+static void BM_ChunkerScan(benchmark::State& state)
+{
+    Chunker chunker(static_cast<size_t>(state.range(0)));
+    std::string data = RandomBytes(16 << 20, 1);
+    auto bytes = reinterpret_cast<const uint8_t*>(data.data());
+    
+    size_t chunks = 0;
+    for (auto _ : state) {
+        size_t pos = 0;
+        while (pos < data.size()) {
+            pos += chunker.NextCut(bytes + pos, data.size() - pos);
+            ++chunks;
+        }
+        benchmark::DoNotOptimize(pos);
+    }
+    
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(data.size()));
+    state.counters["chunks"] = benchmark::Counter(static_cast<double>(chunks) / static_cast<double>(state.iterations()));
+}
+
+BENCHMARK(BM_ChunkerScan)
+    ->ArgName("average")
+    ->Arg(4096)->Arg(8192)->Arg(65536)
+    ->Unit(benchmark::kMillisecond);
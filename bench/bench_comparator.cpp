@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include "bench_util.h"
+#include "block_cache.h"
+#include "comparator.h"
+#include "hasher.h"
+
+namespace
+{
+    constexpr size_t kBlockSize = 512;
+    constexpr size_t kFileSize = 2 * kBlockSize;
+
+    // Files shared by all group sizes; identical files are created once and reused
+    class GroupFiles
+    {
+    public:
+        static GroupFiles& Instance()
+        {
+            static GroupFiles files;
+            return files;
+        }
+
+        std::vector<boost::filesystem::path> Get(size_t count, bool identical)
+        {
+            auto& paths = identical ? identical_ : distinct_;
+            std::string common = RandomBytes(kFileSize, 5);
+            
+            while (paths.size() < count) {
+                std::string data = common;
+                if (!identical) {
+                    // differ only in the last block so every file is read to the end
+                    data.back() = static_cast<char>(paths.size());
+                    data[kFileSize - 2] = static_cast<char>(paths.size() >> 8);
+                    data[kFileSize - 3] = static_cast<char>(paths.size() >> 16);
+                }
+                
+                boost::filesystem::path path = dir_.Path() / ((identical ? "same_" : "diff_") + std::to_string(paths.size()));
+                WriteFile(path, data);
+                paths.push_back(path);
+            }
+            
+            return {paths.begin(), paths.begin() + static_cast<std::ptrdiff_t>(count)};
+        }
+
+    private:
+        BenchDir dir_{"comparator"};
+        std::vector<boost::filesystem::path> identical_;
+        std::vector<boost::filesystem::path> distinct_;
+    };
+}
+
+static void BM_FindDuplicates(benchmark::State& state)
+{
+    size_t count = static_cast<size_t>(state.range(0));
+    bool identical = state.range(1) != 0;
+    
+    // a bucket keeps a descriptor per candidate open between rounds
+    if (RaiseOpenFileLimit() < count + 64) {
+        state.SkipWithError("open file limit is below the group size");
+        return;
+    }
+    
+    std::vector<boost::filesystem::path> files = GroupFiles::Instance().Get(count, identical);
+    
+    for (auto _ : state) {
+        BlockCache cache(kBlockSize, std::make_unique<Hasher>(HashType::CRC32));
+        Comparator comparator(cache);
+        benchmark::DoNotOptimize(comparator.FindDuplicates(files));
+    }
+    
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(count));
+    state.SetLabel(identical ? "identical" : "distinct");
+}
+
+BENCHMARK(BM_FindDuplicates)
+    ->ArgNames({"files", "identical"})
+    ->ArgsProduct({{2, 16, 128, 1024, 10000, 100000}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
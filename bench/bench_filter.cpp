@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cctype>
+#include "bench_util.h"
+#include "filter.h"
+
+namespace
+{
+    // Filter as it was before mask compilation: lowercase copy, then every mask in turn
+    class LoopFilter
+    {
+    public:
+        explicit LoopFilter(const std::vector<std::string>& masks)
+        {
+            for (const auto& mask : masks) {
+                masks_.push_back(ToLower(mask));
+            }
+        }
+
+        bool Match(const std::string& filename) const
+        {
+            if (masks_.empty()) {
+                return true;
+            }
+            
+            std::string name = ToLower(filename);
+            for (const auto& mask : masks_) {
+                if (MatchOne(name, mask)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        std::vector<std::string> masks_;
+
+        static std::string ToLower(std::string s)
+        {
+            std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+            return s;
+        }
+
+        static bool MatchOne(const std::string& name, const std::string& mask)
+        {
+            size_t i = 0;
+            size_t j = 0;
+            size_t star_pos = std::string::npos;
+            size_t name_pos = 0;
+            
+            while (i < name.size()) {
+                if (j < mask.size() && mask[j] == '*') {
+                    star_pos = j++;
+                    name_pos = i;
+                } else if (j < mask.size() && (mask[j] == '?' || mask[j] == name[i])) {
+                    ++i;
+                    ++j;
+                } else if (star_pos != std::string::npos) {
+                    j = star_pos + 1;
+                    i = ++name_pos;
+                } else {
+                    return false;
+                }
+            }
+            
+            while (j < mask.size() && mask[j] == '*') {
+                ++j;
+            }
+            return j == mask.size();
+        }
+    };
+
+    std::vector<std::string> MaskSet(int64_t kind)
+    {
+        switch (kind) {
+            case 0:
+                return {};
+            case 1:
+                return {"*.txt"};
+            case 2:
+                return {"*.jpg", "*.jpeg", "*.png", "*.gif", "*.bmp", "*.tiff", "*.webp", "*.heic", "*.raw", "*.cr2"};
+            case 3:
+                return {"img_??.*", "*backup*", "report-*-final.doc?", "*.tar.*"};
+            default: {
+                std::vector<std::string> masks;
+                for (int i = 0; i < 50; ++i) {
+                    masks.push_back("*.ext" + std::to_string(i));
+                }
+                return masks;
+            }
+        }
+    }
+
+    const char* MaskSetName(int64_t kind)
+    {
+        static const char* names[] = {"none", "one_extension", "ten_extensions", "wildcards", "fifty_extensions"};
+        return names[kind];
+    }
+
+    std::vector<std::string> FileNames(size_t count)
+    {
+        static const char* extensions[] = {".txt", ".JPG", ".png", ".cpp", ".tar.gz", ".doc", ".MP4", ""};
+        std::mt19937_64 rng(4);
+        std::vector<std::string> names;
+        names.reserve(count);
+        
+        for (size_t i = 0; i < count; ++i) {
+            names.push_back("File_" + std::to_string(rng() % 100000) + extensions[rng() % 8]);
+        }
+        
+        return names;
+    }
+}
+
+static void BM_FilterMatch(benchmark::State& state)
+{
+    Filter filter(MaskSet(state.range(0)));
+    std::vector<std::string> names = FileNames(4096);
+    size_t i = 0;
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter.Match(names[i++ & 4095]));
+    }
+    
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetLabel(MaskSetName(state.range(0)));
+}
+
+static void BM_FilterMatchLoop(benchmark::State& state)
+{
+    LoopFilter filter(MaskSet(state.range(0)));
+    std::vector<std::string> names = FileNames(4096);
+    size_t i = 0;
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(filter.Match(names[i++ & 4095]));
+    }
+    
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetLabel(MaskSetName(state.range(0)));
+}
+
+BENCHMARK(BM_FilterMatch)->ArgName("masks")->DenseRange(0, 4);
+BENCHMARK(BM_FilterMatchLoop)->ArgName("masks")->DenseRange(0, 4);
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "bench_util.h"
+#include "hasher.h"
+
+static void BM_HashBlock(benchmark::State& state)
+{
+    auto type = static_cast<HashType>(state.range(0));
+    size_t size = static_cast<size_t>(state.range(1));
+    
+    Hasher hasher(type);
+    std::string data = RandomBytes(size, 1);
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hasher.HashBlock(data.data(), data.size()));
+    }
+    
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size));
+    state.SetLabel(type == HashType::CRC32 ? "crc32" : type == HashType::MD5 ? "md5" : "sha256tree");
+}
+
+BENCHMARK(BM_HashBlock)
+    ->ArgNames({"hash", "block"})
+    ->ArgsProduct({{static_cast<int64_t>(HashType::CRC32), static_cast<int64_t>(HashType::MD5),
+                    static_cast<int64_t>(HashType::SHA256Tree)},
+                   {512, 4096, 65536, 1 << 20}});
+
+static void BM_HashBlocks(benchmark::State& state)
+{
+    size_t size = static_cast<size_t>(state.range(0));
+    
+    Hasher hasher(HashType::MD5);
+    std::vector<std::string> data;
+    std::vector<BlockView> views;
+    for (size_t i = 0; i < Hasher::kLanes; ++i) {
+        data.push_back(RandomBytes(size, i + 1));
+    }
+    for (const auto& block : data) {
+        views.push_back({block.data(), block.size()});
+    }
+    std::vector<std::string> digests(views.size());
+    
+    for (auto _ : state) {
+        hasher.HashBlocks(views.data(), views.size(), digests.data());
+        benchmark::DoNotOptimize(digests.data());
+    }
+    
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size * views.size()));
+    state.SetLabel("md5 x" + std::to_string(views.size()));
+}
+
+BENCHMARK(BM_HashBlocks)
+    ->ArgNames({"block"})
+    ->Arg(512)->Arg(4096)->Arg(65536)->Arg(1 << 20);
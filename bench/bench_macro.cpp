@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include "bench_util.h"
+#include "block_cache.h"
+#include "duplicate_finder.h"
+#include "hasher.h"
+#include "scanner.h"
+#include "tree_generator.h"
+
+namespace
+{
+    // Tree of `count` files from TreeGenerator, the same for every run of the suite
+    class MacroTree
+    {
+    public:
+        explicit MacroTree(size_t count) : dir_("macro_" + std::to_string(count))
+        {
+            TreeSpec spec;
+            spec.files = count;
+            spec.depth = 2;
+            spec.fanout = 4;
+            spec.sizes = SizeDistribution::Parse("uniform:1K:64K");
+            spec.duplicate_ratio = 0.3;
+            spec.near_duplicate_ratio = 0.1;
+            TreeGenerator(spec).Generate(dir_.Path());
+            
+            config_.include_dirs.push_back(dir_.Path());
+            config_.depth = 8;
+        }
+
+        const Config& GetConfig() const { return config_; }
+
+    private:
+        BenchDir dir_;
+        Config config_;
+    };
+}
+
+static void BM_Scan(benchmark::State& state)
+{
+    MacroTree tree(static_cast<size_t>(state.range(0)));
+    
+    for (auto _ : state) {
+        Scanner scanner(tree.GetConfig());
+        benchmark::DoNotOptimize(scanner.Scan());
+    }
+    
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+static void BM_ScanAndFind(benchmark::State& state)
+{
+    MacroTree tree(static_cast<size_t>(state.range(0)));
+    RaiseOpenFileLimit();
+    
+    for (auto _ : state) {
+        Scanner scanner(tree.GetConfig());
+        auto groups = scanner.Scan();
+        
+        DuplicateFinder finder(std::make_unique<BlockCache>(4096, std::make_unique<Hasher>(HashType::CRC32)));
+        benchmark::DoNotOptimize(finder.Find(groups));
+    }
+    
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_Scan)->ArgName("files")->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ScanAndFind)->ArgName("files")->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
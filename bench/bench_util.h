@@ -0,0 +1,73 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+// Scratch directory under the system temp dir, removed with the object
+class BenchDir
+{
+public:
+    explicit BenchDir(const std::string& name)
+        : path_(boost::filesystem::temp_directory_path() / ("bayan_bench_" + name))
+    {
+        boost::filesystem::remove_all(path_);
+        boost::filesystem::create_directories(path_);
+    }
+
+    ~BenchDir()
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(path_, ec);
+    }
+
+    BenchDir(const BenchDir&) = delete;
+    BenchDir& operator=(const BenchDir&) = delete;
+
+    const boost::filesystem::path& Path() const { return path_; }
+
+private:
+    boost::filesystem::path path_;
+};
+
+inline std::string RandomBytes(size_t size, uint64_t seed)
+{
+    std::mt19937_64 rng(seed);
+    std::string data(size, '\0');
+    
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        uint64_t value = rng();
+        for (size_t j = 0; j < sizeof(uint64_t) && i + j < size; ++j) {
+            data[i + j] = static_cast<char>(value >> (j * 8));
+        }
+    }
+    
+    return data;
+}
+
+inline void WriteFile(const boost::filesystem::path& path, const std::string& data)
+{
+    std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+// Raises the soft open file limit as far as the hard limit allows, returns the result
+inline size_t RaiseOpenFileLimit()
+{
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return 0;
+    }
+    
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    
+    return static_cast<size_t>(limit.rlim_cur);
+}
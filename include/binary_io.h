@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Little-endian helpers shared by the on-disk formats (reference index, shard partials).
+
+template <typename T>
+void PutInteger(std::string& out, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out += static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+    }
+}
+
+class BinaryReader
+{
+public:
+    // name is used in error messages only
+    BinaryReader(const std::string& data, std::string name) : data_(data), name_(std::move(name)) {}
+
+    template <typename T>
+    T Get()
+    {
+        Need(sizeof(T));
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data_[pos_ + i])) << (8 * i);
+        }
+        pos_ += sizeof(T);
+        return static_cast<T>(value);
+    }
+
+    std::string Bytes(size_t size)
+    {
+        Need(size);
+        std::string bytes = data_.substr(pos_, size);
+        pos_ += size;
+        return bytes;
+    }
+
+private:
+    const std::string& data_;
+    std::string name_;
+    size_t pos_ = 0;
+
+    void Need(size_t size) const
+    {
+        if (data_.size() - pos_ < size) {
+            throw std::runtime_error(name_ + " is truncated");
+        }
+    }
+};
@@ -4,20 +4,25 @@
 #include <unordered_map>         
 #include <vector>                
 #include <string>                
-#include <fstream>               
 #include <memory>  
+#include <functional>
+#include <sys/types.h>
+#include "config.h"
+#include "extent_map.h"
 #include "path_hash.h"              
 
 class Hasher;
+class WorkerPool;
 
+// a block of a file the cache has given an id, the path itself is stored once per file
 struct BlockKey
 {
-    boost::filesystem::path path;   
+    uint32_t file;   
     size_t index;       
 
     bool operator==(const BlockKey& other) const
     {
-        return path == other.path && index == other.index;
+        return file == other.file && index == other.index;
     }
 };
 
@@ -25,35 +30,91 @@ struct BlockKeyHash
 {
     std::size_t operator()(const BlockKey& k) const
     {
-        return std::hash<std::string>()(k.path.string()) ^ (std::hash<size_t>()(k.index) << 1);
+        return std::hash<uint64_t>()((static_cast<uint64_t>(k.file) << 32) ^ k.index);
     }
 };
 
 struct FileHandle
 {
-    std::unique_ptr<std::ifstream> stream;           
+    int fd = -1;
+    bool direct = false;
+    dev_t device = 0;
+    uintmax_t size = 0;
     
-    FileHandle(const boost::filesystem::path& p)
-    {
-        stream = std::make_unique<std::ifstream>(p.string(), std::ios::binary);
-    }
+    FileHandle(const boost::filesystem::path& p, IoMode mode);
+    ~FileHandle();
+
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
 };
 
 class BlockCache
 {
 public:
-    BlockCache(size_t block_size, std::unique_ptr<Hasher> hasher);
+    using DigestObserver = std::function<void(const boost::filesystem::path&, size_t, const std::string&)>;
+
+    static constexpr size_t kDirectIoAlignment = 4096;
+
+    BlockCache(size_t block_size, std::unique_ptr<Hasher> hasher, const IoOptions& io = IoOptions{});
     ~BlockCache();
     std::string GetBlockHash(const boost::filesystem::path& file, size_t block_index);
     size_t GetBlockCount(const boost::filesystem::path& file);
+    std::string GetFileDigest(const boost::filesystem::path& file);
+    std::string GetExtentSignature(const boost::filesystem::path& file);
+    void LoadBlocks(const std::vector<boost::filesystem::path>& files, size_t block_index);
+    void Prefetch(const boost::filesystem::path& file, size_t first_block, size_t count);
+    void Release(const boost::filesystem::path& file);
+    // releases the file and drops its block digests, for files that turned out unique
+    void Forget(const boost::filesystem::path& file);
+    // forgets files whose size or mtime differ from when their block count was taken, so the
+    // digests can be reused by a later search over the same files
+    void DropChanged();
+    void Clear();
+    // estimated bytes held by cached digests and file entries
+    size_t MemoryUsage() const;
+    // a digest known from an earlier run, served as a hit instead of reading the block
+    void SeedDigest(const boost::filesystem::path& file, size_t block_index, std::string digest);
+    // called for every block hashed from now on
+    void SetDigestObserver(DigestObserver observer);
 
 private:
+    struct CachedFile
+    {
+        static constexpr size_t kUnknown = SIZE_MAX;
+        
+        uint32_t id;
+        size_t blocks = kUnknown;
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+        // one past the highest block index with a digest in hash_cache_
+        size_t hashed = 0;
+        // block read by LoadBlocks and not yet asked for, its first lookup is the miss
+        size_t loaded = kUnknown;
+    };
+
     size_t block_size_;  
+    IoOptions io_;
     std::unique_ptr<Hasher> hasher_;  
     std::unordered_map<BlockKey, std::string, BlockKeyHash> hash_cache_; 
-    std::unordered_map<boost::filesystem::path, size_t, PathHash> file_block_count_;
+    std::unordered_map<boost::filesystem::path, CachedFile, PathHash> files_;
+    uint32_t next_file_id_ = 0;
+    size_t path_bytes_ = 0;
     std::unordered_map<boost::filesystem::path, std::shared_ptr<FileHandle>, PathHash> open_files_;
+    std::unordered_map<boost::filesystem::path, std::vector<Extent>, PathHash> extents_;
+    std::unordered_map<dev_t, bool> rotational_;
+    // read workers of every device, kept across LoadBlocks rounds
+    std::unordered_map<dev_t, std::unique_ptr<WorkerPool>> pools_;
+    DigestObserver observer_;
     
+    CachedFile& Cached(const boost::filesystem::path& file);
+    void StoreDigest(CachedFile& cached, size_t index, std::string digest);
     std::string ReadAndHashBlock(const boost::filesystem::path& file, size_t index);
+    std::string HashBlockAt(FileHandle& handle, size_t index);
+    size_t ReadBlock(FileHandle& handle, size_t index, char* buffer);
     std::shared_ptr<FileHandle> GetFileHandle(const boost::filesystem::path& file);
+    bool IsRotational(dev_t device);
+    WorkerPool& DevicePool(dev_t device);
+    bool UsePhysicalOrder(const FileHandle& handle);
+    const std::vector<Extent>& GetExtents(const boost::filesystem::path& file, const FileHandle& handle);
+    uint64_t ReadOrder(const boost::filesystem::path& file, const FileHandle& handle, size_t index);
 };
\ No newline at end of file
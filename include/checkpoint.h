@@ -0,0 +1,110 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "block_cache.h"
+#include "config.h"
+#include "size_table.h"
+
+// Append-only journal of a run: the scanned size table, every block digest as it is
+// hashed and every size group once it is resolved. Records are queued by the pipeline
+// and written by a background thread that syncs the file every interval, so a crash
+// loses at most the last interval and the pipeline never waits for the disk.
+//
+// On resume the journal is replayed, files are re-validated by size, nanosecond mtime and
+// inode, as BlockCache does, and everything that depends on a changed or missing file is
+// dropped: its digests and the resolved groups of its old and new size. A resolved group
+// is only reused for the same member files it was compared with. The remaining state is
+// compacted into a fresh journal that the new run continues.
+//
+// File format: "BAYC" magic, uint32 version, uint64 block size, uint8 hash type, then
+// records: uint8 type, uint32 payload length, payload, uint32 CRC-32 of the payload.
+// A truncated or corrupted tail is ignored. Integers are little-endian.
+class Checkpoint
+{
+public:
+    using Groups = std::vector<std::vector<boost::filesystem::path>>;
+
+    static constexpr uint32_t kVersion = 2;
+    static constexpr std::chrono::milliseconds kDefaultInterval{5000};
+
+    // resume replays an existing journal, otherwise the file is started over
+    Checkpoint(const boost::filesystem::path& file, const Config& config, bool resume,
+               std::chrono::milliseconds interval = kDefaultInterval);
+    ~Checkpoint();
+
+    bool HasScan() const;
+    // the recorded table, re-validated against the file system
+    SizeTable RestoreScan(bool drop_singletons);
+    void RecordScan(const SizeTable& table);
+
+    // preloads the digests that survived validation and records new ones from now on
+    void Attach(BlockCache& cache);
+    // the duplicates recorded for a size group of exactly these files, in any order
+    bool Resolved(uintmax_t size, const std::vector<boost::filesystem::path>& files, Groups& groups) const;
+    void RecordGroup(uintmax_t size, const std::vector<boost::filesystem::path>& files, const Groups& groups);
+    void RecordDigest(const boost::filesystem::path& file, size_t block_index, const std::string& digest);
+
+    // writes and syncs everything queued so far
+    void Flush();
+
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+private:
+    struct ScanEntry
+    {
+        uintmax_t size;
+        // nanoseconds
+        int64_t mtime;
+        uint64_t inode;
+        boost::filesystem::path file;
+    };
+
+    struct ResolvedGroup
+    {
+        // sorted
+        std::vector<boost::filesystem::path> files;
+        Groups groups;
+    };
+
+    boost::filesystem::path file_;
+    uint64_t block_size_;
+    uint8_t hash_type_;
+    std::chrono::milliseconds interval_;
+
+    bool scanned_ = false;
+    std::vector<ScanEntry> scan_;
+    std::map<uintmax_t, ResolvedGroup> resolved_;
+    std::unordered_map<std::string, std::vector<std::pair<size_t, std::string>>> digests_;
+
+    int fd_ = -1;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::string pending_;
+    bool flush_requested_ = false;
+    bool stopping_ = false;
+    uint64_t written_ = 0;
+    uint64_t queued_ = 0;
+    std::condition_variable flushed_;
+    std::thread writer_;
+
+    void Load();
+    void Start(const std::string& contents);
+    std::string Header() const;
+    static void AppendRecord(std::string& out, uint8_t type, const std::string& payload);
+    static std::string ScanRecord(const std::vector<ScanEntry>& entries);
+    static std::string GroupRecord(uintmax_t size, const ResolvedGroup& resolved);
+    static std::string DigestRecord(const std::string& file, size_t block_index, const std::string& digest);
+    void Queue(std::string record);
+    void WriterLoop();
+};
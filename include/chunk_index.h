@@ -0,0 +1,63 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "chunker.h"
+
+struct ChunkSimilarity
+{
+    boost::filesystem::path first;
+    boost::filesystem::path second;
+    uintmax_t shared_bytes;
+    double percent;
+};
+
+struct ChunkReport
+{
+    size_t files = 0;
+    uintmax_t total_bytes = 0;
+    uintmax_t unique_bytes = 0;
+    size_t chunks = 0;
+    size_t unique_chunks = 0;
+    std::vector<ChunkSimilarity> similar;
+
+    uintmax_t SavedBytes() const { return total_bytes - unique_bytes; }
+};
+
+// Splits every file into content-defined chunks and indexes them by digest. Pairs of
+// files are scored by the bytes of distinct chunks they share relative to the larger
+// file; the savings estimate is what storing every distinct chunk once would save.
+class ChunkIndex
+{
+public:
+    // chunks found in more files than this (zero runs, headers) count for the savings
+    // estimate but not for pair scores, otherwise pairs grow quadratically
+    static constexpr size_t kMaxPostings = 64;
+
+    ChunkIndex(size_t average_chunk, size_t threads);
+    ChunkReport Analyze(const std::vector<boost::filesystem::path>& files, double min_percent);
+
+private:
+    // raw MD5 of a chunk, a hex string would take three times the memory per chunk
+    using ChunkDigest = std::array<uint64_t, 2>;
+
+    struct ChunkDigestHash
+    {
+        size_t operator()(const ChunkDigest& d) const { return static_cast<size_t>(d[0]); }
+    };
+
+    struct Chunk
+    {
+        ChunkDigest digest;
+        uint32_t size;
+    };
+
+    using FileChunks = std::vector<Chunk>;
+
+    Chunker chunker_;
+    size_t threads_;
+
+    FileChunks ChunkFile(const boost::filesystem::path& file) const;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// FastCDC content-defined chunking with a Gear rolling hash. Cut points depend only on
+// the last 64 bytes before them, so content shifted by an insertion produces the same
+// chunks after the edit. Normalized chunking: below the average size a stricter mask
+// is used, above it a looser one, which keeps chunk sizes close to the average.
+class Chunker
+{
+public:
+    static constexpr size_t kDefaultAverage = 8192;
+    static constexpr size_t kReadSize = 1 << 20;
+
+    explicit Chunker(size_t average = kDefaultAverage);
+
+    // length of the chunk starting at data, at most size and at most MaxSize()
+    size_t NextCut(const uint8_t* data, size_t size) const;
+    // streams the file and calls on_chunk for every chunk in order, throws on I/O errors
+    void ChunkFile(const boost::filesystem::path& file, const std::function<void(const uint8_t*, size_t)>& on_chunk) const;
+
+    size_t MinSize() const { return min_size_; }
+    size_t AverageSize() const { return average_; }
+    size_t MaxSize() const { return max_size_; }
+
+private:
+    size_t average_;
+    size_t min_size_;
+    size_t max_size_;
+    uint64_t mask_small_;
+    uint64_t mask_large_;
+
+    static const std::array<uint64_t, 256>& GearTable();
+};
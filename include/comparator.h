@@ -1,6 +1,7 @@
 #pragma once
 
 #include <boost/filesystem.hpp>  
+#include <functional>
 #include <vector>                
 #include <string>               
 #include "block_cache.h"
@@ -8,11 +9,29 @@
 class Comparator
 {
 public:
-    explicit Comparator(BlockCache& cache);
+    static constexpr size_t kDefaultPrefetchBlocks = 4;
+
+    explicit Comparator(BlockCache& cache, size_t prefetch_blocks = kDefaultPrefetchBlocks);
     bool Equals(const boost::filesystem::path& a, const boost::filesystem::path& b);   
     std::vector<std::vector<boost::filesystem::path>> FindDuplicates(const std::vector<boost::filesystem::path>& files);
+    const std::vector<std::vector<boost::filesystem::path>>& SharedGroups() const;
+    void ClearSharedGroups();
+    // estimated bytes held by the shared groups
+    size_t MemoryUsage() const;
+    // checked before every read round, a true result abandons the group with no duplicates
+    void SetStopCondition(std::function<bool()> stop);
+    bool Interrupted() const;
 
 private:
     BlockCache& cache_;
+    size_t prefetch_blocks_;
+    std::vector<std::vector<boost::filesystem::path>> shared_groups_;
+    size_t shared_bytes_ = 0;
+    std::function<bool()> stop_;
+    bool interrupted_ = false;
     
-};
\ No newline at end of file
+    std::vector<size_t> MergeSharedExtents(const std::vector<size_t>& bucket, const std::vector<boost::filesystem::path>& files, std::vector<std::vector<size_t>>& aliases);
+    std::vector<std::vector<size_t>> SplitByBlock(const std::vector<size_t>& bucket, const std::vector<boost::filesystem::path>& files, size_t block_index);
+    void LoadRound(const std::vector<std::vector<size_t>>& buckets, const std::vector<boost::filesystem::path>& files, const std::vector<size_t>& block_counts, size_t block_index);
+    void PrefetchRound(const std::vector<std::vector<size_t>>& buckets, const std::vector<boost::filesystem::path>& files, size_t block_index);
+};
@@ -8,7 +8,60 @@
 enum class HashType
 {
     CRC32,  
-    MD5     
+    MD5,
+    SHA256Tree
+};
+
+enum class IoMode
+{
+    Buffered,
+    Direct
+};
+
+enum class IoSchedule
+{
+    Auto,
+    Path,
+    Physical
+};
+
+enum class DedupAction
+{
+    None,
+    Hardlink,
+    Reflink,
+    Dedupe,
+    Delete
+};
+
+enum class OutputFormat
+{
+    Text,
+    Json,
+    JsonLines,
+    Binary
+};
+
+enum class StatsFormat
+{
+    None,
+    Text,
+    Json
+};
+
+enum class AnalysisMode
+{
+    Exact,
+    Chunks,
+    Similar
+};
+
+struct IoOptions
+{
+    IoMode mode = IoMode::Buffered;
+    IoSchedule schedule = IoSchedule::Auto;
+    size_t ssd_threads = 8;
+    size_t hdd_threads = 1;
 };
 
 struct Config
@@ -20,6 +73,28 @@ struct Config
     std::vector<std::string> masks;
     size_t block_size = 4096;
     HashType hash_type = HashType::CRC32;
+    IoOptions io;
+    size_t prefetch_blocks = 4;
+    DedupAction action = DedupAction::None;
+    bool dry_run = false;
+    bool verify = true;
+    OutputFormat format = OutputFormat::Text;
+    bool digests = false;
+    StatsFormat stats = StatsFormat::None;
+    std::string trace_file;
+    bool progress = false;
+    std::string progress_file;
+    bool dirs = false;
+    AnalysisMode mode = AnalysisMode::Exact;
+    size_t chunk_size = 8192;
+    double similarity = 50.0;
+    std::string build_index;
+    std::string reference_index;
+    std::string partial;
+    std::string work;
+    std::vector<std::string> merge;
+    std::string checkpoint;
+    bool resume = false;
     
     bool Validate() const
     {
@@ -31,6 +106,23 @@ struct Config
             return false;
         }
         
+        if (io.ssd_threads == 0 || io.hdd_threads == 0) {
+            return false;
+        }
+        
+        // sha256tree file digests are tree roots only for blocks of 1 KiB times a power of two
+        if (hash_type == HashType::SHA256Tree && (block_size % 1024 != 0 || ((block_size / 1024) & (block_size / 1024 - 1)) != 0)) {
+            return false;
+        }
+        
+        if (mode != AnalysisMode::Exact && (chunk_size < 64 || (chunk_size & (chunk_size - 1)) != 0)) {
+            return false;
+        }
+        
+        if (similarity < 0 || similarity > 100) {
+            return false;
+        }
+        
         return true;
     }
 };
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "config.h"
+
+struct DedupReport
+{
+    size_t replaced = 0;
+    size_t failed = 0;
+    uintmax_t bytes = 0;
+};
+
+// Applies an action to confirmed duplicate groups. The first file of a group is kept,
+// the others are replaced by a hard link or reflink to it, deduplicated in place by the
+// kernel (FIDEDUPERANGE) or deleted. With verify, a file is only replaced or deleted after
+// a byte-for-byte comparison with the kept one, so a hash collision cannot lose data.
+class Deduplicator
+{
+public:
+    static constexpr size_t kDefaultThreads = 4;
+
+    Deduplicator(DedupAction action, bool dry_run, bool verify = true, size_t threads = kDefaultThreads);
+    DedupReport Apply(const std::vector<std::vector<boost::filesystem::path>>& groups);
+
+private:
+    DedupAction action_;
+    bool dry_run_;
+    bool verify_;
+    size_t threads_;
+    std::mutex output_mutex_;
+
+    void ApplyGroup(const std::vector<boost::filesystem::path>& group, DedupReport& report);
+    void ApplyOne(const boost::filesystem::path& source, const boost::filesystem::path& target);
+    void Log(const std::string& line);
+
+    static void Hardlink(const boost::filesystem::path& source, const boost::filesystem::path& target);
+    static void Reflink(const boost::filesystem::path& source, const boost::filesystem::path& target);
+    static void DedupeRange(const boost::filesystem::path& source, const boost::filesystem::path& target);
+    static bool SameContent(const boost::filesystem::path& source, const boost::filesystem::path& target);
+    static boost::filesystem::path TempName(const boost::filesystem::path& target);
+    static std::string ActionName(DedupAction action);
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <sys/types.h>
+
+// Reads /sys/dev/block/<major>:<minor>/queue/rotational, partitions are resolved to their disk.
+// Devices without a sysfs entry (tmpfs, overlay, network filesystems) are reported as non-rotational.
+bool IsRotationalDevice(dev_t device);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "size_table.h"
+
+struct DirectoryGroups
+{
+    // identical subtrees, one entry per maximal match; paths end with a separator
+    std::vector<std::vector<boost::filesystem::path>> directories;
+    std::vector<uintmax_t> directory_sizes;
+    // file groups without the copies that live inside a reported duplicate directory
+    std::vector<std::vector<boost::filesystem::path>> files;
+};
+
+// Finds identical directory trees by a Merkle digest over (name, content) of every scanned
+// child. A file's content identity is its duplicate group, whose members the comparator has
+// already proven identical, so no file is read again; a file without duplicates makes its
+// directory and all ancestors unique. Only scanned files count: files filtered out by size or
+// mask do not affect the result.
+class DirectoryMatcher
+{
+public:
+    explicit DirectoryMatcher(const std::vector<boost::filesystem::path>& roots);
+    DirectoryGroups Match(const SizeTable& table, const std::vector<std::vector<boost::filesystem::path>>& duplicates);
+
+private:
+    struct Node
+    {
+        boost::filesystem::path path;
+        size_t parent;
+        size_t depth;
+        std::vector<std::string> entries;
+        uintmax_t bytes = 0;
+        bool unique = false;
+        std::string digest;
+    };
+
+    static constexpr size_t kNoParent = static_cast<size_t>(-1);
+
+    std::vector<std::string> roots_;
+    std::vector<Node> nodes_;
+    std::unordered_map<std::string, size_t> node_by_path_;
+
+    size_t GetNode(const boost::filesystem::path& directory);
+    bool IsRoot(const boost::filesystem::path& directory) const;
+    void ComputeDigests();
+};
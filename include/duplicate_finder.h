@@ -1,19 +1,43 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <map>                
 #include <string>             
 #include <vector>             
 #include "comparator.h"
+#include "size_table.h"
+
+class Checkpoint;
 
 class DuplicateFinder {
 public:
-    explicit DuplicateFinder(std::unique_ptr<BlockCache> cache);  
+    // receives every duplicate group as soon as its size group is resolved, false stops the search
+    using GroupSink = std::function<bool(std::vector<boost::filesystem::path>&&)>;
+
+    explicit DuplicateFinder(std::unique_ptr<BlockCache> cache, size_t prefetch_blocks = Comparator::kDefaultPrefetchBlocks);  
     std::vector<std::vector<boost::filesystem::path>> Find(const std::map<uintmax_t, std::vector<boost::filesystem::path>>& groups);
+    std::vector<std::vector<boost::filesystem::path>> Find(const SizeTable& table);
+    // false if the sink or the stop condition ended the search early
+    bool Find(const SizeTable& table, const GroupSink& sink);
+    const std::vector<std::vector<boost::filesystem::path>>& SharedGroups() const;
+    void ClearSharedGroups();
+    std::string Digest(const boost::filesystem::path& file);
+    // groups resolved in the checkpoint are taken from it, new ones and their digests are recorded
+    void SetCheckpoint(Checkpoint* checkpoint);
+    // polled between size groups and read rounds, true abandons the search
+    void SetStopCondition(std::function<bool()> stop);
+    BlockCache& Cache();
+    // estimated bytes held by the block cache and the shared groups
+    size_t MemoryUsage() const;
     
 private:
     std::unique_ptr<BlockCache> cache_;        
     std::unique_ptr<Comparator> comparator_;
+    Checkpoint* checkpoint_ = nullptr;
+    std::function<bool()> stop_;
+    
+    void FindInGroup(uintmax_t size, const std::vector<boost::filesystem::path>& files, std::vector<std::vector<boost::filesystem::path>>& result);
     
     DuplicateFinder(const DuplicateFinder&) = delete;
     DuplicateFinder& operator=(const DuplicateFinder&) = delete;   
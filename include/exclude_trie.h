@@ -0,0 +1,35 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Exclude directories normalized once into a trie of path components. The scanner keeps
+// a cursor per directory and moves it one component down per entry, so an exclusion
+// check costs one child lookup instead of absolute()/lexically_normal() per exclude.
+class ExcludeTrie
+{
+public:
+    // cursor below which no exclude can match any more
+    static constexpr size_t kOutside = static_cast<size_t>(-1);
+
+    explicit ExcludeTrie(const std::vector<boost::filesystem::path>& excludes);
+
+    size_t Start(const boost::filesystem::path& directory) const;
+    size_t Descend(size_t cursor, std::string_view component) const;
+    bool Excluded(size_t cursor) const;
+
+private:
+    struct Node
+    {
+        std::vector<std::pair<std::string, size_t>> children;
+        bool excluded = false;
+    };
+
+    std::vector<Node> nodes_;
+
+    static boost::filesystem::path Normalize(const boost::filesystem::path& path);
+};
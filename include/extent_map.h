@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+struct Extent
+{
+    uint64_t logical;
+    uint64_t physical;
+    uint64_t length;
+    uint32_t flags;
+};
+
+// Returns the physical layout of an open file via FIEMAP, empty if the filesystem does not support it
+std::vector<Extent> ReadExtents(int fd);
+
+// Physical byte offset backing a logical offset, UINT64_MAX when it is not mapped
+uint64_t PhysicalOffset(const std::vector<Extent>& extents, uint64_t logical);
+
+// Identity of a file's physical layout. Two files of one device with equal signatures read
+// the same blocks, so their contents are equal. Empty when the layout is not stable enough
+// to prove that (delayed allocation, inline or tail-packed data, compressed extents).
+std::string ExtentSignature(dev_t device, uint64_t size, const std::vector<Extent>& extents);
@@ -1,17 +1,38 @@
 #pragma once
 
 #include <string>     
+#include <string_view>
+#include <unordered_set>
 #include <vector>     
 
+// Masks are compiled once: exact names, "*literal" suffixes (the usual "*.ext") and
+// "literal*" prefixes go to hash sets, only the remaining masks run the wildcard matcher.
 class Filter
 {
 public:
     explicit Filter(const std::vector<std::string>& masks);
-    bool Match(const std::string& filename) const;
+    Filter(const Filter& other);
+    Filter(Filter&&) = default;
+    Filter& operator=(const Filter& other);
+    Filter& operator=(Filter&&) = default;
+
+    bool Match(std::string_view filename) const;
 
 private:
+    static constexpr size_t kMaxStackName = 256;
+
     std::vector<std::string> masks_; 
+    bool match_all_ = false;
+    std::unordered_set<std::string_view> exact_;
+    std::unordered_set<std::string_view> suffixes_;
+    std::unordered_set<std::string_view> prefixes_;
+    std::vector<size_t> suffix_lengths_;
+    std::vector<size_t> prefix_lengths_;
+    std::vector<std::string_view> wildcards_;
     
-    static bool MatchOne(const std::string& name, const std::string& mask);   
+    void Compile();
+    bool MatchLower(std::string_view name) const;
+    static bool MatchOne(std::string_view name, std::string_view mask);   
     static std::string ToLower(const std::string& s);
-};
\ No newline at end of file
+    static void ToLower(std::string_view s, char* out);
+};
@@ -1,20 +1,50 @@
 #pragma once
 
 #include <cstdint>     
+#include <memory>
+#include <mutex>
 #include <string>      
 #include <vector>      
 #include "config.h"     
 
+class WorkerPool;
+
+struct BlockView
+{
+    const char* data;
+    size_t size;
+};
+
 class Hasher
 {
 public:
-    explicit Hasher(HashType hash_type);   
+    // MD5 blocks hashed at once, one per SIMD lane
+    static constexpr size_t kLanes = 8;
+
+    // threads only split blocks of at least TreeHash::kParallelMin bytes for SHA256Tree, on
+    // the calling thread and a pool of threads - 1 kept for the hasher's lifetime; a block
+    // that comes while another one has the pool is hashed on the calling thread alone
+    explicit Hasher(HashType hash_type, size_t threads = 1);   
+    ~Hasher();
     std::string HashBlock(const char* data, size_t size);
+    // digests[i] = HashBlock(blocks[i]), MD5 batches run as kLanes independent streams.
+    // threads is what the batch may use, callers pass the threads their reads leave idle;
+    // SHA256Tree blocks are hashed one after another, each on up to that many
+    void HashBlocks(const BlockView* blocks, size_t count, std::string* digests, size_t threads = 1);
+    // whole-file digest from the block digests in order: SHA256Tree joins them as subtrees,
+    // which is the tree root of the file's bytes when every block but the last is a
+    // power-of-two multiple of TreeHash::kChunkSize and the last holds just the file's tail;
+    // the others hash their concatenation
+    std::string HashDigests(const std::vector<std::string>& digests);
 
 private:
     HashType hash_type_; 
+    size_t threads_;
+    std::unique_ptr<WorkerPool> tree_pool_;
+    std::mutex tree_mutex_;
 
     std::string HashBlockCrc32(const char* data, size_t size);
     std::string HashBlockMd5(const char* data, size_t size);
+    std::string HashBlockTree(const char* data, size_t size, size_t threads);
     static std::string BytesToHex(const uint8_t* data, size_t size);
 };
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "chunker.h"
+
+struct SimilarPair
+{
+    boost::filesystem::path first;
+    boost::filesystem::path second;
+    double percent;
+};
+
+struct SimilarityReport
+{
+    size_t files = 0;
+    size_t candidates = 0;
+    // files with equal signatures, reported once per set instead of as all of their pairs;
+    // pairs in similar name the first file of a set for all of it
+    std::vector<std::vector<boost::filesystem::path>> copies;
+    std::vector<SimilarPair> similar;
+};
+
+// Near-duplicate search without comparing all pairs. Every file becomes the set of its
+// content-defined chunks, summarized by a MinHash signature; signatures are cut into
+// LSH bands and only files sharing a band bucket are compared, by the share of equal
+// signature slots, which estimates the Jaccard similarity of the chunk sets. Files with
+// equal signatures are banded once, so exact copies do not fill the buckets.
+class MinHashIndex
+{
+public:
+    using Signature = std::vector<uint64_t>;
+
+    static constexpr size_t kDefaultPermutations = 128;
+    // larger band buckets are skipped, their pairs would grow quadratically
+    static constexpr size_t kMaxBucket = 64;
+
+    MinHashIndex(size_t average_chunk, size_t threads, size_t permutations = kDefaultPermutations);
+    SimilarityReport Find(const std::vector<boost::filesystem::path>& files, double min_percent);
+
+    // empty signature for an empty set
+    Signature Sign(const std::vector<uint64_t>& chunk_hashes) const;
+    static double Similarity(const Signature& a, const Signature& b);
+    // {bands, rows} so that pairs at the threshold become candidates with probability >= 0.95
+    static std::pair<size_t, size_t> ChooseBands(size_t permutations, double threshold);
+
+private:
+    Chunker chunker_;
+    size_t threads_;
+    std::vector<uint64_t> seeds_;
+
+    Signature SignFile(const boost::filesystem::path& file) const;
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+class WorkerPool;
+
+// Runs body(i) for i in [0, count) on up to threads workers that take indexes in order.
+void ParallelFor(size_t count, size_t threads, const std::function<void(size_t)>& body);
+// The same on the calling thread and up to threads - 1 of the pool's, no thread is started
+void ParallelFor(size_t count, size_t threads, const std::function<void(size_t)>& body, WorkerPool& pool);
@@ -10,4 +10,10 @@ public:
 
 private:
     static HashType ParseHashType(const std::string& str);
+    static IoMode ParseIoMode(const std::string& str);
+    static IoSchedule ParseIoSchedule(const std::string& str);
+    static DedupAction ParseDedupAction(const std::string& str);
+    static OutputFormat ParseOutputFormat(const std::string& str);
+    static StatsFormat ParseStatsFormat(const std::string& str);
+    static AnalysisMode ParseAnalysisMode(const std::string& str);
 };
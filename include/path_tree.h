@@ -0,0 +1,40 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Paths stored as a tree of directory nodes: every node keeps its parent id and its name
+// in one shared string arena, so a directory's path is stored once for all of its files.
+// Full paths are rebuilt only when asked for. A top-level node may hold a whole path.
+class PathTree
+{
+public:
+    static constexpr uint32_t kRoot = UINT32_MAX;
+
+    uint32_t Add(uint32_t parent, std::string_view name);
+
+    boost::filesystem::path Path(uint32_t node) const;
+    std::string String(uint32_t node) const;
+    uint32_t Parent(uint32_t node) const;
+    std::string_view Name(uint32_t node) const;
+    size_t Size() const;
+    void ShrinkToFit();
+    size_t MemoryUsage() const;
+
+    // copies node and its missing ancestors from other, remap[other id] holds the ids in this tree
+    uint32_t Copy(const PathTree& other, uint32_t node, std::vector<uint32_t>& remap);
+
+private:
+    struct Node
+    {
+        uint32_t parent;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    std::vector<Node> nodes_;
+    std::string names_;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct ProgressSnapshot
+{
+    uint64_t entries = 0;
+    uint64_t candidate_bytes = 0;
+    uint64_t bytes_hashed = 0;
+    uint64_t bytes_skipped = 0;
+    uint64_t groups_total = 0;
+    uint64_t groups_resolved = 0;
+};
+
+// One set of live counters. Updates are relaxed atomic additions.
+struct ProgressCounters
+{
+    std::atomic<uint64_t> entries{0};
+    std::atomic<uint64_t> candidate_bytes{0};
+    std::atomic<uint64_t> bytes_hashed{0};
+    std::atomic<uint64_t> bytes_skipped{0};
+    std::atomic<uint64_t> groups_total{0};
+    std::atomic<uint64_t> groups_resolved{0};
+
+    ProgressSnapshot Snapshot() const;
+    void Reset();
+};
+
+// Live counters shared by the pipeline threads, all formatting happens on the reporter's
+// ticker thread. A thread adds to the process-wide counters unless it is attached to the
+// counters of a run; threads started by the pipeline inherit the attachment, so concurrent
+// runs in one process count only their own work.
+class Progress
+{
+public:
+    static void AddEntries(uint64_t n) { Current().entries.fetch_add(n, std::memory_order_relaxed); }
+    static void AddCandidateBytes(uint64_t n) { Current().candidate_bytes.fetch_add(n, std::memory_order_relaxed); }
+    static void AddBytesHashed(uint64_t n) { Current().bytes_hashed.fetch_add(n, std::memory_order_relaxed); }
+    static void AddBytesSkipped(uint64_t n) { Current().bytes_skipped.fetch_add(n, std::memory_order_relaxed); }
+    static void AddGroups(uint64_t n) { Current().groups_total.fetch_add(n, std::memory_order_relaxed); }
+    static void AddGroupsResolved(uint64_t n) { Current().groups_resolved.fetch_add(n, std::memory_order_relaxed); }
+
+    // of the counters the calling thread adds to
+    static ProgressSnapshot Snapshot();
+    static void Reset();
+
+    static ProgressCounters& Current() { return current_ ? *current_ : global_; }
+    // nullptr returns the calling thread to the process-wide counters
+    static void Attach(ProgressCounters* counters) { current_ = counters; }
+
+private:
+    static ProgressCounters global_;
+    static thread_local ProgressCounters* current_;
+};
+
+// Attaches the calling thread to counters for its lifetime and restores the previous ones
+class ScopedProgress
+{
+public:
+    explicit ScopedProgress(ProgressCounters& counters) : previous_(&Progress::Current()) { Progress::Attach(&counters); }
+    ~ScopedProgress() { Progress::Attach(previous_); }
+
+    ScopedProgress(const ScopedProgress&) = delete;
+    ScopedProgress& operator=(const ScopedProgress&) = delete;
+
+private:
+    ProgressCounters* previous_;
+};
+
+// Prints a status line to stderr and/or rewrites a JSON status file once per interval
+class ProgressReporter
+{
+public:
+    static constexpr std::chrono::milliseconds kDefaultInterval{1000};
+
+    ProgressReporter(bool to_stderr, std::string status_file, std::chrono::milliseconds interval = kDefaultInterval);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    static std::string FormatLine(const ProgressSnapshot& now, const ProgressSnapshot& previous, double interval_seconds);
+    static std::string FormatJson(const ProgressSnapshot& now, const ProgressSnapshot& previous, double interval_seconds);
+
+private:
+    bool to_stderr_;
+    bool tty_;
+    std::string status_file_;
+    std::chrono::milliseconds interval_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread ticker_;
+
+    void Run();
+    void Report(const ProgressSnapshot& now, const ProgressSnapshot& previous, double interval_seconds, bool final);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "size_table.h"
+
+struct ReferenceReport
+{
+    size_t files = 0;
+    size_t candidates = 0;
+    uintmax_t bytes_hashed = 0;
+    uintmax_t bytes_skipped = 0;
+    // each group is a scanned file followed by the indexed files with the same content
+    std::vector<std::vector<boost::filesystem::path>> matches;
+};
+
+// Persistent content index of a reference tree: size, MD5 of every file and MD5 of its
+// prefixes at 64 KiB, 1 MiB, 16 MiB and so on. A query reads only files whose size is in
+// the index and stops as soon as a prefix digest matches no indexed file of that size.
+//
+// File format: "BAYI" magic, uint32 version, uint64 entry count, then entries sorted by
+// size: uint64 size, uint32 length + path, uint8 prefix count, prefix digests, digest.
+// Digests are 16 raw bytes, integers are little-endian.
+class ReferenceIndex
+{
+public:
+    using Digest = std::array<uint8_t, 16>;
+
+    struct Entry
+    {
+        uintmax_t size;
+        boost::filesystem::path file;
+        std::vector<Digest> prefixes;
+        Digest digest;
+    };
+
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uintmax_t kFirstPrefix = 64 << 10;
+    static constexpr uintmax_t kPrefixGrowth = 16;
+    static constexpr size_t kReadSize = 1 << 20;
+
+    static ReferenceIndex Build(const SizeTable& table, size_t threads);
+    static ReferenceIndex Load(const boost::filesystem::path& file);
+    void Save(const boost::filesystem::path& file) const;
+
+    ReferenceReport Query(const SizeTable& table, size_t threads) const;
+    // indexed files with the same content, reads as little of the file as it can
+    std::vector<boost::filesystem::path> Find(const boost::filesystem::path& file, uintmax_t size, uintmax_t* bytes_read = nullptr) const;
+
+    const std::vector<Entry>& Entries() const;
+    // offsets below size at which prefix digests are taken
+    static std::vector<uintmax_t> PrefixOffsets(uintmax_t size);
+    // prefix digests followed by the whole-file digest
+    static size_t Levels(uintmax_t size);
+    // the first levels of them, reading only as far as the last requested prefix
+    static std::vector<Digest> ProgressiveDigests(const boost::filesystem::path& file, uintmax_t size, size_t levels);
+
+private:
+    std::vector<Entry> entries_;
+
+    // calls on_prefix for every prefix offset, stops early once it returns false
+    static bool HashFile(const boost::filesystem::path& file, uintmax_t size,
+                         const std::function<bool(size_t, const Digest&)>& on_prefix, Digest& digest, uintmax_t& bytes_read);
+};
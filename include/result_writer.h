@@ -0,0 +1,64 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "config.h"
+
+// Writes duplicate groups through one large buffer straight to a file descriptor.
+//
+// text   - quoted paths, groups separated by a blank line (the classic bayan output)
+// json   - one array of group objects
+// jsonl  - one group object per line
+// binary - "BAYN" magic and uint32 version, then per group: uint64 size, uint32 count,
+//          uint64 wasted bytes, uint16 digest length + digest, count x (uint32 length + path);
+//          a group with count 0 ends the stream. Integers are little-endian.
+//
+// JSON strings are UTF-8. Paths are bytes on Linux: a byte that is not part of a well-formed
+// UTF-8 sequence is written as \u00XX, the Latin-1 character of the same value.
+//
+// Pairs and groups of similar files (--mode chunks and similar) use the same buffer in text,
+// json and jsonl; they have no binary form.
+class ResultWriter
+{
+public:
+    static constexpr size_t kDefaultBufferSize = 1 << 20;
+    static constexpr uint32_t kBinaryVersion = 1;
+
+    explicit ResultWriter(OutputFormat format, int fd = 1, size_t buffer_size = kDefaultBufferSize);
+    ~ResultWriter();
+
+    void WriteGroup(uintmax_t size, const std::vector<boost::filesystem::path>& files, const std::string& digest = {});
+    void WritePair(double percent, const boost::filesystem::path& first, const boost::filesystem::path& second);
+    void WritePair(double percent, uintmax_t shared_bytes, const boost::filesystem::path& first, const boost::filesystem::path& second);
+    // files that are all similar to each other by percent
+    void WriteSimilarGroup(double percent, const std::vector<boost::filesystem::path>& files);
+    // text printed by Finish when nothing was written
+    void SetEmptyText(std::string text);
+    void Finish();
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+private:
+    OutputFormat format_;
+    int fd_;
+    size_t buffer_size_;
+    std::string buffer_;
+    size_t groups_ = 0;
+    bool finished_ = false;
+    std::string empty_text_ = "No duplicate files found.\n";
+
+    void WriteText(const std::vector<boost::filesystem::path>& files);
+    void WriteJson(uintmax_t size, const std::vector<boost::filesystem::path>& files, const std::string& digest);
+    void WriteBinary(uintmax_t size, const std::vector<boost::filesystem::path>& files, const std::string& digest);
+    void AppendSimilar(double percent, const uintmax_t* shared_bytes, const boost::filesystem::path* files, size_t count);
+
+    void AppendQuoted(const std::string& s);
+    void AppendJsonString(const std::string& s);
+    template <typename T>
+    void AppendInteger(T value);
+    void MaybeFlush();
+    void Flush();
+};
@@ -1,24 +1,29 @@
 #pragma once
 
 #include "config.h"
+#include "exclude_trie.h"
 #include "filter.h"
 #include <boost/filesystem.hpp>
+#include <functional>
 #include <map>
 #include <vector>
-#include <unordered_set>
-#include "path_hash.h" 
+#include "size_table.h"
 class Scanner
 {
 public:
     explicit Scanner(const Config& config);   
     std::map<uintmax_t, std::vector<boost::filesystem::path>> Scan();
+    SizeTable ScanTable(bool drop_singletons = true);
+    // polled for every directory entry, true ends the scan with what was found so far
+    void SetStopCondition(std::function<bool()> stop);
 
 private:
     const Config& config_;
     Filter filter_;
-    std::unordered_set<boost::filesystem::path, PathHash> seen_paths_;
+    ExcludeTrie excludes_;
+    std::function<bool()> stop_;
     
-    void ScanDirectory(const boost::filesystem::path& root, size_t current_depth, std::map<uintmax_t, std::vector<boost::filesystem::path>>& result);   
-    bool IsExcluded(const boost::filesystem::path& path) const;   
+    SizeTable Collect();
+    void ScanDirectory(const boost::filesystem::path& root, uint32_t node, size_t current_depth, size_t exclude_cursor, SizeTable& result);   
     bool ScanSubdirectory(size_t current_depth) const;
 };
\ No newline at end of file
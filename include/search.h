@@ -0,0 +1,130 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "progress.h"
+
+class DuplicateFinder;
+class SearchEngine;
+
+// What one search looks at and how much it may spend. Budgets of zero are unlimited.
+struct SearchOptions
+{
+    std::vector<boost::filesystem::path> include_dirs;
+    std::vector<boost::filesystem::path> exclude_dirs;
+    size_t depth = 0;
+    uintmax_t min_file_size = 1;
+    std::vector<std::string> masks;
+    // estimated bytes of the scanned file table plus the engine's block cache and shared
+    // extent groups: a table over the budget ends the search after the scan, a cache over it
+    // is emptied at the next check, also when no duplicates turn up
+    size_t memory_limit = 0;
+    // wall time of the whole search, checked while scanning and between read rounds
+    std::chrono::milliseconds time_limit{0};
+};
+
+enum class SearchStatus
+{
+    Completed,
+    Cancelled,
+    TimeLimit,
+    MemoryLimit
+};
+
+struct SearchResult
+{
+    SearchStatus status = SearchStatus::Completed;
+    size_t files = 0;
+    size_t groups = 0;
+    uint64_t bytes_hashed = 0;
+};
+
+// Cooperative cancellation: Cancel() may be called from any thread, the search stops at its
+// next check and reports SearchStatus::Cancelled.
+class CancellationToken
+{
+public:
+    void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool Cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+// A single search with its callbacks. Callbacks run on the thread calling Execute(), between
+// directories, size groups and read rounds; they may call CacheMemoryUsage() and ClearCache()
+// on the engine but not start another search on it, Execute() throws std::logic_error then.
+class SearchRun
+{
+public:
+    using GroupCallback = std::function<void(const std::vector<boost::filesystem::path>&)>;
+    using ProgressCallback = std::function<void(const ProgressSnapshot&)>;
+
+    SearchRun(SearchEngine& engine, SearchOptions options);
+
+    // every duplicate group, as soon as its size group is resolved
+    void OnGroup(GroupCallback callback);
+    // at most once per interval while the search runs, and once at its end
+    void OnProgress(ProgressCallback callback, std::chrono::milliseconds interval = ProgressReporter::kDefaultInterval);
+
+    SearchResult Execute(const CancellationToken* token = nullptr);
+
+private:
+    SearchEngine& engine_;
+    SearchOptions options_;
+    GroupCallback on_group_;
+    ProgressCallback on_progress_;
+    std::chrono::milliseconds progress_interval_ = ProgressReporter::kDefaultInterval;
+
+    ProgressCounters progress_;
+    const CancellationToken* token_ = nullptr;
+    std::chrono::steady_clock::time_point started_;
+    std::chrono::steady_clock::time_point last_progress_;
+    SearchStatus status_ = SearchStatus::Completed;
+
+    // estimated bytes of the scanned table, zero while scanning
+    size_t table_bytes_ = 0;
+
+    // the stop condition handed to the scanner and the comparator
+    bool Poll();
+    void EnforceMemoryLimit();
+};
+
+// Entry point for embedding: owns a block cache that stays warm across searches. Block size,
+// hash and I/O settings belong to the cache and are fixed for the engine's lifetime. Files
+// changed since a previous search are dropped from the cache when the next one starts.
+// Searches on one engine run one at a time; every run counts its progress on its own.
+class SearchEngine
+{
+public:
+    static constexpr int kApiVersion = 1;
+
+    explicit SearchEngine(size_t block_size = 4096, HashType hash_type = HashType::CRC32,
+                          const IoOptions& io = IoOptions{}, size_t prefetch_blocks = 4);
+    ~SearchEngine();
+
+    SearchEngine(const SearchEngine&) = delete;
+    SearchEngine& operator=(const SearchEngine&) = delete;
+
+    size_t CacheMemoryUsage();
+    void ClearCache();
+
+private:
+    friend class SearchRun;
+
+    std::unique_ptr<DuplicateFinder> finder_;
+    std::mutex mutex_;
+    // thread running a search, its callbacks use the engine without taking mutex_
+    std::atomic<std::thread::id> owner_{};
+
+    bool RunningOnThisThread() const;
+};
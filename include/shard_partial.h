@@ -0,0 +1,67 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#include "reference_index.h"
+#include "size_table.h"
+
+struct PartialEntry
+{
+    uintmax_t size;
+    std::time_t mtime;
+    // files with the same non-zero group are duplicates found inside the shard
+    uint32_t group;
+    boost::filesystem::path file;
+    // progressive digests, see ReferenceIndex::ProgressiveDigests
+    std::vector<ReferenceIndex::Digest> digests;
+};
+
+// a request to hash entry up to levels digests
+struct WorkItem
+{
+    uint32_t entry;
+    uint32_t levels;
+};
+
+struct MergeResult
+{
+    // per partial, empty everywhere once every cross-shard candidate is resolved
+    std::vector<std::vector<WorkItem>> work;
+    std::vector<std::vector<boost::filesystem::path>> duplicates;
+
+    size_t PendingFiles() const;
+};
+
+// Result of one shard of a multi-machine run. A shard scans its directories and resolves
+// its own duplicates; merging the partials finds sizes present in several shards and asks
+// each shard to hash just one file per local group of those sizes: first the 64 KiB prefix,
+// then, for candidates that still collide, the whole file.
+//
+// File format: "BAYP" magic, uint32 version, uint64 entry count, then entries sorted by
+// size: uint64 size, int64 mtime, uint32 group, uint32 length + path, uint8 digest count,
+// digests (16 raw bytes each). Integers are little-endian.
+// Work lists are text, one "levels entry path" line per file.
+class ShardPartial
+{
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    static ShardPartial FromScan(const SizeTable& table, const std::vector<std::vector<boost::filesystem::path>>& local_duplicates);
+    static ShardPartial Load(const boost::filesystem::path& file);
+    void Save(const boost::filesystem::path& file) const;
+
+    // hashes the requested entries; files changed since the scan are dropped with a warning
+    void HashWork(const std::vector<WorkItem>& work, size_t threads);
+
+    static std::vector<WorkItem> LoadWork(const boost::filesystem::path& file);
+    void SaveWork(const boost::filesystem::path& file, const std::vector<WorkItem>& work) const;
+
+    static MergeResult Merge(const std::vector<ShardPartial>& partials);
+
+    const std::vector<PartialEntry>& Entries() const;
+
+private:
+    std::vector<PartialEntry> entries_;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "path_tree.h"
+
+struct SizeRecord
+{
+    uintmax_t size;
+    uint32_t file;
+};
+
+// Flat (size, file id) table filled by the scanner. After Finalize() records are sorted by
+// size, a path listed twice (overlapping include directories) is kept once and, if asked,
+// sizes with a single file are dropped together with their paths, so the groups that reach
+// the comparator are contiguous runs of records and ids. Paths live in a PathTree and are
+// materialized on request; Finalize() also drops the names of the files it removed.
+class SizeTable
+{
+public:
+    struct Group
+    {
+        uintmax_t size;
+        size_t begin;
+        size_t end;
+    };
+
+    // a directory below parent (PathTree::kRoot for a full top-level path) to add files to
+    uint32_t AddDirectory(uint32_t parent, std::string_view name);
+    uint32_t Add(uintmax_t size, uint32_t directory, std::string_view name);
+    uint32_t Add(uintmax_t size, const boost::filesystem::path& file);
+    void Finalize(bool drop_singletons);
+    
+    std::vector<Group> Groups() const;
+    std::vector<boost::filesystem::path> GroupFiles(const Group& group) const;
+    const std::vector<SizeRecord>& Records() const;
+    boost::filesystem::path File(uint32_t id) const;
+    std::vector<boost::filesystem::path> Files() const;
+    size_t FileCount() const;
+    size_t MemoryUsage() const;
+    std::map<uintmax_t, std::vector<boost::filesystem::path>> ToMap() const;
+
+private:
+    std::vector<SizeRecord> records_;
+    std::vector<uint32_t> nodes_;
+    PathTree paths_;
+    // Add(size, path) callers usually list a directory's files together
+    std::string last_directory_;
+    uint32_t last_directory_node_ = PathTree::kRoot;
+
+    void RemoveRepeatedPaths(size_t begin, size_t end, std::vector<bool>& removed) const;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class Counter
+{
+    FilesScanned,
+    DirectoriesVisited,
+    StatCalls,
+    BlocksRead,
+    BlocksHashed,
+    BlocksSplit,
+    BytesRead,
+    CacheHits,
+    CacheMisses,
+    OpenFilesPeak,
+    Comparisons,
+    Count
+};
+
+struct PhaseTime
+{
+    std::string name;
+    double wall_seconds;
+    double cpu_seconds;
+};
+
+struct StatsSnapshot
+{
+    uint64_t counters[static_cast<size_t>(Counter::Count)] = {};
+    uint64_t size_groups = 0;
+    std::map<uint64_t, uint64_t> group_histogram;
+    std::vector<PhaseTime> phases;
+
+    uint64_t Get(Counter c) const { return counters[static_cast<size_t>(c)]; }
+};
+
+// Run-wide counters. Every thread increments its own thread-local slots with relaxed
+// stores, the slots are summed only when a snapshot is taken, so the counters are cheap
+// enough to stay enabled on the hot path.
+class Stats
+{
+public:
+    static void Add(Counter counter, uint64_t value = 1);
+    static void Peak(Counter counter, uint64_t value);
+    static void RecordSizeGroup(uint64_t files);
+    static void RecordPhase(const std::string& name, double wall_seconds, double cpu_seconds);
+    static StatsSnapshot Snapshot();
+    static void Reset();
+
+    static void PrintText(std::ostream& os, const StatsSnapshot& snapshot);
+    static void PrintJson(std::ostream& os, const StatsSnapshot& snapshot);
+    static const char* CounterName(Counter counter);
+};
+
+// Measures wall and process CPU time of a pipeline phase for Stats
+class ScopedPhase
+{
+public:
+    explicit ScopedPhase(std::string name);
+    ~ScopedPhase();
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    std::string name_;
+    std::chrono::steady_clock::time_point wall_start_;
+    double cpu_start_;
+};
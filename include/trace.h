@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Span recorder exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Every thread writes into its own fixed-size ring buffer without locks, the oldest
+// events are overwritten when a ring is full. Buffers outlive their threads and are
+// read once at the end of the run, after the workers have been joined.
+class Trace
+{
+public:
+    static constexpr size_t kRingCapacity = 1 << 16;
+
+    static void Start();
+    static void Stop();
+    static bool Enabled();
+    static uint64_t NowNs();
+    static void Record(const char* name, uint64_t start_ns, uint64_t end_ns);
+    static void WriteChromeJson(const std::string& path);
+};
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name) : name_(name), start_ns_(Trace::Enabled() ? Trace::NowNs() : 0) {}
+
+    ~TraceSpan()
+    {
+        if (start_ns_ != 0) {
+            Trace::Record(name_, start_ns_, Trace::NowNs());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_ns_;
+};
+
+#define BAYAN_TRACE_CONCAT_INNER(a, b) a##b
+#define BAYAN_TRACE_CONCAT(a, b) BAYAN_TRACE_CONCAT_INNER(a, b)
+
+// The name must be a string literal, only the pointer is stored
+#ifdef BAYAN_ENABLE_TRACE
+#define TRACE_SPAN(name) TraceSpan BAYAN_TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define TRACE_SPAN(name) ((void)0)
+#endif
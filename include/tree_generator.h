@@ -0,0 +1,77 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SizeDistribution
+{
+    enum class Kind { Fixed, Uniform, LogNormal };
+
+    Kind kind = Kind::Uniform;
+    uint64_t min = 1024;
+    uint64_t max = 1 << 20;
+    double mu = 0;
+    double sigma = 0;
+
+    // fixed:SIZE, uniform:MIN:MAX or lognormal:MU:SIGMA[:MAX]; sizes accept K, M and G suffixes
+    static SizeDistribution Parse(const std::string& spec);
+};
+
+struct TreeSpec
+{
+    size_t files = 1000;
+    size_t depth = 3;
+    size_t fanout = 4;
+    SizeDistribution sizes;
+    double duplicate_ratio = 0.3;
+    double near_duplicate_ratio = 0.1;
+    double hardlink_ratio = 0.0;
+    double sparse_ratio = 0.0;
+    uint64_t seed = 1;
+};
+
+struct GeneratedTree
+{
+    size_t directories = 0;
+    size_t files = 0;
+    size_t duplicates = 0;
+    size_t near_duplicates = 0;
+    size_t hardlinks = 0;
+    size_t sparse = 0;
+    uintmax_t bytes = 0;
+};
+
+// Builds a directory tree whose layout and contents depend only on the spec and its seed.
+// File contents are generated from a per-file seed and never read back, so duplicates,
+// near-duplicates (same size, shared prefix, different tail) and sparse files are cheap
+// to produce even for millions of files.
+class TreeGenerator
+{
+public:
+    explicit TreeGenerator(const TreeSpec& spec);
+    GeneratedTree Generate(const boost::filesystem::path& root);
+
+private:
+    struct Content
+    {
+        uint64_t seed;
+        uint64_t size;
+        uint64_t mutation;
+        bool sparse;
+    };
+
+    static constexpr size_t kChunkSize = 4096;
+
+    TreeSpec spec_;
+    uint64_t state_;
+
+    uint64_t Next();
+    double NextUnit();
+    uint64_t NextSize();
+    std::vector<boost::filesystem::path> MakeDirectories(const boost::filesystem::path& root);
+
+    static void FillChunk(const Content& content, uint64_t chunk, char* buffer);
+    static void WriteContent(const boost::filesystem::path& path, const Content& content);
+};
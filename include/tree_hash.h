@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+// Merkle tree over SHA-256, laid out like BLAKE3: the input is cut into kChunkSize chunks,
+// a leaf is SHA-256(0x00 || chunk) and a parent SHA-256(0x01 || left || right). The left
+// subtree of every node holds the largest power of two of chunks that leaves the right one
+// non-empty, so any aligned power-of-two run of chunks is a subtree of its own: runs are
+// hashed independently, on several threads, and joined with Combine to the same root.
+class TreeHash
+{
+public:
+    using Node = std::array<uint8_t, 32>;
+
+    static constexpr size_t kChunkSize = 1024;
+    // inputs below this are not worth splitting across threads
+    static constexpr size_t kParallelMin = 1 << 20;
+
+    static Node Hash(const char* data, size_t size, size_t threads = 1);
+    // runs the split on the calling thread and the pool's threads instead of new ones
+    static Node Hash(const char* data, size_t size, size_t threads, WorkerPool& pool);
+    // root of the tree whose subtrees, left to right, are nodes
+    static Node Combine(const std::vector<Node>& nodes);
+
+private:
+    static Node Split(const uint8_t* bytes, size_t size, size_t threads, WorkerPool* pool);
+    static Node Subtree(const uint8_t* data, size_t size);
+    static Node Parent(const Node& left, const Node& right);
+};
@@ -4,5 +4,16 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <functional>
+#include "chunk_index.h"
+#include "config.h"
+#include "directory_matcher.h"
+#include "min_hash.h"
 
-void PrintResults(const std::vector<std::vector<boost::filesystem::path>>& duplicates);
\ No newline at end of file
+void PrintResults(const std::vector<std::vector<boost::filesystem::path>>& duplicates);
+void WriteResults(const std::vector<std::vector<boost::filesystem::path>>& duplicates, OutputFormat format, const std::function<std::string(const boost::filesystem::path&)>& digest = {});
+void WriteResults(const DirectoryGroups& groups, OutputFormat format, const std::function<std::string(const boost::filesystem::path&)>& digest = {});
+void WriteChunkReport(const ChunkReport& report, OutputFormat format);
+void WriteSimilarityReport(const SimilarityReport& report, OutputFormat format);
+void PrintSharedGroups(const std::vector<std::vector<boost::filesystem::path>>& shared);
+void PrintStats(StatsFormat format);
\ No newline at end of file
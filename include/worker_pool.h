@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ProgressCounters;
+
+// Threads that outlive the jobs they run, so work cut into many short jobs, such as one
+// read round per block index, does not start and join threads every time. Threads are
+// started on first use, up to the pool size. One job runs at a time.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t Threads() const { return capacity_; }
+    // runs job(w) for w in [0, workers) on the pool's threads, workers <= Threads(), and
+    // returns at once; the workers add to the caller's progress counters
+    void Start(size_t workers, std::function<void(size_t)> job);
+    // returns when every worker of the started job is done, rethrows the first exception
+    // the job threw
+    void Wait();
+
+private:
+    size_t capacity_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::function<void(size_t)> job_;
+    ProgressCounters* progress_ = nullptr;
+    uint64_t generation_ = 0;
+    size_t workers_ = 0;
+    size_t remaining_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+
+    void Work(size_t index);
+};
@@ -1,10 +1,75 @@
 #include <vector>        
 #include <cstring>        
+#include <cstdlib>
+#include <cerrno>
 #include <stdexcept>      
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <exception>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "block_cache.h"
+#include "device_info.h"
 #include "hasher.h"
+#include "progress.h"
+#include "stats.h"
+#include "trace.h"
+#include "worker_pool.h"
 
-BlockCache::BlockCache(size_t block_size, std::unique_ptr<Hasher> hasher) : block_size_(block_size), hasher_(std::move(hasher))
+namespace
+{
+    struct FreeDeleter
+    {
+        void operator()(char* p) const { std::free(p); }
+    };
+
+    using BlockBuffer = std::unique_ptr<char, FreeDeleter>;
+
+    BlockBuffer AllocateBlockBuffer(size_t size)
+    {
+        const size_t alignment = BlockCache::kDirectIoAlignment;
+        size_t rounded = (size + alignment - 1) / alignment * alignment;
+        
+        char* data = static_cast<char*>(std::aligned_alloc(alignment, rounded));
+        if (!data) {
+            throw std::bad_alloc();
+        }
+        
+        std::memset(data, 0, rounded);
+        return BlockBuffer(data);
+    }
+}
+
+FileHandle::FileHandle(const boost::filesystem::path& p, IoMode mode)
+{
+    if (mode == IoMode::Direct) {
+        fd = ::open(p.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+        direct = fd >= 0;
+    }
+    
+    if (fd < 0) {
+        fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    
+    struct stat st{};
+    if (fd >= 0 && ::fstat(fd, &st) == 0) {
+        device = st.st_dev;
+        size = static_cast<uintmax_t>(st.st_size);
+    }
+}
+
+FileHandle::~FileHandle()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+BlockCache::BlockCache(size_t block_size, std::unique_ptr<Hasher> hasher, const IoOptions& io)
+    : block_size_(block_size), io_(io), hasher_(std::move(hasher))
 {
     if (!hasher_) {
         throw std::invalid_argument("HashEngine cannot be null");
@@ -12,28 +77,54 @@ BlockCache::BlockCache(size_t block_size, std::unique_ptr<Hasher> hasher) : bloc
     if (block_size_ == 0) {
         throw std::invalid_argument("Block size must be greater than 0");
     }
+    if (io_.ssd_threads == 0 || io_.hdd_threads == 0) {
+        throw std::invalid_argument("I/O thread count must be greater than 0");
+    }
 }
 
 BlockCache::~BlockCache() {}
 
-size_t BlockCache::GetBlockCount(const boost::filesystem::path& file)
+BlockCache::CachedFile& BlockCache::Cached(const boost::filesystem::path& file)
 {
-    
-    auto it = file_block_count_.find(file);
-    if (it != file_block_count_.end())
+    auto it = files_.find(file);
+    if (it != files_.end()) {
         return it->second;
-
-    try {
-        uintmax_t size = boost::filesystem::file_size(file);
-        
-        size_t count = (size + block_size_ - 1) / block_size_;
-        
-        file_block_count_[file] = count;
-        return count;
     }
-    catch (const boost::filesystem::filesystem_error& e) {
-        throw std::runtime_error("Cannot get file size: " + std::string(e.what()));
+    
+    if (next_file_id_ == UINT32_MAX) {
+        throw std::length_error("Too many files for the block cache");
     }
+    
+    CachedFile cached;
+    cached.id = next_file_id_++;
+    path_bytes_ += file.native().size();
+    return files_.emplace(file, cached).first->second;
+}
+
+void BlockCache::StoreDigest(CachedFile& cached, size_t index, std::string digest)
+{
+    hash_cache_[BlockKey{cached.id, index}] = std::move(digest);
+    cached.hashed = std::max(cached.hashed, index + 1);
+}
+
+size_t BlockCache::GetBlockCount(const boost::filesystem::path& file)
+{
+    CachedFile& cached = Cached(file);
+    if (cached.blocks != CachedFile::kUnknown)
+        return cached.blocks;
+
+    struct stat st{};
+    if (::stat(file.c_str(), &st) != 0) {
+        throw std::runtime_error("Cannot get file size: " + file.string() + ": " + std::strerror(errno));
+    }
+    
+    uintmax_t size = static_cast<uintmax_t>(st.st_size);
+    size_t count = (size + block_size_ - 1) / block_size_;
+    
+    cached.blocks = count;
+    cached.size = size;
+    cached.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return count;
 }
 
 std::shared_ptr<FileHandle> BlockCache::GetFileHandle(const boost::filesystem::path& file)
@@ -45,13 +136,20 @@ std::shared_ptr<FileHandle> BlockCache::GetFileHandle(const boost::filesystem::p
     }
     
     try {
-        auto handle = std::make_shared<FileHandle>(file);
+        // O_DIRECT needs block-aligned offsets, otherwise fall back to buffered reads
+        IoMode mode = io_.mode;
+        if (block_size_ % kDirectIoAlignment != 0) {
+            mode = IoMode::Buffered;
+        }
         
-        if (!handle->stream || !*handle->stream) {
+        auto handle = std::make_shared<FileHandle>(file, mode);
+        
+        if (handle->fd < 0) {
             throw std::runtime_error("Cannot open file: " + file.string());
         }
         
         open_files_[file] = handle;
+        Stats::Peak(Counter::OpenFilesPeak, open_files_.size());
         return handle;
     }
     catch (const std::exception& e) {
@@ -59,41 +157,404 @@ std::shared_ptr<FileHandle> BlockCache::GetFileHandle(const boost::filesystem::p
     }
 }
 
+size_t BlockCache::ReadBlock(FileHandle& handle, size_t index, char* buffer)
+{
+    TRACE_SPAN("block_read");
+    off_t offset = static_cast<off_t>(index * block_size_);
+    size_t total = 0;
+    
+    while (total < block_size_) {
+        ssize_t n = ::pread(handle.fd, buffer + total, block_size_ - total, offset + total);
+        
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // some filesystems accept O_DIRECT on open but reject the read itself
+            if (errno == EINVAL && handle.direct) {
+                ::fcntl(handle.fd, F_SETFL, ::fcntl(handle.fd, F_GETFL) & ~O_DIRECT);
+                handle.direct = false;
+                continue;
+            }
+            throw std::runtime_error("Read failed: " + std::string(std::strerror(errno)));
+        }
+        
+        total += static_cast<size_t>(n);
+        
+        if (n == 0 || handle.direct) {
+            break;
+        }
+    }
+    
+    Stats::Add(Counter::BlocksRead);
+    Stats::Add(Counter::BytesRead, total);
+    Progress::AddBytesHashed(total);
+    
+    if (io_.mode == IoMode::Direct && !handle.direct) {
+        ::posix_fadvise(handle.fd, offset, static_cast<off_t>(block_size_), POSIX_FADV_DONTNEED);
+    }
+    
+    return total;
+}
+
+std::string BlockCache::HashBlockAt(FileHandle& handle, size_t index)
+{
+    BlockBuffer buffer = AllocateBlockBuffer(block_size_);
+    size_t size = ReadBlock(handle, index, buffer.get());
+    
+    TRACE_SPAN("hash");
+    Stats::Add(Counter::BlocksHashed);
+    return hasher_->HashBlock(buffer.get(), size);
+}
+
 std::string BlockCache::ReadAndHashBlock(const boost::filesystem::path& file, size_t index)
 {
     try {
         auto handle = GetFileHandle(file);
-        auto& stream = *handle->stream;
+        return HashBlockAt(*handle, index);
+    }
+    catch (const std::exception& e) {
+        throw std::runtime_error("Error reading block from " + file.string() + ": " + e.what());
+    }
+}
+
+std::string BlockCache::GetFileDigest(const boost::filesystem::path& file)
+{
+    size_t count = GetBlockCount(file);
+    
+    std::vector<std::string> block_hashes;
+    for (size_t i = 0; i < count; ++i) {
+        block_hashes.push_back(GetBlockHash(file, i));
+    }
+    
+    return hasher_->HashDigests(block_hashes);
+}
+
+void BlockCache::Prefetch(const boost::filesystem::path& file, size_t first_block, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    
+    try {
+        auto handle = GetFileHandle(file);
         
-        std::streampos pos = static_cast<std::streampos>(index * block_size_);
+        // page cache hints are meaningless for O_DIRECT reads
+        if (handle->direct) {
+            return;
+        }
         
-        stream.seekg(pos);
+        ::posix_fadvise(handle->fd,
+                        static_cast<off_t>(first_block * block_size_),
+                        static_cast<off_t>(count * block_size_),
+                        POSIX_FADV_WILLNEED);
+    }
+    catch (const std::exception&) {
+        // a failed hint is not an error, the read itself will report it
+    }
+}
+
+void BlockCache::Release(const boost::filesystem::path& file)
+{
+    open_files_.erase(file);
+    extents_.erase(file);
+}
+
+void BlockCache::Forget(const boost::filesystem::path& file)
+{
+    Release(file);
+    
+    auto it = files_.find(file);
+    if (it == files_.end()) {
+        return;
+    }
+    
+    for (size_t i = 0; i < it->second.hashed; ++i) {
+        hash_cache_.erase(BlockKey{it->second.id, i});
+    }
+    path_bytes_ -= it->first.native().size();
+    files_.erase(it);
+}
+
+void BlockCache::DropChanged()
+{
+    std::vector<boost::filesystem::path> changed;
+    
+    for (const auto& [file, cached] : files_) {
+        struct stat st{};
+        // entries without a stamp cannot be checked and are dropped as well
+        if (cached.blocks == CachedFile::kUnknown || ::stat(file.c_str(), &st) != 0 ||
+            static_cast<uintmax_t>(st.st_size) != cached.size ||
+            static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec != cached.mtime) {
+            changed.push_back(file);
+        }
+    }
+    
+    for (const auto& file : changed) {
+        Forget(file);
+    }
+}
+
+void BlockCache::Clear()
+{
+    // swapped out rather than cleared, which would keep the bucket arrays
+    decltype(hash_cache_)().swap(hash_cache_);
+    decltype(files_)().swap(files_);
+    open_files_.clear();
+    extents_.clear();
+    path_bytes_ = 0;
+}
+
+size_t BlockCache::MemoryUsage() const
+{
+    // node-based maps: the element, a next pointer and a cached hash per node, a pointer per bucket
+    const size_t node = 2 * sizeof(void*);
+    size_t digest = 0;
+    // digests up to 15 characters are stored inside the string itself
+    if (!hash_cache_.empty() && hash_cache_.begin()->second.capacity() > 15) {
+        digest = hash_cache_.begin()->second.capacity() + 1;
+    }
+    
+    return hash_cache_.size() * (sizeof(BlockKey) + sizeof(std::string) + node + digest) +
+           hash_cache_.bucket_count() * sizeof(void*) +
+           files_.size() * (sizeof(boost::filesystem::path) + sizeof(CachedFile) + node) +
+           files_.bucket_count() * sizeof(void*) + path_bytes_;
+}
+
+void BlockCache::SeedDigest(const boost::filesystem::path& file, size_t block_index, std::string digest)
+{
+    StoreDigest(Cached(file), block_index, std::move(digest));
+}
+
+void BlockCache::SetDigestObserver(DigestObserver observer)
+{
+    observer_ = std::move(observer);
+}
+
+WorkerPool& BlockCache::DevicePool(dev_t device)
+{
+    auto it = pools_.find(device);
+    if (it == pools_.end()) {
+        size_t limit = IsRotational(device) ? io_.hdd_threads : io_.ssd_threads;
+        it = pools_.emplace(device, std::make_unique<WorkerPool>(limit)).first;
+    }
+    
+    return *it->second;
+}
+
+bool BlockCache::IsRotational(dev_t device)
+{
+    auto it = rotational_.find(device);
+    if (it == rotational_.end()) {
+        it = rotational_.emplace(device, IsRotationalDevice(device)).first;
+    }
+    
+    return it->second;
+}
+
+bool BlockCache::UsePhysicalOrder(const FileHandle& handle)
+{
+    if (io_.schedule != IoSchedule::Auto) {
+        return io_.schedule == IoSchedule::Physical;
+    }
+    
+    return IsRotational(handle.device);
+}
+
+const std::vector<Extent>& BlockCache::GetExtents(const boost::filesystem::path& file, const FileHandle& handle)
+{
+    auto it = extents_.find(file);
+    if (it == extents_.end()) {
+        it = extents_.emplace(file, ReadExtents(handle.fd)).first;
+    }
+    
+    return it->second;
+}
+
+uint64_t BlockCache::ReadOrder(const boost::filesystem::path& file, const FileHandle& handle, size_t index)
+{
+    return PhysicalOffset(GetExtents(file, handle), static_cast<uint64_t>(index) * block_size_);
+}
+
+std::string BlockCache::GetExtentSignature(const boost::filesystem::path& file)
+{
+    auto handle = GetFileHandle(file);
+    return ExtentSignature(handle->device, handle->size, GetExtents(file, *handle));
+}
+
+void BlockCache::LoadBlocks(const std::vector<boost::filesystem::path>& files, size_t block_index)
+{
+    TRACE_SPAN("load_round");
+    struct PendingRead
+    {
+        const boost::filesystem::path* file;
+        CachedFile* cached;
+        std::shared_ptr<FileHandle> handle;
+        uint64_t order;
+        std::string hash;
+        bool done;
+    };
+    
+    std::vector<PendingRead> pending;
+    pending.reserve(files.size());
+    
+    for (const auto& file : files) {
+        CachedFile& cached = Cached(file);
+        if (hash_cache_.count(BlockKey{cached.id, block_index})) {
+            continue;
+        }
         
-        if (!stream) {
-            throw std::runtime_error("Cannot seek to position in file: " + file.string());
+        try {
+            auto handle = GetFileHandle(file);
+            uint64_t order = UsePhysicalOrder(*handle) ? ReadOrder(file, *handle, block_index) : 0;
+            
+            pending.push_back({&file, &cached, std::move(handle), order, {}, false});
         }
+        catch (const std::exception&) {
+            // left uncached, GetBlockHash reports the error for this file
+            continue;
+        }
+    }
+    
+    // Every device gets its own queue, served in ascending physical order (an elevator
+    // sweep) when scheduling is physical; path order is kept otherwise.
+    std::map<dev_t, std::vector<PendingRead*>> queues;
+    for (auto& read : pending) {
+        queues[read.handle->device].push_back(&read);
+    }
+    
+    struct DeviceJob
+    {
+        WorkerPool* pool;
+        size_t workers;
+        std::function<void(size_t)> work;
+    };
+    std::vector<DeviceJob> jobs;
+    std::vector<std::unique_ptr<std::atomic<size_t>>> cursors;
+    
+    for (auto& [device, queue] : queues) {
+        std::stable_sort(queue.begin(), queue.end(),
+                         [](const PendingRead* a, const PendingRead* b) { return a->order < b->order; });
+        
+        WorkerPool& pool = DevicePool(device);
+        size_t worker_count = std::min(pool.Threads(), queue.size());
+        // a queue shorter than the pool leaves threads to split large SHA256Tree blocks
+        size_t hash_threads = pool.Threads() / worker_count;
         
-        std::vector<char> buffer(block_size_, 0);     
-        stream.read(buffer.data(), block_size_);
+        cursors.push_back(std::make_unique<std::atomic<size_t>>(0));
+        std::atomic<size_t>* cursor = cursors.back().get();
+        std::vector<PendingRead*>* reads = &queue;
         
-        return hasher_->HashBlock(buffer.data(), block_size_);
+        jobs.push_back({&pool, worker_count, [this, cursor, reads, block_index, hash_threads](size_t) {
+            // blocks are read into a batch and hashed together, one per hasher lane
+            std::vector<BlockBuffer> buffers;
+            std::vector<PendingRead*> batch;
+            std::vector<BlockView> views;
+            std::vector<std::string> digests(Hasher::kLanes);
+            
+            auto hash_batch = [&]() {
+                TRACE_SPAN("hash");
+                Stats::Add(Counter::BlocksHashed, batch.size());
+                hasher_->HashBlocks(views.data(), views.size(), digests.data(), hash_threads);
+                for (size_t k = 0; k < batch.size(); ++k) {
+                    batch[k]->hash = std::move(digests[k]);
+                    batch[k]->done = true;
+                }
+                batch.clear();
+                views.clear();
+            };
+            
+            for (size_t i = (*cursor)++; i < reads->size(); i = (*cursor)++) {
+                PendingRead& read = *(*reads)[i];
+                if (buffers.size() == batch.size()) {
+                    buffers.push_back(AllocateBlockBuffer(block_size_));
+                }
+                
+                size_t size;
+                try {
+                    size = ReadBlock(*read.handle, block_index, buffers[batch.size()].get());
+                }
+                catch (const std::exception&) {
+                    continue;
+                }
+                
+                views.push_back({buffers[batch.size()].get(), size});
+                batch.push_back(&read);
+                if (batch.size() == Hasher::kLanes) {
+                    hash_batch();
+                }
+            }
+            
+            if (!batch.empty()) {
+                hash_batch();
+            }
+        }});
     }
-    catch (const std::exception& e) {
-        throw std::runtime_error("Error reading block from " + file.string() + ": " + e.what());
+    
+    // a single worker reads on the calling thread, the rest run on their device's pool
+    if (jobs.size() == 1 && jobs.front().workers == 1) {
+        jobs.front().work(0);
+    } else {
+        // every started job is waited for, its workers point into this frame
+        std::exception_ptr error;
+        size_t started = 0;
+        try {
+            for (; started < jobs.size(); ++started) {
+                jobs[started].pool->Start(jobs[started].workers, jobs[started].work);
+            }
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        for (size_t j = 0; j < started; ++j) {
+            try {
+                jobs[j].pool->Wait();
+            }
+            catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    
+    for (auto& read : pending) {
+        if (read.done) {
+            if (observer_) {
+                observer_(*read.file, block_index, read.hash);
+            }
+            StoreDigest(*read.cached, block_index, std::move(read.hash));
+            read.cached->loaded = block_index;
+        }
     }
 }
 
 std::string BlockCache::GetBlockHash(const boost::filesystem::path& file, size_t block_index)
 {
-    BlockKey key{file, block_index};
+    CachedFile& cached = Cached(file);
+    BlockKey key{cached.id, block_index};
 
     auto it = hash_cache_.find(key);
     if (it != hash_cache_.end()) {
+        if (cached.loaded == block_index) {
+            cached.loaded = CachedFile::kUnknown;
+            Stats::Add(Counter::CacheMisses);
+        } else {
+            Stats::Add(Counter::CacheHits);
+        }
         return it->second;  
     }
+    
+    Stats::Add(Counter::CacheMisses);
 
     std::string hash = ReadAndHashBlock(file, block_index);
     
-    hash_cache_[key] = hash;
+    if (observer_) {
+        observer_(file, block_index, hash);
+    }
+    StoreDigest(cached, block_index, hash);
     return hash;
 }
\ No newline at end of file
@@ -0,0 +1,463 @@
+#include <boost/crc.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "binary_io.h"
+#include "trace.h"
+
+namespace
+{
+    const char kMagic[4] = {'B', 'A', 'Y', 'C'};
+    
+    enum RecordType : uint8_t
+    {
+        kScanRecord = 1,
+        kGroupRecord = 2,
+        kDigestRecord = 3
+    };
+    
+    uint32_t Crc(const char* data, size_t size)
+    {
+        boost::crc_32_type crc;
+        crc.process_bytes(data, size);
+        return crc.checksum();
+    }
+    
+    void PutString(std::string& out, const std::string& s)
+    {
+        PutInteger<uint32_t>(out, s.size());
+        out += s;
+    }
+    
+    // size, nanosecond mtime and inode of a file, false if it cannot be stat'ed
+    bool Stamp(const boost::filesystem::path& file, uintmax_t& size, int64_t& mtime, uint64_t& inode)
+    {
+        struct stat st{};
+        if (::stat(file.c_str(), &st) != 0) {
+            return false;
+        }
+        
+        size = static_cast<uintmax_t>(st.st_size);
+        mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        inode = static_cast<uint64_t>(st.st_ino);
+        return true;
+    }
+    
+    void WriteAll(int fd, const std::string& data)
+    {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::strerror(errno));
+            }
+            done += static_cast<size_t>(n);
+        }
+    }
+}
+
+Checkpoint::Checkpoint(const boost::filesystem::path& file, const Config& config, bool resume, std::chrono::milliseconds interval)
+    : file_(file), block_size_(config.block_size), hash_type_(static_cast<uint8_t>(config.hash_type)), interval_(interval)
+{
+    if (resume && boost::filesystem::exists(file_)) {
+        Load();
+    }
+    
+    // a journal without a finished scan has nothing worth keeping
+    if (!scanned_) {
+        resolved_.clear();
+        digests_.clear();
+        Start(Header());
+    }
+    
+    writer_ = std::thread(&Checkpoint::WriterLoop, this);
+}
+
+Checkpoint::~Checkpoint()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    writer_.join();
+    
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+std::string Checkpoint::Header() const
+{
+    std::string out(kMagic, sizeof(kMagic));
+    PutInteger<uint32_t>(out, kVersion);
+    PutInteger<uint64_t>(out, block_size_);
+    PutInteger<uint8_t>(out, hash_type_);
+    return out;
+}
+
+void Checkpoint::AppendRecord(std::string& out, uint8_t type, const std::string& payload)
+{
+    PutInteger<uint8_t>(out, type);
+    PutInteger<uint32_t>(out, payload.size());
+    out += payload;
+    PutInteger<uint32_t>(out, Crc(payload.data(), payload.size()));
+}
+
+std::string Checkpoint::ScanRecord(const std::vector<ScanEntry>& entries)
+{
+    std::string payload;
+    PutInteger<uint64_t>(payload, entries.size());
+    for (const auto& entry : entries) {
+        PutInteger<uint64_t>(payload, entry.size);
+        PutInteger<int64_t>(payload, entry.mtime);
+        PutInteger<uint64_t>(payload, entry.inode);
+        PutString(payload, entry.file.string());
+    }
+    
+    std::string out;
+    AppendRecord(out, kScanRecord, payload);
+    return out;
+}
+
+std::string Checkpoint::GroupRecord(uintmax_t size, const ResolvedGroup& resolved)
+{
+    std::string payload;
+    PutInteger<uint64_t>(payload, size);
+    PutInteger<uint32_t>(payload, resolved.files.size());
+    for (const auto& file : resolved.files) {
+        PutString(payload, file.string());
+    }
+    PutInteger<uint32_t>(payload, resolved.groups.size());
+    for (const auto& group : resolved.groups) {
+        PutInteger<uint32_t>(payload, group.size());
+        for (const auto& file : group) {
+            PutString(payload, file.string());
+        }
+    }
+    
+    std::string out;
+    AppendRecord(out, kGroupRecord, payload);
+    return out;
+}
+
+std::string Checkpoint::DigestRecord(const std::string& file, size_t block_index, const std::string& digest)
+{
+    std::string payload;
+    PutString(payload, file);
+    PutInteger<uint64_t>(payload, block_index);
+    PutString(payload, digest);
+    
+    std::string out;
+    AppendRecord(out, kDigestRecord, payload);
+    return out;
+}
+
+void Checkpoint::Load()
+{
+    TRACE_SPAN("load_checkpoint");
+    
+    std::ifstream stream(file_.string(), std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("Cannot open checkpoint " + file_.string());
+    }
+    std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    
+    std::string header = Header();
+    if (data.compare(0, sizeof(kMagic), kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error(file_.string() + " is not a bayan checkpoint");
+    }
+    if (data.compare(0, header.size(), header) != 0) {
+        throw std::runtime_error("Checkpoint " + file_.string() + " was written by another version or with another --block or --hash");
+    }
+    
+    size_t pos = header.size();
+    while (data.size() - pos >= 9) {
+        std::string frame = data.substr(pos, 5);
+        BinaryReader frame_reader(frame, "Checkpoint " + file_.string());
+        uint8_t type = frame_reader.Get<uint8_t>();
+        uint32_t length = frame_reader.Get<uint32_t>();
+        
+        if (data.size() - pos - 5 < static_cast<size_t>(length) + 4) {
+            break;
+        }
+        
+        std::string payload = data.substr(pos + 5, length);
+        std::string crc = data.substr(pos + 5 + length, 4);
+        if (BinaryReader(crc, "Checkpoint " + file_.string()).Get<uint32_t>() != Crc(payload.data(), payload.size())) {
+            break;
+        }
+        pos += 5 + length + 4;
+        
+        BinaryReader reader(payload, "Checkpoint record in " + file_.string());
+        
+        if (type == kScanRecord) {
+            scan_.clear();
+            resolved_.clear();
+            digests_.clear();
+            
+            uint64_t count = reader.Get<uint64_t>();
+            for (uint64_t i = 0; i < count; ++i) {
+                ScanEntry entry;
+                entry.size = reader.Get<uint64_t>();
+                entry.mtime = reader.Get<int64_t>();
+                entry.inode = reader.Get<uint64_t>();
+                entry.file = reader.Bytes(reader.Get<uint32_t>());
+                scan_.push_back(std::move(entry));
+            }
+            scanned_ = true;
+        } else if (type == kGroupRecord) {
+            uintmax_t size = reader.Get<uint64_t>();
+            ResolvedGroup resolved;
+            resolved.files.resize(reader.Get<uint32_t>());
+            for (auto& file : resolved.files) {
+                file = reader.Bytes(reader.Get<uint32_t>());
+            }
+            resolved.groups.resize(reader.Get<uint32_t>());
+            for (auto& group : resolved.groups) {
+                uint32_t count = reader.Get<uint32_t>();
+                for (uint32_t i = 0; i < count; ++i) {
+                    group.emplace_back(reader.Bytes(reader.Get<uint32_t>()));
+                }
+            }
+            resolved_[size] = std::move(resolved);
+        } else if (type == kDigestRecord) {
+            std::string file = reader.Bytes(reader.Get<uint32_t>());
+            size_t index = static_cast<size_t>(reader.Get<uint64_t>());
+            digests_[file].emplace_back(index, reader.Bytes(reader.Get<uint32_t>()));
+        }
+    }
+    
+    if (pos != data.size()) {
+        std::cerr << "Warning: ignoring " << data.size() - pos << " bytes of an incomplete record at the end of " << file_ << "\n";
+    }
+}
+
+void Checkpoint::Start(const std::string& contents)
+{
+    boost::filesystem::path tmp = file_;
+    tmp += ".tmp";
+    
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create checkpoint " + tmp.string() + ": " + std::strerror(errno));
+    }
+    try {
+        WriteAll(fd, contents);
+    }
+    catch (const std::exception& e) {
+        ::close(fd);
+        throw std::runtime_error("Cannot write checkpoint " + tmp.string() + ": " + e.what());
+    }
+    ::fdatasync(fd);
+    ::close(fd);
+    boost::filesystem::rename(tmp, file_);
+    
+    fd = ::open(file_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open checkpoint " + file_.string() + ": " + std::strerror(errno));
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    fd_ = fd;
+}
+
+bool Checkpoint::HasScan() const
+{
+    return scanned_;
+}
+
+SizeTable Checkpoint::RestoreScan(bool drop_singletons)
+{
+    TRACE_SPAN("restore_scan");
+    
+    SizeTable table;
+    std::set<uintmax_t> invalid;
+    std::vector<ScanEntry> valid;
+    size_t changed = 0;
+    
+    for (auto& entry : scan_) {
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+        uint64_t inode = 0;
+        bool exists = Stamp(entry.file, size, mtime, inode);
+        
+        if (exists && size == entry.size && mtime == entry.mtime && inode == entry.inode) {
+            table.Add(entry.size, entry.file);
+            valid.push_back(std::move(entry));
+            continue;
+        }
+        
+        ++changed;
+        invalid.insert(entry.size);
+        digests_.erase(entry.file.string());
+        
+        if (exists) {
+            invalid.insert(size);
+            table.Add(size, entry.file);
+            valid.push_back({size, mtime, inode, std::move(entry.file)});
+        }
+    }
+    
+    for (uintmax_t size : invalid) {
+        resolved_.erase(size);
+    }
+    
+    table.Finalize(drop_singletons);
+    scan_ = std::move(valid);
+    
+    std::string contents = Header() + ScanRecord(scan_);
+    for (const auto& [size, resolved] : resolved_) {
+        contents += GroupRecord(size, resolved);
+    }
+    for (const auto& [file, blocks] : digests_) {
+        for (const auto& [index, digest] : blocks) {
+            contents += DigestRecord(file, index, digest);
+        }
+    }
+    Start(contents);
+    
+    std::cerr << "Resuming from " << file_ << ": " << scan_.size() << " files, " << resolved_.size()
+              << " size groups already resolved, " << changed << " files changed since the checkpoint\n";
+    
+    return table;
+}
+
+void Checkpoint::RecordScan(const SizeTable& table)
+{
+    scan_.clear();
+    scan_.reserve(table.Records().size());
+    
+    for (const auto& record : table.Records()) {
+        const auto& file = table.File(record.file);
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+        uint64_t inode = 0;
+        // a file that cannot be stat'ed gets no stamp and is checked again on resume
+        Stamp(file, size, mtime, inode);
+        scan_.push_back({record.size, mtime, inode, file});
+    }
+    
+    scanned_ = true;
+    Queue(ScanRecord(scan_));
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_requested_ = true;
+    wake_.notify_all();
+}
+
+void Checkpoint::Attach(BlockCache& cache)
+{
+    for (auto& [file, blocks] : digests_) {
+        for (auto& [index, digest] : blocks) {
+            cache.SeedDigest(file, index, std::move(digest));
+        }
+    }
+    digests_.clear();
+    
+    cache.SetDigestObserver([this](const boost::filesystem::path& file, size_t block_index, const std::string& digest) {
+        RecordDigest(file, block_index, digest);
+    });
+}
+
+bool Checkpoint::Resolved(uintmax_t size, const std::vector<boost::filesystem::path>& files, Groups& groups) const
+{
+    auto it = resolved_.find(size);
+    if (it == resolved_.end() || it->second.files.size() != files.size()) {
+        return false;
+    }
+    
+    std::vector<boost::filesystem::path> sorted = files;
+    std::sort(sorted.begin(), sorted.end());
+    if (sorted != it->second.files) {
+        return false;
+    }
+    
+    groups = it->second.groups;
+    return true;
+}
+
+void Checkpoint::RecordGroup(uintmax_t size, const std::vector<boost::filesystem::path>& files, const Groups& groups)
+{
+    ResolvedGroup resolved{files, groups};
+    std::sort(resolved.files.begin(), resolved.files.end());
+    Queue(GroupRecord(size, resolved));
+}
+
+void Checkpoint::RecordDigest(const boost::filesystem::path& file, size_t block_index, const std::string& digest)
+{
+    Queue(DigestRecord(file.string(), block_index, digest));
+}
+
+void Checkpoint::Queue(std::string record)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_ += record.size();
+    pending_ += record;
+}
+
+void Checkpoint::Flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = queued_;
+    flush_requested_ = true;
+    wake_.notify_all();
+    flushed_.wait(lock, [&]() { return written_ >= target || fd_ < 0; });
+}
+
+void Checkpoint::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (true) {
+        wake_.wait_for(lock, interval_, [&]() { return stopping_ || flush_requested_; });
+        flush_requested_ = false;
+        
+        if (fd_ >= 0 && !pending_.empty()) {
+            std::string batch;
+            batch.swap(pending_);
+            int fd = fd_;
+            lock.unlock();
+            
+            bool ok = true;
+            try {
+                WriteAll(fd, batch);
+                ::fdatasync(fd);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Warning: checkpointing stopped, cannot write " << file_ << ": " << e.what() << "\n";
+                ok = false;
+            }
+            
+            lock.lock();
+            written_ += batch.size();
+            if (!ok) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+        
+        if (fd_ < 0) {
+            // nothing can be written any more, keep the queue from growing
+            written_ = queued_;
+            pending_.clear();
+        }
+        flushed_.notify_all();
+        
+        if (stopping_ && pending_.empty()) {
+            break;
+        }
+    }
+}
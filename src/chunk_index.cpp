@@ -0,0 +1,131 @@
+#include <boost/uuid/detail/md5.hpp>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include "chunk_index.h"
+#include "parallel.h"
+#include "progress.h"
+#include "trace.h"
+
+ChunkIndex::ChunkIndex(size_t average_chunk, size_t threads) : chunker_(average_chunk), threads_(threads)
+{
+    if (threads_ == 0) {
+        throw std::invalid_argument("Thread count must be greater than 0");
+    }
+}
+
+ChunkIndex::FileChunks ChunkIndex::ChunkFile(const boost::filesystem::path& file) const
+{
+    TRACE_SPAN("chunk_file");
+    
+    FileChunks chunks;
+    chunker_.ChunkFile(file, [&](const uint8_t* data, size_t size) {
+        boost::uuids::detail::md5 hash;
+        hash.process_bytes(data, size);
+        
+        boost::uuids::detail::md5::digest_type digest;
+        hash.get_digest(digest);
+        
+        Chunk chunk{{}, static_cast<uint32_t>(size)};
+        static_assert(sizeof(digest) == sizeof(chunk.digest), "MD5 digest is 16 bytes");
+        std::memcpy(chunk.digest.data(), &digest, sizeof(digest));
+        chunks.push_back(chunk);
+    });
+    
+    return chunks;
+}
+
+ChunkReport ChunkIndex::Analyze(const std::vector<boost::filesystem::path>& files, double min_percent)
+{
+    ChunkReport report;
+    std::vector<FileChunks> chunks(files.size());
+    std::vector<uintmax_t> sizes(files.size(), 0);
+    
+    for (size_t i = 0; i < files.size(); ++i) {
+        boost::system::error_code ec;
+        sizes[i] = boost::filesystem::file_size(files[i], ec);
+        if (!ec) {
+            Progress::AddCandidateBytes(sizes[i]);
+        }
+    }
+    Progress::AddGroups(files.size());
+    
+    ParallelFor(files.size(), threads_, [&](size_t i) {
+        try {
+            chunks[i] = ChunkFile(files[i]);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error reading file " << files[i] << ", it is skipped: " << e.what() << "\n";
+        }
+        Progress::AddGroupsResolved(1);
+    });
+    
+    TRACE_SPAN("chunk_index");
+    
+    struct Entry
+    {
+        uint32_t size = 0;
+        std::vector<uint32_t> files;
+    };
+    std::unordered_map<ChunkDigest, Entry, ChunkDigestHash> index;
+    std::vector<uintmax_t> chunked_bytes(files.size(), 0);
+    
+    for (size_t f = 0; f < files.size(); ++f) {
+        for (const Chunk& chunk : chunks[f]) {
+            Entry& entry = index[chunk.digest];
+            entry.size = chunk.size;
+            if (entry.files.empty() || entry.files.back() != f) {
+                entry.files.push_back(static_cast<uint32_t>(f));
+            }
+            chunked_bytes[f] += chunk.size;
+            report.total_bytes += chunk.size;
+            ++report.chunks;
+        }
+        
+        report.files += chunks[f].empty() ? 0 : 1;
+        FileChunks().swap(chunks[f]);
+    }
+    
+    report.unique_chunks = index.size();
+    
+    std::unordered_map<uint64_t, uintmax_t> shared;
+    for (const auto& [digest, entry] : index) {
+        report.unique_bytes += entry.size;
+        
+        if (entry.files.size() < 2 || entry.files.size() > kMaxPostings) {
+            continue;
+        }
+        
+        for (size_t i = 0; i < entry.files.size(); ++i) {
+            for (size_t j = i + 1; j < entry.files.size(); ++j) {
+                shared[(static_cast<uint64_t>(entry.files[i]) << 32) | entry.files[j]] += entry.size;
+            }
+        }
+    }
+    
+    for (const auto& [key, bytes] : shared) {
+        size_t a = static_cast<size_t>(key >> 32);
+        size_t b = static_cast<size_t>(key & 0xFFFFFFFFu);
+        uintmax_t larger = std::max(chunked_bytes[a], chunked_bytes[b]);
+        double percent = larger == 0 ? 0 : 100.0 * static_cast<double>(bytes) / static_cast<double>(larger);
+        
+        if (percent >= min_percent) {
+            report.similar.push_back({files[a], files[b], bytes, percent});
+        }
+    }
+    
+    std::sort(report.similar.begin(), report.similar.end(), [](const ChunkSimilarity& x, const ChunkSimilarity& y) {
+        if (x.percent != y.percent) {
+            return x.percent > y.percent;
+        }
+        if (x.shared_bytes != y.shared_bytes) {
+            return x.shared_bytes > y.shared_bytes;
+        }
+        return std::tie(x.first, x.second) < std::tie(y.first, y.second);
+    });
+    
+    return report;
+}
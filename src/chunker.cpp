@@ -0,0 +1,138 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "chunker.h"
+#include "progress.h"
+#include "stats.h"
+
+namespace
+{
+    uint64_t HighBitsMask(unsigned bits)
+    {
+        return bits == 0 ? 0 : ~uint64_t{0} << (64 - bits);
+    }
+}
+
+Chunker::Chunker(size_t average) : average_(average)
+{
+    if (average_ < 64 || (average_ & (average_ - 1)) != 0) {
+        throw std::invalid_argument("Average chunk size must be a power of two not less than 64");
+    }
+    
+    min_size_ = average_ / 4;
+    max_size_ = average_ * 4;
+    
+    unsigned bits = 0;
+    while ((size_t{1} << bits) < average_) {
+        ++bits;
+    }
+    
+    // the Gear hash shifts left, so its high bits carry the most recent 64 bytes
+    mask_small_ = HighBitsMask(bits + 2);
+    mask_large_ = HighBitsMask(bits - 2);
+}
+
+const std::array<uint64_t, 256>& Chunker::GearTable()
+{
+    static const std::array<uint64_t, 256> table = []() {
+        std::array<uint64_t, 256> values{};
+        uint64_t x = 0x6a09e667f3bcc908ULL;
+        
+        for (auto& value : values) {
+            x += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            value = z ^ (z >> 31);
+        }
+        
+        return values;
+    }();
+    
+    return table;
+}
+
+size_t Chunker::NextCut(const uint8_t* data, size_t size) const
+{
+    if (size <= min_size_) {
+        return size;
+    }
+    
+    const auto& gear = GearTable();
+    size_t end = size < max_size_ ? size : max_size_;
+    size_t normal = end < average_ ? end : average_;
+    
+    uint64_t hash = 0;
+    size_t i = min_size_;
+    
+    // cut points below the minimum are skipped without hashing
+    for (; i < normal; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & mask_small_) == 0) {
+            return i + 1;
+        }
+    }
+    
+    for (; i < end; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & mask_large_) == 0) {
+            return i + 1;
+        }
+    }
+    
+    return end;
+}
+
+void Chunker::ChunkFile(const boost::filesystem::path& file, const std::function<void(const uint8_t*, size_t)>& on_chunk) const
+{
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + file.string() + ": " + std::strerror(errno));
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    
+    std::vector<uint8_t> buffer(kReadSize + max_size_);
+    size_t filled = 0;
+    bool eof = false;
+    
+    while (true) {
+        while (!eof && filled < buffer.size()) {
+            ssize_t n = ::read(fd, buffer.data() + filled, buffer.size() - filled);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int error = errno;
+                ::close(fd);
+                throw std::runtime_error("Read failed for " + file.string() + ": " + std::strerror(error));
+            }
+            if (n == 0) {
+                eof = true;
+                break;
+            }
+            filled += static_cast<size_t>(n);
+            Stats::Add(Counter::BytesRead, static_cast<uint64_t>(n));
+            Progress::AddBytesHashed(static_cast<uint64_t>(n));
+        }
+        
+        // a cut needs a full window of MaxSize() bytes unless the file ends earlier
+        size_t pos = 0;
+        while (pos < filled && (eof || filled - pos >= max_size_)) {
+            size_t cut = NextCut(buffer.data() + pos, filled - pos);
+            on_chunk(buffer.data() + pos, cut);
+            pos += cut;
+        }
+        
+        std::memmove(buffer.data(), buffer.data() + pos, filled - pos);
+        filled -= pos;
+        
+        if (eof && filled == 0) {
+            break;
+        }
+    }
+    
+    ::close(fd);
+}
@@ -1,8 +1,12 @@
 #include <iostream>
+#include <algorithm>
+#include <unordered_map>
 #include "comparator.h"
 #include "block_cache.h" 
+#include "stats.h"
+#include "trace.h"
 
-Comparator::Comparator(BlockCache& cache) : cache_(cache){}
+Comparator::Comparator(BlockCache& cache, size_t prefetch_blocks) : cache_(cache), prefetch_blocks_(prefetch_blocks){}
 
 bool Comparator::Equals(const boost::filesystem::path& a, const boost::filesystem::path& b)
 {
@@ -17,6 +21,7 @@ bool Comparator::Equals(const boost::filesystem::path& a, const boost::filesyste
         for (size_t i = 0; i < blocks_a; ++i) {
             std::string ha = cache_.GetBlockHash(a, i);
             std::string hb = cache_.GetBlockHash(b, i);
+            Stats::Add(Counter::Comparisons);
             
             if (ha != hb) {
                 return false;
@@ -31,41 +36,246 @@ bool Comparator::Equals(const boost::filesystem::path& a, const boost::filesyste
     }
 }
 
+const std::vector<std::vector<boost::filesystem::path>>& Comparator::SharedGroups() const
+{
+    return shared_groups_;
+}
+
+void Comparator::ClearSharedGroups()
+{
+    decltype(shared_groups_)().swap(shared_groups_);
+    shared_bytes_ = 0;
+}
+
+size_t Comparator::MemoryUsage() const
+{
+    return shared_groups_.capacity() * sizeof(shared_groups_.front()) + shared_bytes_;
+}
+
+void Comparator::SetStopCondition(std::function<bool()> stop)
+{
+    stop_ = std::move(stop);
+}
+
+bool Comparator::Interrupted() const
+{
+    return interrupted_;
+}
+
+std::vector<size_t> Comparator::MergeSharedExtents(const std::vector<size_t>& bucket, const std::vector<boost::filesystem::path>& files, std::vector<std::vector<size_t>>& aliases)
+{
+    std::vector<size_t> representatives;
+    std::unordered_map<std::string, size_t> owner_by_signature;
+    
+    for (size_t idx : bucket) {
+        std::string signature;
+        try {
+            signature = cache_.GetExtentSignature(files[idx]);
+        }
+        catch (const std::exception&) {
+            // unreadable files are reported by the first read round
+        }
+        
+        if (signature.empty()) {
+            representatives.push_back(idx);
+            continue;
+        }
+        
+        auto [it, inserted] = owner_by_signature.emplace(std::move(signature), idx);
+        if (inserted) {
+            representatives.push_back(idx);
+        } else {
+            aliases[it->second].push_back(idx);
+            cache_.Release(files[idx]);
+        }
+    }
+    
+    return representatives;
+}
+
+std::vector<std::vector<size_t>> Comparator::SplitByBlock(const std::vector<size_t>& bucket, const std::vector<boost::filesystem::path>& files, size_t block_index)
+{
+    TRACE_SPAN("compare");
+    std::vector<std::vector<size_t>> parts;
+    std::unordered_map<std::string, size_t> part_by_hash;
+    
+    for (size_t idx : bucket) {
+        try {
+            std::string hash = cache_.GetBlockHash(files[idx], block_index);
+            Stats::Add(Counter::Comparisons);
+            
+            auto [it, inserted] = part_by_hash.emplace(std::move(hash), parts.size());
+            if (inserted) {
+                parts.emplace_back();
+            }
+            parts[it->second].push_back(idx);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error reading file " << files[idx] << ", it is considered unique: " << e.what() << "\n";
+            cache_.Forget(files[idx]);
+        }
+    }
+    
+    return parts;
+}
+
+void Comparator::PrefetchRound(const std::vector<std::vector<size_t>>& buckets, const std::vector<boost::filesystem::path>& files, size_t block_index)
+{
+    if (prefetch_blocks_ == 0) {
+        return;
+    }
+    
+    // the first round opens the whole window, later rounds only slide it by one block
+    size_t first = block_index == 0 ? 0 : block_index + prefetch_blocks_ - 1;
+    size_t count = block_index == 0 ? prefetch_blocks_ : 1;
+    
+    for (const auto& bucket : buckets) {
+        for (size_t idx : bucket) {
+            cache_.Prefetch(files[idx], first, count);
+        }
+    }
+}
+
+void Comparator::LoadRound(const std::vector<std::vector<size_t>>& buckets, const std::vector<boost::filesystem::path>& files, const std::vector<size_t>& block_counts, size_t block_index)
+{
+    std::vector<boost::filesystem::path> round_files;
+    
+    for (const auto& bucket : buckets) {
+        if (block_index >= block_counts[bucket.front()]) {
+            continue;
+        }
+        for (size_t idx : bucket) {
+            round_files.push_back(files[idx]);
+        }
+    }
+    
+    cache_.LoadBlocks(round_files, block_index);
+}
+
 std::vector<std::vector<boost::filesystem::path>> Comparator::FindDuplicates(const std::vector<boost::filesystem::path>& files)
 {
     std::vector<std::vector<boost::filesystem::path>> result; 
+    interrupted_ = false;
     
     if (files.size() < 2) {
         return result; 
     }
     
-    std::vector<boost::filesystem::path> remaining_files = files;
-    std::vector<bool> processed(remaining_files.size(), false);
+    std::vector<size_t> block_counts(files.size(), 0);
+    std::vector<std::vector<size_t>> buckets;
+    std::unordered_map<size_t, size_t> bucket_by_count;
     
-    for (size_t i = 0; i < remaining_files.size(); ++i) {
-        if (processed[i]) {
+    for (size_t i = 0; i < files.size(); ++i) {
+        try {
+            block_counts[i] = cache_.GetBlockCount(files[i]);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error reading file " << files[i] << ", it is considered unique: " << e.what() << "\n";
             continue;
         }
         
-        std::vector<boost::filesystem::path> duplicate_group;
-        duplicate_group.push_back(remaining_files[i]);
-        processed[i] = true;
+        auto [it, inserted] = bucket_by_count.emplace(block_counts[i], buckets.size());
+        if (inserted) {
+            buckets.emplace_back();
+        }
+        buckets[it->second].push_back(i);
+    }
+    
+    // Files whose extents are physically the same (reflinks, hard links) are equal without
+    // reading; only one of them stays in the bucket and the others follow it as aliases.
+    std::vector<std::vector<size_t>> aliases(files.size());
+    std::vector<std::vector<size_t>> groups;
+    std::vector<std::vector<size_t>> pending;
+    
+    for (auto& bucket : buckets) {
+        if (bucket.size() < 2) {
+            cache_.Forget(files[bucket.front()]);
+            continue;
+        }
         
-        for (size_t j = i + 1; j < remaining_files.size(); ++j) {
-            if (processed[j]) {
+        auto representatives = MergeSharedExtents(bucket, files, aliases);
+        
+        if (representatives.size() == 1) {
+            groups.push_back(std::move(representatives));
+        } else {
+            pending.push_back(std::move(representatives));
+        }
+    }
+    
+    buckets = std::move(pending);
+    
+    // Files are compared in rounds: every surviving bucket is split by the hash of
+    // block i, so only candidates that still match are read further.
+    for (size_t block = 0; !buckets.empty(); ++block) {
+        if (stop_ && stop_()) {
+            interrupted_ = true;
+            for (size_t i = 0; i < files.size(); ++i) {
+                cache_.Release(files[i]);
+            }
+            return result;
+        }
+        
+        std::vector<std::vector<size_t>> next;
+        
+        PrefetchRound(buckets, files, block);
+        LoadRound(buckets, files, block_counts, block);
+        
+        for (auto& bucket : buckets) {
+            if (block >= block_counts[bucket.front()]) {
+                groups.push_back(std::move(bucket));
+                continue;
+            }
+            
+            for (auto& part : SplitByBlock(bucket, files, block)) {
+                if (part.size() > 1) {
+                    next.push_back(std::move(part));
+                } else if (!aliases[part.front()].empty()) {
+                    groups.push_back(std::move(part));
+                } else {
+                    cache_.Forget(files[part.front()]);
+                }
+            }
+        }
+        
+        buckets = std::move(next);
+    }
+    
+    std::sort(groups.begin(), groups.end(),
+              [](const std::vector<size_t>& a, const std::vector<size_t>& b) { return a.front() < b.front(); });
+    
+    for (auto& group : groups) {
+        for (size_t idx : group) {
+            cache_.Release(files[idx]);
+            
+            if (aliases[idx].empty()) {
                 continue;
             }
             
-            if (Equals(remaining_files[i], remaining_files[j])) {
-                duplicate_group.push_back(remaining_files[j]);
-                processed[j] = true;
+            std::vector<boost::filesystem::path> shared_group{files[idx]};
+            for (size_t alias : aliases[idx]) {
+                shared_group.push_back(files[alias]);
+            }
+            for (const auto& file : shared_group) {
+                shared_bytes_ += sizeof(file) + file.native().capacity();
             }
+            shared_groups_.push_back(std::move(shared_group));
         }
         
-        if (duplicate_group.size() > 1) {
-            result.push_back(std::move(duplicate_group));
+        size_t representatives = group.size();
+        for (size_t i = 0; i < representatives; ++i) {
+            group.insert(group.end(), aliases[group[i]].begin(), aliases[group[i]].end());
         }
+        std::sort(group.begin(), group.end());
+        
+        std::vector<boost::filesystem::path> duplicate_group;
+        duplicate_group.reserve(group.size());
+        
+        for (size_t idx : group) {
+            duplicate_group.push_back(files[idx]);
+        }
+        
+        result.push_back(std::move(duplicate_group));
     }
     
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,320 @@
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include "deduplicator.h"
+
+namespace
+{
+    // kernels cap a single FIDEDUPERANGE request, larger files are deduplicated in steps
+    constexpr uint64_t kDedupeStep = 16 * 1024 * 1024;
+    constexpr size_t kCompareBuffer = 256 * 1024;
+
+    class Descriptor
+    {
+    public:
+        Descriptor(const boost::filesystem::path& p, int flags, mode_t mode = 0) : fd_(::open(p.c_str(), flags | O_CLOEXEC, mode))
+        {
+            if (fd_ < 0) {
+                throw std::runtime_error("Cannot open " + p.string() + ": " + std::strerror(errno));
+            }
+        }
+
+        ~Descriptor()
+        {
+            ::close(fd_);
+        }
+
+        Descriptor(const Descriptor&) = delete;
+        Descriptor& operator=(const Descriptor&) = delete;
+
+        int Get() const { return fd_; }
+
+    private:
+        int fd_;
+    };
+
+    struct stat StatFile(const boost::filesystem::path& p)
+    {
+        struct stat st{};
+        if (::lstat(p.c_str(), &st) != 0) {
+            throw std::runtime_error("Cannot stat " + p.string() + ": " + std::strerror(errno));
+        }
+        return st;
+    }
+
+    void RenameOver(const boost::filesystem::path& temp, const boost::filesystem::path& target)
+    {
+        if (::rename(temp.c_str(), target.c_str()) != 0) {
+            int error = errno;
+            ::unlink(temp.c_str());
+            throw std::runtime_error("Cannot replace " + target.string() + ": " + std::strerror(error));
+        }
+    }
+    
+    // fills the buffer unless the file ends first, returns the bytes read
+    size_t ReadFull(const Descriptor& file, const boost::filesystem::path& p, char* buffer, size_t size)
+    {
+        size_t filled = 0;
+        while (filled < size) {
+            ssize_t got = ::read(file.Get(), buffer + filled, size - filled);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got < 0) {
+                throw std::runtime_error("Cannot read " + p.string() + ": " + std::strerror(errno));
+            }
+            if (got == 0) {
+                break;
+            }
+            filled += static_cast<size_t>(got);
+        }
+        return filled;
+    }
+}
+
+Deduplicator::Deduplicator(DedupAction action, bool dry_run, bool verify, size_t threads)
+    : action_(action), dry_run_(dry_run), verify_(verify), threads_(threads)
+{
+    if (threads_ == 0) {
+        throw std::invalid_argument("Thread count must be greater than 0");
+    }
+}
+
+DedupReport Deduplicator::Apply(const std::vector<std::vector<boost::filesystem::path>>& groups)
+{
+    DedupReport total;
+    
+    if (action_ == DedupAction::None) {
+        return total;
+    }
+    
+    std::atomic<size_t> next_group{0};
+    std::vector<DedupReport> reports(std::min(threads_, std::max<size_t>(groups.size(), 1)));
+    std::vector<std::thread> workers;
+    
+    for (auto& report : reports) {
+        workers.emplace_back([this, &groups, &next_group, &report]() {
+            for (size_t i = next_group++; i < groups.size(); i = next_group++) {
+                ApplyGroup(groups[i], report);
+            }
+        });
+    }
+    
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    for (const auto& report : reports) {
+        total.replaced += report.replaced;
+        total.failed += report.failed;
+        total.bytes += report.bytes;
+    }
+    
+    return total;
+}
+
+void Deduplicator::ApplyGroup(const std::vector<boost::filesystem::path>& group, DedupReport& report)
+{
+    if (group.size() < 2) {
+        return;
+    }
+    
+    const auto& source = group.front();
+    
+    for (size_t i = 1; i < group.size(); ++i) {
+        const auto& target = group[i];
+        
+        try {
+            struct stat source_st = StatFile(source);
+            struct stat target_st = StatFile(target);
+            
+            if (source_st.st_size != target_st.st_size) {
+                throw std::runtime_error("size changed since the scan");
+            }
+            
+            // a second name of the same file is not a copy, replacing or deleting it frees nothing
+            if (source_st.st_dev == target_st.st_dev && source_st.st_ino == target_st.st_ino) {
+                continue;
+            }
+            
+            // the kernel compares the ranges itself for dedupe
+            if (verify_ && action_ != DedupAction::Dedupe && !SameContent(source, target)) {
+                throw std::runtime_error("content differs from " + source.string());
+            }
+            
+            std::ostringstream line;
+            line << (dry_run_ ? "[dry-run] " : "") << ActionName(action_) << ' ' << target;
+            if (action_ != DedupAction::Delete) {
+                line << " <- " << source;
+            }
+            
+            if (!dry_run_) {
+                ApplyOne(source, target);
+            }
+            
+            Log(line.str());
+            
+            ++report.replaced;
+            report.bytes += static_cast<uintmax_t>(target_st.st_size);
+        }
+        catch (const std::exception& e) {
+            ++report.failed;
+            
+            std::lock_guard<std::mutex> lock(output_mutex_);
+            std::cerr << "Cannot " << ActionName(action_) << ' ' << target << ": " << e.what() << "\n";
+        }
+    }
+}
+
+void Deduplicator::ApplyOne(const boost::filesystem::path& source, const boost::filesystem::path& target)
+{
+    switch (action_) {
+        case DedupAction::Hardlink:
+            Hardlink(source, target);
+            break;
+        case DedupAction::Reflink:
+            Reflink(source, target);
+            break;
+        case DedupAction::Dedupe:
+            DedupeRange(source, target);
+            break;
+        case DedupAction::Delete:
+            if (::unlink(target.c_str()) != 0) {
+                throw std::runtime_error(std::strerror(errno));
+            }
+            break;
+        case DedupAction::None:
+            break;
+    }
+}
+
+void Deduplicator::Log(const std::string& line)
+{
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    std::cout << line << '\n';
+}
+
+void Deduplicator::Hardlink(const boost::filesystem::path& source, const boost::filesystem::path& target)
+{
+    boost::filesystem::path temp = TempName(target);
+    
+    if (::link(source.c_str(), temp.c_str()) != 0) {
+        throw std::runtime_error(std::strerror(errno));
+    }
+    
+    RenameOver(temp, target);
+}
+
+void Deduplicator::Reflink(const boost::filesystem::path& source, const boost::filesystem::path& target)
+{
+    struct stat target_st = StatFile(target);
+    boost::filesystem::path temp = TempName(target);
+    
+    Descriptor src(source, O_RDONLY);
+    
+    {
+        Descriptor dst(temp, O_WRONLY | O_CREAT | O_EXCL, target_st.st_mode & 07777);
+        
+        if (::ioctl(dst.Get(), FICLONE, src.Get()) != 0) {
+            int error = errno;
+            ::unlink(temp.c_str());
+            throw std::runtime_error(std::strerror(error));
+        }
+        
+        // keep the replaced file's ownership, failure is not fatal for unprivileged runs
+        if (::fchown(dst.Get(), target_st.st_uid, target_st.st_gid) != 0) {
+            errno = 0;
+        }
+    }
+    
+    RenameOver(temp, target);
+}
+
+void Deduplicator::DedupeRange(const boost::filesystem::path& source, const boost::filesystem::path& target)
+{
+    Descriptor src(source, O_RDONLY);
+    Descriptor dst(target, O_RDWR);
+    
+    struct stat st = StatFile(source);
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    
+    std::vector<char> storage(sizeof(file_dedupe_range) + sizeof(file_dedupe_range_info));
+    auto* range = reinterpret_cast<file_dedupe_range*>(storage.data());
+    
+    for (uint64_t offset = 0; offset < size; ) {
+        std::memset(storage.data(), 0, storage.size());
+        range->src_offset = offset;
+        range->src_length = std::min(kDedupeStep, size - offset);
+        range->dest_count = 1;
+        range->info[0].dest_fd = dst.Get();
+        range->info[0].dest_offset = offset;
+        
+        if (::ioctl(src.Get(), FIDEDUPERANGE, range) != 0) {
+            throw std::runtime_error(std::strerror(errno));
+        }
+        
+        const file_dedupe_range_info& info = range->info[0];
+        
+        if (info.status == FILE_DEDUPE_RANGE_DIFFERS) {
+            throw std::runtime_error("kernel reports different content");
+        }
+        if (info.status < 0) {
+            throw std::runtime_error(std::strerror(-info.status));
+        }
+        if (info.bytes_deduped == 0) {
+            throw std::runtime_error("no progress deduplicating range");
+        }
+        
+        offset += info.bytes_deduped;
+    }
+}
+
+bool Deduplicator::SameContent(const boost::filesystem::path& source, const boost::filesystem::path& target)
+{
+    Descriptor first(source, O_RDONLY);
+    Descriptor second(target, O_RDONLY);
+    
+    std::vector<char> left(kCompareBuffer);
+    std::vector<char> right(kCompareBuffer);
+    
+    for (;;) {
+        size_t got = ReadFull(first, source, left.data(), left.size());
+        if (ReadFull(second, target, right.data(), right.size()) != got) {
+            return false;
+        }
+        if (got == 0) {
+            return true;
+        }
+        if (std::memcmp(left.data(), right.data(), got) != 0) {
+            return false;
+        }
+    }
+}
+
+boost::filesystem::path Deduplicator::TempName(const boost::filesystem::path& target)
+{
+    boost::filesystem::path temp = target;
+    temp += ".bayan-" + std::to_string(::getpid()) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    return temp;
+}
+
+std::string Deduplicator::ActionName(DedupAction action)
+{
+    switch (action) {
+        case DedupAction::Hardlink: return "hardlink";
+        case DedupAction::Reflink:  return "reflink";
+        case DedupAction::Dedupe:   return "dedupe";
+        case DedupAction::Delete:   return "delete";
+        case DedupAction::None:     break;
+    }
+    return "none";
+}
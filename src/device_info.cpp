@@ -0,0 +1,37 @@
+#include <fstream>
+#include <string>
+#include <sys/sysmacros.h>
+#include "device_info.h"
+
+namespace
+{
+    bool ReadFlag(const std::string& path, bool& value)
+    {
+        std::ifstream in(path);
+        int flag = 0;
+        
+        if (!(in >> flag)) {
+            return false;
+        }
+        
+        value = flag != 0;
+        return true;
+    }
+}
+
+bool IsRotationalDevice(dev_t device)
+{
+    std::string base = "/sys/dev/block/" + std::to_string(major(device)) + ":" + std::to_string(minor(device));
+    
+    bool rotational = false;
+    
+    if (ReadFlag(base + "/queue/rotational", rotational)) {
+        return rotational;
+    }
+    
+    if (ReadFlag(base + "/../queue/rotational", rotational)) {
+        return rotational;
+    }
+    
+    return false;
+}
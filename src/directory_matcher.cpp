@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <map>
+#include "directory_matcher.h"
+#include "hasher.h"
+#include "trace.h"
+
+namespace
+{
+    std::string Entry(const boost::filesystem::path& name, char kind, const std::string& identity)
+    {
+        // lengths keep the encoding unambiguous for names containing separators of their own
+        return std::to_string(name.native().size()) + ':' + name.native() + kind + identity;
+    }
+}
+
+DirectoryMatcher::DirectoryMatcher(const std::vector<boost::filesystem::path>& roots)
+{
+    for (const auto& root : roots) {
+        boost::system::error_code ec;
+        boost::filesystem::path canonical = boost::filesystem::canonical(root, ec);
+        roots_.push_back((ec ? boost::filesystem::absolute(root).lexically_normal() : canonical).string());
+    }
+}
+
+bool DirectoryMatcher::IsRoot(const boost::filesystem::path& directory) const
+{
+    return std::find(roots_.begin(), roots_.end(), directory.string()) != roots_.end();
+}
+
+size_t DirectoryMatcher::GetNode(const boost::filesystem::path& directory)
+{
+    auto it = node_by_path_.find(directory.string());
+    if (it != node_by_path_.end()) {
+        return it->second;
+    }
+    
+    size_t parent = kNoParent;
+    size_t depth = 0;
+    
+    if (!IsRoot(directory) && directory.has_parent_path() && directory.parent_path() != directory) {
+        parent = GetNode(directory.parent_path());
+        depth = nodes_[parent].depth + 1;
+    }
+    
+    size_t index = nodes_.size();
+    nodes_.push_back(Node{directory, parent, depth, {}, 0, false, {}});
+    node_by_path_.emplace(directory.string(), index);
+    
+    return index;
+}
+
+void DirectoryMatcher::ComputeDigests()
+{
+    std::vector<size_t> order(nodes_.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return nodes_[a].depth > nodes_[b].depth; });
+    
+    Hasher hasher(HashType::MD5);
+    
+    for (size_t index : order) {
+        Node& node = nodes_[index];
+        
+        if (!node.unique) {
+            std::sort(node.entries.begin(), node.entries.end());
+            
+            std::string data;
+            for (const auto& entry : node.entries) {
+                data += entry;
+                data += '\n';
+            }
+            node.digest = hasher.HashBlock(data.data(), data.size());
+        }
+        
+        if (node.parent == kNoParent) {
+            continue;
+        }
+        
+        Node& parent = nodes_[node.parent];
+        parent.bytes += node.bytes;
+        
+        if (node.unique) {
+            parent.unique = true;
+        } else {
+            parent.entries.push_back(Entry(node.path.filename(), 'd', node.digest));
+        }
+    }
+}
+
+DirectoryGroups DirectoryMatcher::Match(const SizeTable& table, const std::vector<std::vector<boost::filesystem::path>>& duplicates)
+{
+    TRACE_SPAN("directories");
+    nodes_.clear();
+    node_by_path_.clear();
+    
+    std::unordered_map<std::string, size_t> group_by_file;
+    for (size_t g = 0; g < duplicates.size(); ++g) {
+        for (const auto& file : duplicates[g]) {
+            group_by_file.emplace(file.string(), g);
+        }
+    }
+    
+    for (const auto& record : table.Records()) {
+        const boost::filesystem::path& file = table.File(record.file);
+        Node& node = nodes_[GetNode(file.parent_path())];
+        node.bytes += record.size;
+        
+        auto it = group_by_file.find(file.string());
+        if (it == group_by_file.end()) {
+            node.unique = true;
+            continue;
+        }
+        
+        // the size only makes the entries readable, the group alone is exact
+        node.entries.push_back(Entry(file.filename(), 'f', std::to_string(it->second) + ':' + std::to_string(record.size)));
+    }
+    
+    ComputeDigests();
+    
+    std::map<std::string, std::vector<size_t>> by_digest;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (!nodes_[i].unique && !nodes_[i].entries.empty()) {
+            by_digest[nodes_[i].digest].push_back(i);
+        }
+    }
+    
+    std::vector<bool> duplicated(nodes_.size(), false);
+    for (const auto& [digest, members] : by_digest) {
+        if (members.size() > 1) {
+            for (size_t member : members) {
+                duplicated[member] = true;
+            }
+        }
+    }
+    
+    // a group is implied by its parents when every member's parent is a duplicate itself
+    std::vector<std::vector<size_t>> reported;
+    std::vector<bool> copy(nodes_.size(), false);
+    
+    for (auto& [digest, members] : by_digest) {
+        if (members.size() < 2) {
+            continue;
+        }
+        
+        std::sort(members.begin(), members.end(), [this](size_t a, size_t b) { return nodes_[a].path < nodes_[b].path; });
+        
+        for (size_t i = 1; i < members.size(); ++i) {
+            copy[members[i]] = true;
+        }
+        
+        bool implied = std::all_of(members.begin(), members.end(), [this, &duplicated](size_t member) {
+            return nodes_[member].parent != kNoParent && duplicated[nodes_[member].parent];
+        });
+        
+        if (!implied) {
+            reported.push_back(members);
+        }
+    }
+    
+    std::sort(reported.begin(), reported.end(), [this](const auto& a, const auto& b) {
+        return nodes_[a.front()].path < nodes_[b.front()].path;
+    });
+    
+    DirectoryGroups result;
+    
+    for (const auto& members : reported) {
+        std::vector<boost::filesystem::path> paths;
+        for (size_t member : members) {
+            paths.emplace_back(nodes_[member].path.string() + boost::filesystem::path::preferred_separator);
+        }
+        result.directories.push_back(std::move(paths));
+        result.directory_sizes.push_back(nodes_[members.front()].bytes);
+    }
+    
+    // files below a second or later copy of a duplicate directory are already reported
+    std::vector<size_t> order(nodes_.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return nodes_[a].depth < nodes_[b].depth; });
+    
+    std::vector<bool> covered(nodes_.size(), false);
+    for (size_t index : order) {
+        size_t parent = nodes_[index].parent;
+        covered[index] = copy[index] || (parent != kNoParent && covered[parent]);
+    }
+    
+    for (const auto& group : duplicates) {
+        std::vector<boost::filesystem::path> kept;
+        
+        for (const auto& file : group) {
+            auto it = node_by_path_.find(file.parent_path().string());
+            if (it == node_by_path_.end() || !covered[it->second]) {
+                kept.push_back(file);
+            }
+        }
+        
+        if (kept.size() > 1) {
+            result.files.push_back(std::move(kept));
+        }
+    }
+    
+    return result;
+}
@@ -1,29 +1,161 @@
 #include "duplicate_finder.h"
+#include "checkpoint.h"
+#include "progress.h"
+#include "stats.h"
+#include "trace.h"
 
-DuplicateFinder::DuplicateFinder(std::unique_ptr<BlockCache> cache) : cache_(std::move(cache))
+DuplicateFinder::DuplicateFinder(std::unique_ptr<BlockCache> cache, size_t prefetch_blocks) : cache_(std::move(cache))
 {
     if (!cache_) {
         throw std::invalid_argument("BlockCache cannot be null");
     }
     
-    comparator_ = std::make_unique<Comparator>(*cache_);
+    comparator_ = std::make_unique<Comparator>(*cache_, prefetch_blocks);
 }
 
 std::vector<std::vector<boost::filesystem::path>> DuplicateFinder::Find(const std::map<uintmax_t, std::vector<boost::filesystem::path>>& groups)
 {
     std::vector<std::vector<boost::filesystem::path>> result;
     
+    for (const auto& [size, files] : groups) {
+        if (files.size() >= 2) {
+            Progress::AddGroups(1);
+            Progress::AddCandidateBytes(size * files.size());
+        }
+    }
+    
     for (const auto& [size, files] : groups) {
         if (files.size() < 2) {
             continue;
         }
+        
+        FindInGroup(size, files, result);
+    }
+    
+    return result;
+}
+
+std::vector<std::vector<boost::filesystem::path>> DuplicateFinder::Find(const SizeTable& table)
+{
+    std::vector<std::vector<boost::filesystem::path>> result;
+    
+    Find(table, [&result](std::vector<boost::filesystem::path>&& group) {
+        result.push_back(std::move(group));
+        return true;
+    });
+    
+    return result;
+}
 
-        auto duplicates = comparator_->FindDuplicates(files);
+bool DuplicateFinder::Find(const SizeTable& table, const GroupSink& sink)
+{
+    auto groups = table.Groups();
+    
+    for (const auto& group : groups) {
+        if (group.end - group.begin >= 2) {
+            Progress::AddGroups(1);
+            Progress::AddCandidateBytes(group.size * (group.end - group.begin));
+        }
+    }
+    
+    // paths are materialized one group at a time, only for the group being compared
+    for (const auto& group : groups) {
+        if (group.end - group.begin < 2) {
+            continue;
+        }
+        if (stop_ && stop_()) {
+            return false;
+        }
         
+        std::vector<std::vector<boost::filesystem::path>> duplicates;
+        FindInGroup(group.size, table.GroupFiles(group), duplicates);
+        if (comparator_->Interrupted()) {
+            return false;
+        }
+        
+        for (auto& duplicate : duplicates) {
+            if (!sink(std::move(duplicate))) {
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+void DuplicateFinder::FindInGroup(uintmax_t size, const std::vector<boost::filesystem::path>& files, std::vector<std::vector<boost::filesystem::path>>& result)
+{
+    TRACE_SPAN("size_group");
+    Stats::RecordSizeGroup(files.size());
+    
+    Checkpoint::Groups restored;
+    if (checkpoint_ && checkpoint_->Resolved(size, files, restored)) {
+        Progress::AddBytesSkipped(size * files.size());
+        Progress::AddGroupsResolved(1);
         result.insert(result.end(), 
-                     std::make_move_iterator(duplicates.begin()),
-                     std::make_move_iterator(duplicates.end()));
+                     std::make_move_iterator(restored.begin()),
+                     std::make_move_iterator(restored.end()));
+        return;
     }
     
-    return result;
+    uint64_t hashed_before = Progress::Snapshot().bytes_hashed;
+    auto duplicates = comparator_->FindDuplicates(files);
+    if (comparator_->Interrupted()) {
+        return;
+    }
+    
+    // bytes of files that dropped out early are never read, count them as resolved
+    uint64_t hashed = Progress::Snapshot().bytes_hashed - hashed_before;
+    uint64_t group_bytes = size * files.size();
+    Progress::AddBytesSkipped(group_bytes > hashed ? group_bytes - hashed : 0);
+    Progress::AddGroupsResolved(1);
+    
+    if (checkpoint_) {
+        checkpoint_->RecordGroup(size, files, duplicates);
+    }
+    
+    result.insert(result.end(), 
+                 std::make_move_iterator(duplicates.begin()),
+                 std::make_move_iterator(duplicates.end()));
+}
+
+const std::vector<std::vector<boost::filesystem::path>>& DuplicateFinder::SharedGroups() const
+{
+    return comparator_->SharedGroups();
+}
+
+void DuplicateFinder::ClearSharedGroups()
+{
+    comparator_->ClearSharedGroups();
+}
+
+std::string DuplicateFinder::Digest(const boost::filesystem::path& file)
+{
+    return cache_->GetFileDigest(file);
+}
+
+void DuplicateFinder::SetStopCondition(std::function<bool()> stop)
+{
+    stop_ = stop;
+    comparator_->SetStopCondition(std::move(stop));
+}
+
+BlockCache& DuplicateFinder::Cache()
+{
+    return *cache_;
+}
+
+size_t DuplicateFinder::MemoryUsage() const
+{
+    return cache_->MemoryUsage() + comparator_->MemoryUsage();
+}
+
+void DuplicateFinder::SetCheckpoint(Checkpoint* checkpoint)
+{
+    checkpoint_ = checkpoint;
+    if (checkpoint_) {
+        checkpoint_->Attach(*cache_);
+    } else {
+        cache_->SetDigestObserver(nullptr);
+    }
 }
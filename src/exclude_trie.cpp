@@ -0,0 +1,85 @@
+#include <algorithm>
+#include "exclude_trie.h"
+
+ExcludeTrie::ExcludeTrie(const std::vector<boost::filesystem::path>& excludes) : nodes_(1)
+{
+    for (const auto& exclude : excludes) {
+        size_t node = 0;
+        
+        for (const auto& component : Normalize(exclude)) {
+            const std::string& name = component.native();
+            if (name == ".") {
+                continue;
+            }
+            
+            auto& children = nodes_[node].children;
+            auto it = std::lower_bound(children.begin(), children.end(), name,
+                                       [](const auto& child, const std::string& key) { return child.first < key; });
+            
+            if (it != children.end() && it->first == name) {
+                node = it->second;
+                continue;
+            }
+            
+            size_t child = nodes_.size();
+            children.insert(it, {name, child});
+            nodes_.emplace_back();
+            node = child;
+        }
+        
+        nodes_[node].excluded = true;
+    }
+    
+    if (excludes.empty()) {
+        nodes_.clear();
+    }
+}
+
+boost::filesystem::path ExcludeTrie::Normalize(const boost::filesystem::path& path)
+{
+    return boost::filesystem::absolute(path).lexically_normal();
+}
+
+size_t ExcludeTrie::Start(const boost::filesystem::path& directory) const
+{
+    if (nodes_.empty()) {
+        return kOutside;
+    }
+    
+    size_t cursor = 0;
+    
+    for (const auto& component : Normalize(directory)) {
+        if (component.native() == ".") {
+            continue;
+        }
+        
+        cursor = Descend(cursor, component.native());
+        if (cursor == kOutside || Excluded(cursor)) {
+            break;
+        }
+    }
+    
+    return cursor;
+}
+
+size_t ExcludeTrie::Descend(size_t cursor, std::string_view component) const
+{
+    if (cursor == kOutside) {
+        return kOutside;
+    }
+    
+    const auto& children = nodes_[cursor].children;
+    auto it = std::lower_bound(children.begin(), children.end(), component,
+                               [](const auto& child, std::string_view key) { return std::string_view(child.first) < key; });
+    
+    if (it == children.end() || it->first != component) {
+        return kOutside;
+    }
+    
+    return it->second;
+}
+
+bool ExcludeTrie::Excluded(size_t cursor) const
+{
+    return cursor != kOutside && nodes_[cursor].excluded;
+}
@@ -0,0 +1,98 @@
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#include "extent_map.h"
+
+namespace
+{
+    constexpr size_t kExtentsPerCall = 64;
+    
+    constexpr uint32_t kUnstableExtentFlags = FIEMAP_EXTENT_UNKNOWN
+                                            | FIEMAP_EXTENT_DELALLOC
+                                            | FIEMAP_EXTENT_ENCODED
+                                            | FIEMAP_EXTENT_DATA_ENCRYPTED
+                                            | FIEMAP_EXTENT_NOT_ALIGNED
+                                            | FIEMAP_EXTENT_DATA_INLINE
+                                            | FIEMAP_EXTENT_DATA_TAIL;
+}
+
+std::vector<Extent> ReadExtents(int fd)
+{
+    std::vector<Extent> extents;
+    
+    std::vector<char> storage(sizeof(fiemap) + kExtentsPerCall * sizeof(fiemap_extent));
+    auto* map = reinterpret_cast<fiemap*>(storage.data());
+    
+    uint64_t start = 0;
+    
+    while (true) {
+        std::memset(storage.data(), 0, storage.size());
+        map->fm_start = start;
+        map->fm_length = FIEMAP_MAX_OFFSET - start;
+        map->fm_extent_count = kExtentsPerCall;
+        
+        if (::ioctl(fd, FS_IOC_FIEMAP, map) < 0) {
+            return {};
+        }
+        
+        if (map->fm_mapped_extents == 0) {
+            break;
+        }
+        
+        bool last = false;
+        for (uint32_t i = 0; i < map->fm_mapped_extents; ++i) {
+            const fiemap_extent& e = map->fm_extents[i];
+            extents.push_back({e.fe_logical, e.fe_physical, e.fe_length, e.fe_flags});
+            last = (e.fe_flags & FIEMAP_EXTENT_LAST) != 0;
+        }
+        
+        if (last) {
+            break;
+        }
+        
+        const Extent& tail = extents.back();
+        start = tail.logical + tail.length;
+    }
+    
+    return extents;
+}
+
+uint64_t PhysicalOffset(const std::vector<Extent>& extents, uint64_t logical)
+{
+    auto it = std::upper_bound(extents.begin(), extents.end(), logical,
+                               [](uint64_t value, const Extent& e) { return value < e.logical; });
+    
+    if (it == extents.begin()) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    
+    --it;
+    
+    if (logical >= it->logical + it->length) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    
+    return it->physical + (logical - it->logical);
+}
+
+std::string ExtentSignature(dev_t device, uint64_t size, const std::vector<Extent>& extents)
+{
+    if (extents.empty()) {
+        return {};
+    }
+    
+    std::string signature = std::to_string(device) + "/" + std::to_string(size);
+    
+    for (const auto& e : extents) {
+        if (e.flags & kUnstableExtentFlags) {
+            return {};
+        }
+        
+        signature += ":" + std::to_string(e.logical) + "," + std::to_string(e.physical) + "," + std::to_string(e.length);
+    }
+    
+    return signature;
+}
@@ -1,8 +1,32 @@
 #include <algorithm>  
+#include <array>
 #include <cctype>     
 #include "filter.h"
 #include <iostream>
 
+namespace
+{
+    const std::array<char, 256> kLowerTable = []() {
+        std::array<char, 256> table{};
+        for (int c = 0; c < 256; ++c) {
+            table[c] = static_cast<char>(std::tolower(c));
+        }
+        return table;
+    }();
+
+    bool HasWildcard(std::string_view s)
+    {
+        return s.find_first_of("*?") != std::string_view::npos;
+    }
+
+    void AddLength(std::vector<size_t>& lengths, size_t length)
+    {
+        if (std::find(lengths.begin(), lengths.end(), length) == lengths.end()) {
+            lengths.push_back(length);
+        }
+    }
+}
+
 Filter::Filter(const std::vector<std::string>& masks)
 {
     masks_.reserve(masks.size());
@@ -10,24 +34,88 @@ Filter::Filter(const std::vector<std::string>& masks)
     for (const auto& m : masks) {
         masks_.push_back(ToLower(m));
     }
+    
+    Compile();
+}
+
+// the sets hold views into masks_, so a copy has to rebuild them over its own strings
+Filter::Filter(const Filter& other) : masks_(other.masks_)
+{
+    Compile();
+}
+
+Filter& Filter::operator=(const Filter& other)
+{
+    if (this != &other) {
+        *this = Filter(other);
+    }
+    return *this;
+}
+
+void Filter::Compile()
+{
+    for (const std::string& mask : masks_) {
+        std::string_view view(mask);
+        
+        if (!view.empty() && view.find_first_not_of('*') == std::string_view::npos) {
+            match_all_ = true;
+        } else if (!HasWildcard(view)) {
+            exact_.insert(view);
+        } else if (view.front() == '*' && !HasWildcard(view.substr(1))) {
+            suffixes_.insert(view.substr(1));
+            AddLength(suffix_lengths_, view.size() - 1);
+        } else if (view.back() == '*' && !HasWildcard(view.substr(0, view.size() - 1))) {
+            prefixes_.insert(view.substr(0, view.size() - 1));
+            AddLength(prefix_lengths_, view.size() - 1);
+        } else {
+            wildcards_.push_back(view);
+        }
+    }
 }
 
-bool Filter::Match(const std::string& filename) const
+bool Filter::Match(std::string_view filename) const
 {
-    if (masks_.empty()) {
+    if (masks_.empty() || match_all_) {
         return true;
     }
 
-    std::string name = ToLower(filename);
+    if (filename.size() <= kMaxStackName) {
+        char buffer[kMaxStackName];
+        ToLower(filename, buffer);
+        return MatchLower(std::string_view(buffer, filename.size()));
+    }
+    
+    std::string name(filename.size(), '\0');
+    ToLower(filename, name.data());
+    return MatchLower(name);
+} 
+
+bool Filter::MatchLower(std::string_view name) const
+{
+    if (exact_.count(name) != 0) {
+        return true;
+    }
+    
+    for (size_t length : suffix_lengths_) {
+        if (length <= name.size() && suffixes_.count(name.substr(name.size() - length)) != 0) {
+            return true;
+        }
+    }
+    
+    for (size_t length : prefix_lengths_) {
+        if (length <= name.size() && prefixes_.count(name.substr(0, length)) != 0) {
+            return true;
+        }
+    }
 
-    for (const auto& mask : masks_) {
+    for (std::string_view mask : wildcards_) {
         if (MatchOne(name, mask)) {
             return true;
         }
     }
 
     return false;
-} 
+}
 
 std::string Filter::ToLower(const std::string& s)
 {
@@ -37,8 +125,15 @@ std::string Filter::ToLower(const std::string& s)
                    [](unsigned char c){ return std::tolower(c); });
     return r;
 }
+
+void Filter::ToLower(std::string_view s, char* out)
+{
+    for (size_t i = 0; i < s.size(); ++i) {
+        out[i] = kLowerTable[static_cast<unsigned char>(s[i])];
+    }
+}
  
-bool Filter::MatchOne(const std::string& name, const std::string& mask)
+bool Filter::MatchOne(std::string_view name, std::string_view mask)
 {
     size_t n = name.size();  
     size_t m = mask.size();  
@@ -72,4 +167,4 @@ bool Filter::MatchOne(const std::string& name, const std::string& mask)
     }
 
     return j == m;
-}
\ No newline at end of file
+}
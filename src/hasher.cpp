@@ -1,24 +1,259 @@
 #include <boost/crc.hpp>               
-#include <boost/uuid/detail/md5.hpp>   
 #include <sstream>                    
 #include <iomanip>                     
 #include <fstream>                     
 #include <vector>                    
 #include <cstring>                     
+#include <algorithm>
+#include <stdexcept>
 #include "hasher.h"
+#include "stats.h"
+#include "tree_hash.h"
+#include "worker_pool.h"
 
+namespace
+{
+    typedef uint32_t Md5Lanes __attribute__((vector_size(4 * Hasher::kLanes)));
+    
+    constexpr uint32_t kMd5Sines[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+    
+    constexpr int kMd5Shifts[4][4] = {{7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21}};
+    
+#define MD5_ROUND(f, round, a, b, c, d, x)                                              \
+    for (int i = 0; i < 16; i += 4) {                                                   \
+        int step = 16 * (round) + i;                                                    \
+        MD5_STEP(f, a, b, c, d, x[MD5_INDEX(round, i)], step, kMd5Shifts[round][0]);     \
+        MD5_STEP(f, d, a, b, c, x[MD5_INDEX(round, i + 1)], step + 1, kMd5Shifts[round][1]); \
+        MD5_STEP(f, c, d, a, b, x[MD5_INDEX(round, i + 2)], step + 2, kMd5Shifts[round][2]); \
+        MD5_STEP(f, b, c, d, a, x[MD5_INDEX(round, i + 3)], step + 3, kMd5Shifts[round][3]); \
+    }
+#define MD5_INDEX(round, i) ((round) == 0 ? (i) : (round) == 1 ? (1 + 5 * (i)) % 16 : (round) == 2 ? (5 + 3 * (i)) % 16 : (7 * (i)) % 16)
+#define MD5_STEP(f, a, b, c, d, x, step, s)        \
+    a += f(b, c, d) + (x) + kMd5Sines[step];     \
+    a = (a << (s)) | (a >> (32 - (s)));           \
+    a += b;
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+    
+    // One MD5 compression of a 64-byte chunk per lane. Word is uint32_t for a single
+    // message or Md5Lanes for kLanes independent ones, so both paths share this kernel.
+    template <typename Word>
+    void Md5Compress(Word state[4], const Word (&x)[16])
+    {
+        Word a = state[0], b = state[1], c = state[2], d = state[3];
+        MD5_ROUND(MD5_F, 0, a, b, c, d, x)
+        MD5_ROUND(MD5_G, 1, a, b, c, d, x)
+        MD5_ROUND(MD5_H, 2, a, b, c, d, x)
+        MD5_ROUND(MD5_I, 3, a, b, c, d, x)
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+    
+    // Pads a message of size bytes whose last size % 64 bytes start at rest: tail gets
+    // them, 0x80, zeros and the bit length. Returns the number of 64-byte chunks in tail.
+    size_t Md5Tail(const char* rest, size_t size, uint8_t (&tail)[128])
+    {
+        size_t left = size % 64;
+        size_t chunks = left < 56 ? 1 : 2;
+        
+        std::memset(tail, 0, sizeof(tail));
+        if (left > 0) {
+            std::memcpy(tail, rest, left);
+        }
+        tail[left] = 0x80;
+        
+        uint64_t bits = static_cast<uint64_t>(size) * 8;
+        for (size_t i = 0; i < 8; ++i) {
+            tail[chunks * 64 - 8 + i] = static_cast<uint8_t>(bits >> (8 * i));
+        }
+        return chunks;
+    }
+    
+    void Md5Words(const uint8_t* data, uint32_t (&words)[16])
+    {
+        for (size_t j = 0; j < 16; ++j) {
+            words[j] = uint32_t{data[4 * j]} | uint32_t{data[4 * j + 1]} << 8 |
+                       uint32_t{data[4 * j + 2]} << 16 | uint32_t{data[4 * j + 3]} << 24;
+        }
+    }
+    
+    // RFC 1321 byte order: the state words, least significant byte first
+    void Md5Digest(const uint32_t (&words)[4], uint8_t* digest)
+    {
+        for (size_t w = 0; w < 4; ++w) {
+            for (size_t i = 0; i < 4; ++i) {
+                digest[4 * w + i] = static_cast<uint8_t>(words[w] >> (8 * i));
+            }
+        }
+    }
+    
+    constexpr uint32_t kMd5Init[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    
+    void Md5Single(const char* data, size_t size, uint8_t* digest)
+    {
+        uint32_t state[4] = {kMd5Init[0], kMd5Init[1], kMd5Init[2], kMd5Init[3]};
+        uint32_t x[16];
+        size_t full = size / 64;
+        
+        for (size_t chunk = 0; chunk < full; ++chunk) {
+            Md5Words(reinterpret_cast<const uint8_t*>(data) + chunk * 64, x);
+            Md5Compress(state, x);
+        }
+        
+        uint8_t tail[128];
+        size_t chunks = Md5Tail(data + full * 64, size, tail);
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            Md5Words(tail + chunk * 64, x);
+            Md5Compress(state, x);
+        }
+        
+        Md5Digest(state, digest);
+    }
+    
+    // MD5 of up to kLanes messages at once: lane l runs the compression function over
+    // message l, one 64-byte chunk per iteration. Lanes whose message is shorter finish
+    // early and have their digest taken then, the rest of their work is discarded.
+    void Md5MultiBuffer(const BlockView* blocks, size_t count, uint8_t (*digests)[16])
+    {
+        size_t full[Hasher::kLanes] = {};
+        size_t total[Hasher::kLanes] = {};
+        uint8_t tails[Hasher::kLanes][128];
+        size_t chunks = 0;
+        
+        for (size_t l = 0; l < count; ++l) {
+            full[l] = blocks[l].size / 64;
+            total[l] = full[l] + Md5Tail(blocks[l].data + full[l] * 64, blocks[l].size, tails[l]);
+            chunks = std::max(chunks, total[l]);
+        }
+        
+        Md5Lanes state[4] = {};
+        for (size_t w = 0; w < 4; ++w) {
+            state[w] += kMd5Init[w];
+        }
+        
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            Md5Lanes x[16] = {};
+            
+            for (size_t l = 0; l < count; ++l) {
+                if (chunk >= total[l]) {
+                    continue;
+                }
+                
+                const uint8_t* data = chunk < full[l]
+                    ? reinterpret_cast<const uint8_t*>(blocks[l].data) + chunk * 64
+                    : tails[l] + (chunk - full[l]) * 64;
+                
+                uint32_t words[16];
+                Md5Words(data, words);
+                for (size_t j = 0; j < 16; ++j) {
+                    x[j][l] = words[j];
+                }
+            }
+            
+            Md5Compress(state, x);
+            
+            for (size_t l = 0; l < count; ++l) {
+                if (chunk + 1 == total[l]) {
+                    uint32_t words[4] = {state[0][l], state[1][l], state[2][l], state[3][l]};
+                    Md5Digest(words, digests[l]);
+                }
+            }
+        }
+    }
+    
+#undef MD5_ROUND
+#undef MD5_INDEX
+#undef MD5_STEP
+#undef MD5_F
+#undef MD5_G
+#undef MD5_H
+#undef MD5_I
+}
+
+Hasher::Hasher(HashType hash_type, size_t threads) : hash_type_(hash_type), threads_(threads)
+{
+    if (hash_type_ == HashType::SHA256Tree && threads_ > 1) {
+        tree_pool_ = std::make_unique<WorkerPool>(threads_ - 1);
+    }
+}
 
-Hasher::Hasher(HashType hash_type) : hash_type_(hash_type){}
+Hasher::~Hasher() {}
 
 std::string Hasher::HashBlock(const char* data, size_t size)
 {
     if (hash_type_ == HashType::CRC32) {
         return HashBlockCrc32(data, size);
+    } else if (hash_type_ == HashType::SHA256Tree) {
+        return HashBlockTree(data, size, threads_);
     } else {
         return HashBlockMd5(data, size);
     }
 }
 
+void Hasher::HashBlocks(const BlockView* blocks, size_t count, std::string* digests, size_t threads)
+{
+    size_t i = 0;
+    
+    if (hash_type_ == HashType::MD5) {
+        uint8_t raw[kLanes][16];
+        
+        // a single block gains nothing from the lanes
+        while (count - i > 1) {
+            size_t lanes = std::min(kLanes, count - i);
+            Md5MultiBuffer(blocks + i, lanes, raw);
+            for (size_t l = 0; l < lanes; ++l) {
+                digests[i + l] = BytesToHex(raw[l], sizeof(raw[l]));
+            }
+            i += lanes;
+        }
+    }
+    
+    for (; i < count; ++i) {
+        if (hash_type_ == HashType::SHA256Tree) {
+            digests[i] = HashBlockTree(blocks[i].data, blocks[i].size, threads);
+        } else {
+            digests[i] = HashBlock(blocks[i].data, blocks[i].size);
+        }
+    }
+}
+
+std::string Hasher::HashDigests(const std::vector<std::string>& digests)
+{
+    if (hash_type_ != HashType::SHA256Tree) {
+        std::string joined;
+        for (const auto& digest : digests) {
+            joined += digest;
+        }
+        return HashBlock(joined.data(), joined.size());
+    }
+    
+    std::vector<TreeHash::Node> nodes(digests.size());
+    for (size_t i = 0; i < digests.size(); ++i) {
+        if (digests[i].size() != 2 * nodes[i].size()) {
+            throw std::invalid_argument("Not a sha256tree digest: " + digests[i]);
+        }
+        for (size_t j = 0; j < nodes[i].size(); ++j) {
+            nodes[i][j] = static_cast<uint8_t>(std::stoul(digests[i].substr(2 * j, 2), nullptr, 16));
+        }
+    }
+    
+    TreeHash::Node root = TreeHash::Combine(nodes);
+    return BytesToHex(root.data(), root.size());
+}
+
 std::string Hasher::HashBlockCrc32(const char* data, size_t size)
 {
     boost::crc_32_type crc;
@@ -38,24 +273,36 @@ std::string Hasher::HashBlockCrc32(const char* data, size_t size)
 
 std::string Hasher::HashBlockMd5(const char* data, size_t size)
 {
-    boost::uuids::detail::md5 hash;
-    
-    hash.process_bytes(data, size);
+    uint8_t digest[16];
+    Md5Single(data, size, digest);
+    return BytesToHex(digest, sizeof(digest));
+}
+
+std::string Hasher::HashBlockTree(const char* data, size_t size, size_t threads)
+{
+    threads = std::min(threads, threads_);
     
-    boost::uuids::detail::md5::digest_type digest;
-    hash.get_digest(digest);
+    TreeHash::Node root;
+    std::unique_lock<std::mutex> lock(tree_mutex_, std::defer_lock);
+    if (threads > 1 && size >= TreeHash::kParallelMin && tree_pool_ && lock.try_lock()) {
+        Stats::Add(Counter::BlocksSplit);
+        root = TreeHash::Hash(data, size, threads, *tree_pool_);
+    } else {
+        root = TreeHash::Hash(data, size, 1);
+    }
     
-    return BytesToHex(reinterpret_cast<const uint8_t*>(&digest), sizeof(digest));
+    return BytesToHex(root.data(), root.size());
 }
 
 std::string Hasher::BytesToHex(const uint8_t* data, size_t size)
 {
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');  
+    static const char* hex = "0123456789abcdef";
+    std::string result(2 * size, '0');
     
     for (size_t i = 0; i < size; ++i) {
-        ss << std::setw(2) << static_cast<int>(data[i]);
+        result[2 * i] = hex[data[i] >> 4];
+        result[2 * i + 1] = hex[data[i] & 0x0F];
     }
     
-    return ss.str();
-}
\ No newline at end of file
+    return result;
+}
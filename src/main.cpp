@@ -1,10 +1,17 @@
 #include <iostream>           
 #include <exception>          
 #include "parser.h"           
+#include "progress.h"
 #include "scanner.h"          
 #include "hasher.h"      
 #include "block_cache.h"      
+#include "checkpoint.h"
 #include "duplicate_finder.h" 
+#include "reference_index.h"
+#include "shard_partial.h"
+#include "deduplicator.h"
+#include "stats.h"
+#include "trace.h"
 #include "utilities.h"
 
 int main(int argc, char* argv[])
@@ -14,21 +21,214 @@ int main(int argc, char* argv[])
         Parser parser;
         Config config = parser.Parse(argc, argv);
         
-		auto hasher = std::make_unique<Hasher>(config.hash_type);
-        auto cache = std::make_unique<BlockCache>(config.block_size, std::move(hasher));
-        auto duplicate_finder = std::make_unique<DuplicateFinder>(std::move(cache));
+        if (!config.trace_file.empty()) {
+#ifdef BAYAN_ENABLE_TRACE
+            Trace::Start();
+#else
+            std::cerr << "Warning: tracing was disabled at build time, --trace is ignored\n";
+#endif
+        }
         
-        Scanner scanner(config);
-        auto files = scanner.Scan();
+		auto hasher = std::make_unique<Hasher>(config.hash_type, config.io.ssd_threads);
+        auto cache = std::make_unique<BlockCache>(config.block_size, std::move(hasher), config.io);
+        auto duplicate_finder = std::make_unique<DuplicateFinder>(std::move(cache), config.prefetch_blocks);
         
-        auto duplicates = duplicate_finder->Find(files);
+        std::unique_ptr<ProgressReporter> progress;
+        if (config.progress || !config.progress_file.empty()) {
+            progress = std::make_unique<ProgressReporter>(config.progress, config.progress_file);
+        }
         
-        PrintResults(duplicates);
+        ReferenceIndex reference;
+        if (!config.reference_index.empty()) {
+            ScopedPhase phase("load_index");
+            TRACE_SPAN("load_index");
+            reference = ReferenceIndex::Load(config.reference_index);
+        }
         
-        return 0;
+        std::unique_ptr<Checkpoint> checkpoint;
+        if (!config.checkpoint.empty()) {
+            checkpoint = std::make_unique<Checkpoint>(config.checkpoint, config, config.resume);
+        }
+        
+        // directory matching, similarity modes, the reference index and partials need the unique files too
+        bool drop_singletons = !config.dirs && config.mode == AnalysisMode::Exact && config.build_index.empty() &&
+                               config.reference_index.empty() && config.partial.empty();
+        
+        SizeTable files;
+        if (checkpoint && checkpoint->HasScan()) {
+            ScopedPhase phase("scan");
+            TRACE_SPAN("restore_scan");
+            files = checkpoint->RestoreScan(drop_singletons);
+        } else if (config.merge.empty() && config.work.empty()) {
+            // merging partials and hashing a work list use what earlier runs recorded
+            ScopedPhase phase("scan");
+            TRACE_SPAN("scan");
+            Scanner scanner(config);
+            files = scanner.ScanTable(drop_singletons);
+            
+            if (checkpoint) {
+                checkpoint->RecordScan(files);
+            }
+        }
+        
+        if (checkpoint) {
+            duplicate_finder->SetCheckpoint(checkpoint.get());
+        }
+        
+        int status = 0;
+        
+        if (!config.merge.empty()) {
+            std::vector<ShardPartial> partials;
+            MergeResult result;
+            {
+                ScopedPhase phase("merge");
+                TRACE_SPAN("merge");
+                for (const auto& file : config.merge) {
+                    partials.push_back(ShardPartial::Load(file));
+                }
+                result = ShardPartial::Merge(partials);
+            }
+            
+            ScopedPhase phase("output");
+            TRACE_SPAN("output");
+            if (result.PendingFiles() == 0) {
+                WriteResults(result.duplicates, config.format);
+            } else {
+                for (size_t i = 0; i < partials.size(); ++i) {
+                    if (!result.work[i].empty()) {
+                        partials[i].SaveWork(config.merge[i] + ".work", result.work[i]);
+                        std::cerr << "bayan --partial " << config.merge[i] << " --work " << config.merge[i] << ".work\n";
+                    }
+                }
+                std::cerr << result.PendingFiles() << " files seen in several shards need hashing: run the commands above "
+                          << "on the machines the partials came from, then merge again\n";
+            }
+        } else if (!config.partial.empty()) {
+            ShardPartial partial;
+            {
+                ScopedPhase phase("compare");
+                TRACE_SPAN("compare");
+                if (!config.work.empty()) {
+                    partial = ShardPartial::Load(config.partial);
+                    partial.HashWork(ShardPartial::LoadWork(config.work), config.io.ssd_threads);
+                } else {
+                    partial = ShardPartial::FromScan(files, duplicate_finder->Find(files));
+                }
+            }
+            
+            progress.reset();
+            
+            ScopedPhase phase("output");
+            TRACE_SPAN("output");
+            partial.Save(config.partial);
+            std::cerr << "Wrote " << partial.Entries().size() << " files to " << config.partial << "\n";
+        } else if (!config.build_index.empty()) {
+            ReferenceIndex index;
+            {
+                ScopedPhase phase("index");
+                TRACE_SPAN("index");
+                index = ReferenceIndex::Build(files, config.io.ssd_threads);
+            }
+            
+            progress.reset();
+            
+            ScopedPhase phase("output");
+            TRACE_SPAN("output");
+            index.Save(config.build_index);
+            std::cerr << "Indexed " << index.Entries().size() << " files into " << config.build_index << "\n";
+        } else if (!config.reference_index.empty()) {
+            ReferenceReport report;
+            {
+                ScopedPhase phase("compare");
+                TRACE_SPAN("compare");
+                report = reference.Query(files, config.io.ssd_threads);
+            }
+            
+            progress.reset();
+            
+            ScopedPhase phase("output");
+            TRACE_SPAN("output");
+            WriteResults(report.matches, config.format);
+            std::cerr << report.matches.size() << " of " << report.files << " files are in the index; "
+                      << report.candidates << " had an indexed size, " << report.bytes_hashed << " bytes hashed, "
+                      << report.bytes_skipped << " skipped\n";
+        } else if (config.mode == AnalysisMode::Chunks) {
+            ChunkReport report;
+            {
+                ScopedPhase phase("chunk");
+                TRACE_SPAN("chunk");
+                ChunkIndex index(config.chunk_size, config.io.ssd_threads);
+                report = index.Analyze(files.Files(), config.similarity);
+            }
+            
+            progress.reset();
+            
+            ScopedPhase phase("output");
+            TRACE_SPAN("output");
+            WriteChunkReport(report, config.format);
+        } else if (config.mode == AnalysisMode::Similar) {
+            SimilarityReport report;
+            {
+                ScopedPhase phase("similar");
+                TRACE_SPAN("similar");
+                MinHashIndex index(config.chunk_size, config.io.ssd_threads);
+                report = index.Find(files.Files(), config.similarity);
+            }
+            
+            progress.reset();
+            
+            ScopedPhase phase("output");
+            TRACE_SPAN("output");
+            WriteSimilarityReport(report, config.format);
+        } else {
+            std::vector<std::vector<boost::filesystem::path>> duplicates;
+            {
+                ScopedPhase phase("compare");
+                TRACE_SPAN("compare");
+                duplicates = duplicate_finder->Find(files);
+            }
+            
+            progress.reset();
+            
+            if (config.action != DedupAction::None) {
+                ScopedPhase phase("action");
+                TRACE_SPAN("action");
+                Deduplicator deduplicator(config.action, config.dry_run, config.verify);
+                DedupReport report = deduplicator.Apply(duplicates);
+                
+                std::cerr << (config.dry_run ? "Would process " : "Processed ") << report.replaced
+                          << " files, " << report.bytes << " bytes, " << report.failed << " failed\n";
+                
+                status = report.failed == 0 ? 0 : 1;
+            } else {
+                ScopedPhase phase("output");
+                TRACE_SPAN("output");
+                std::function<std::string(const boost::filesystem::path&)> digest;
+                if (config.digests) {
+                    digest = [&duplicate_finder](const boost::filesystem::path& file) { return duplicate_finder->Digest(file); };
+                }
+                
+                if (config.dirs) {
+                    DirectoryMatcher matcher(config.include_dirs);
+                    WriteResults(matcher.Match(files, duplicates), config.format, digest);
+                } else {
+                    WriteResults(duplicates, config.format, digest);
+                }
+                PrintSharedGroups(duplicate_finder->SharedGroups());
+            }
+        }
+        
+        PrintStats(config.stats);
+        
+        if (Trace::Enabled()) {
+            Trace::Stop();
+            Trace::WriteChromeJson(config.trace_file);
+        }
+        
+        return status;
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
         return 1;
     }
-}
\ No newline at end of file
+}
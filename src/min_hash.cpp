@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_set>
+#include "min_hash.h"
+#include "parallel.h"
+#include "progress.h"
+#include "trace.h"
+
+namespace
+{
+    uint64_t Mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    
+    uint64_t HashChunk(const uint8_t* data, size_t size)
+    {
+        uint64_t hash = Mix(size);
+        size_t i = 0;
+        
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+            hash ^= hash >> 29;
+        }
+        
+        uint64_t tail = 0;
+        std::memcpy(&tail, data + i, size - i);
+        return Mix(hash ^ tail);
+    }
+}
+
+MinHashIndex::MinHashIndex(size_t average_chunk, size_t threads, size_t permutations)
+    : chunker_(average_chunk), threads_(threads)
+{
+    if (threads_ == 0) {
+        throw std::invalid_argument("Thread count must be greater than 0");
+    }
+    if (permutations == 0) {
+        throw std::invalid_argument("Permutation count must be greater than 0");
+    }
+    
+    uint64_t x = 0x243f6a8885a308d3ULL;
+    for (size_t i = 0; i < permutations; ++i) {
+        x += 0x9e3779b97f4a7c15ULL;
+        seeds_.push_back(Mix(x));
+    }
+}
+
+MinHashIndex::Signature MinHashIndex::Sign(const std::vector<uint64_t>& chunk_hashes) const
+{
+    if (chunk_hashes.empty()) {
+        return {};
+    }
+    
+    Signature signature(seeds_.size(), std::numeric_limits<uint64_t>::max());
+    for (uint64_t hash : chunk_hashes) {
+        for (size_t i = 0; i < seeds_.size(); ++i) {
+            signature[i] = std::min(signature[i], Mix(hash ^ seeds_[i]));
+        }
+    }
+    
+    return signature;
+}
+
+double MinHashIndex::Similarity(const Signature& a, const Signature& b)
+{
+    if (a.empty() || a.size() != b.size()) {
+        return 0;
+    }
+    
+    size_t equal = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        equal += a[i] == b[i] ? 1 : 0;
+    }
+    
+    return static_cast<double>(equal) / static_cast<double>(a.size());
+}
+
+std::pair<size_t, size_t> MinHashIndex::ChooseBands(size_t permutations, double threshold)
+{
+    // more rows per band mean fewer false candidates, so take the most rows that
+    // still find pairs at the threshold
+    for (size_t rows = permutations; rows > 1; --rows) {
+        size_t bands = permutations / rows;
+        double found = 1.0 - std::pow(1.0 - std::pow(threshold, static_cast<double>(rows)), static_cast<double>(bands));
+        if (found >= 0.95) {
+            return {bands, rows};
+        }
+    }
+    
+    return {permutations, 1};
+}
+
+MinHashIndex::Signature MinHashIndex::SignFile(const boost::filesystem::path& file) const
+{
+    TRACE_SPAN("sign_file");
+    
+    std::vector<uint64_t> hashes;
+    chunker_.ChunkFile(file, [&hashes](const uint8_t* data, size_t size) {
+        hashes.push_back(HashChunk(data, size));
+    });
+    
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    
+    return Sign(hashes);
+}
+
+SimilarityReport MinHashIndex::Find(const std::vector<boost::filesystem::path>& files, double min_percent)
+{
+    SimilarityReport report;
+    std::vector<Signature> signatures(files.size());
+    
+    for (const auto& file : files) {
+        boost::system::error_code ec;
+        uintmax_t size = boost::filesystem::file_size(file, ec);
+        if (!ec) {
+            Progress::AddCandidateBytes(size);
+        }
+    }
+    Progress::AddGroups(files.size());
+    
+    ParallelFor(files.size(), threads_, [&](size_t i) {
+        try {
+            signatures[i] = SignFile(files[i]);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error reading file " << files[i] << ", it is skipped: " << e.what() << "\n";
+        }
+        Progress::AddGroupsResolved(1);
+    });
+    
+    TRACE_SPAN("lsh");
+    
+    std::vector<uint32_t> signed_files;
+    for (size_t f = 0; f < files.size(); ++f) {
+        if (!signatures[f].empty()) {
+            signed_files.push_back(static_cast<uint32_t>(f));
+        }
+    }
+    report.files = signed_files.size();
+    
+    // one representative per signature, the first file in input order
+    std::stable_sort(signed_files.begin(), signed_files.end(), [&signatures](uint32_t x, uint32_t y) {
+        return signatures[x] < signatures[y];
+    });
+    
+    std::vector<uint32_t> representatives;
+    for (size_t begin = 0; begin < signed_files.size();) {
+        size_t end = begin + 1;
+        while (end < signed_files.size() && signatures[signed_files[end]] == signatures[signed_files[begin]]) {
+            ++end;
+        }
+        
+        representatives.push_back(signed_files[begin]);
+        if (end - begin > 1) {
+            std::vector<boost::filesystem::path> copies;
+            for (size_t i = begin; i < end; ++i) {
+                copies.push_back(files[signed_files[i]]);
+            }
+            report.copies.push_back(std::move(copies));
+        }
+        begin = end;
+    }
+    std::sort(representatives.begin(), representatives.end());
+    signed_files = std::move(representatives);
+    
+    double threshold = min_percent / 100.0;
+    auto [bands, rows] = ChooseBands(seeds_.size(), threshold);
+    
+    std::unordered_set<uint64_t> candidates;
+    std::vector<std::pair<uint64_t, uint32_t>> buckets(signed_files.size());
+    
+    for (size_t band = 0; band < bands; ++band) {
+        for (size_t i = 0; i < signed_files.size(); ++i) {
+            const Signature& signature = signatures[signed_files[i]];
+            uint64_t key = Mix(band);
+            for (size_t r = band * rows; r < (band + 1) * rows; ++r) {
+                key = Mix(key ^ signature[r]);
+            }
+            buckets[i] = {key, signed_files[i]};
+        }
+        
+        std::sort(buckets.begin(), buckets.end());
+        
+        for (size_t begin = 0; begin < buckets.size();) {
+            size_t end = begin + 1;
+            while (end < buckets.size() && buckets[end].first == buckets[begin].first) {
+                ++end;
+            }
+            for (size_t i = begin; i < end && end - begin <= kMaxBucket; ++i) {
+                for (size_t j = i + 1; j < end; ++j) {
+                    candidates.insert((static_cast<uint64_t>(buckets[i].second) << 32) | buckets[j].second);
+                }
+            }
+            begin = end;
+        }
+    }
+    
+    report.candidates = candidates.size();
+    
+    for (uint64_t key : candidates) {
+        size_t a = static_cast<size_t>(key >> 32);
+        size_t b = static_cast<size_t>(key & 0xFFFFFFFFu);
+        double percent = 100.0 * Similarity(signatures[a], signatures[b]);
+        
+        if (percent >= min_percent) {
+            report.similar.push_back({files[a], files[b], percent});
+        }
+    }
+    
+    std::sort(report.similar.begin(), report.similar.end(), [](const SimilarPair& x, const SimilarPair& y) {
+        if (x.percent != y.percent) {
+            return x.percent > y.percent;
+        }
+        return std::tie(x.first, x.second) < std::tie(y.first, y.second);
+    });
+    std::sort(report.copies.begin(), report.copies.end());
+    
+    return report;
+}
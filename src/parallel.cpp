@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "parallel.h"
+#include "progress.h"
+#include "worker_pool.h"
+
+void ParallelFor(size_t count, size_t threads, const std::function<void(size_t)>& body)
+{
+    std::atomic<size_t> next{0};
+    ProgressCounters* progress = &Progress::Current();
+    auto worker = [&]() {
+        Progress::Attach(progress);
+        for (size_t i = next++; i < count; i = next++) {
+            body(i);
+        }
+    };
+    
+    size_t thread_count = std::min(threads, std::max<size_t>(count, 1));
+    if (thread_count <= 1) {
+        worker();
+        return;
+    }
+    
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < thread_count; ++t) {
+        pool.emplace_back(worker);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+void ParallelFor(size_t count, size_t threads, const std::function<void(size_t)>& body, WorkerPool& pool)
+{
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            body(i);
+        }
+    };
+    
+    size_t helpers = std::min({threads, count, pool.Threads() + 1});
+    if (helpers <= 1) {
+        worker();
+        return;
+    }
+    
+    pool.Start(helpers - 1, [&worker](size_t) { worker(); });
+    try {
+        worker();
+    }
+    catch (...) {
+        pool.Wait();
+        throw;
+    }
+    pool.Wait();
+}
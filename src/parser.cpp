@@ -16,14 +16,129 @@ HashType Parser::ParseHashType(const std::string& str)
         return HashType::CRC32;
     } else if (lower == "md5") {
         return HashType::MD5;
+    } else if (lower == "sha256tree") {
+        return HashType::SHA256Tree;
     }
     
-    throw std::runtime_error("Unknown hash type: " + str + ". Supported: crc32, md5");
+    throw std::runtime_error("Unknown hash type: " + str + ". Supported: crc32, md5, sha256tree");
+}
+
+IoMode Parser::ParseIoMode(const std::string& str)
+{
+    std::string lower = str;
+    
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    
+    if (lower == "buffered") {
+        return IoMode::Buffered;
+    } else if (lower == "direct") {
+        return IoMode::Direct;
+    }
+    
+    throw std::runtime_error("Unknown I/O mode: " + str + ". Supported: buffered, direct");
+}
+
+IoSchedule Parser::ParseIoSchedule(const std::string& str)
+{
+    std::string lower = str;
+    
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    
+    if (lower == "auto") {
+        return IoSchedule::Auto;
+    } else if (lower == "path") {
+        return IoSchedule::Path;
+    } else if (lower == "physical") {
+        return IoSchedule::Physical;
+    }
+    
+    throw std::runtime_error("Unknown I/O schedule: " + str + ". Supported: auto, path, physical");
+}
+
+DedupAction Parser::ParseDedupAction(const std::string& str)
+{
+    std::string lower = str;
+    
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    
+    if (lower == "none") {
+        return DedupAction::None;
+    } else if (lower == "hardlink") {
+        return DedupAction::Hardlink;
+    } else if (lower == "reflink") {
+        return DedupAction::Reflink;
+    } else if (lower == "dedupe") {
+        return DedupAction::Dedupe;
+    } else if (lower == "delete") {
+        return DedupAction::Delete;
+    }
+    
+    throw std::runtime_error("Unknown action: " + str + ". Supported: none, hardlink, reflink, dedupe, delete");
+}
+
+OutputFormat Parser::ParseOutputFormat(const std::string& str)
+{
+    std::string lower = str;
+    
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    
+    if (lower == "text") {
+        return OutputFormat::Text;
+    } else if (lower == "json") {
+        return OutputFormat::Json;
+    } else if (lower == "jsonl") {
+        return OutputFormat::JsonLines;
+    } else if (lower == "binary") {
+        return OutputFormat::Binary;
+    }
+    
+    throw std::runtime_error("Unknown output format: " + str + ". Supported: text, json, jsonl, binary");
+}
+
+StatsFormat Parser::ParseStatsFormat(const std::string& str)
+{
+    std::string lower = str;
+    
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    
+    if (lower == "none") {
+        return StatsFormat::None;
+    } else if (lower == "text") {
+        return StatsFormat::Text;
+    } else if (lower == "json") {
+        return StatsFormat::Json;
+    }
+    
+    throw std::runtime_error("Unknown stats format: " + str + ". Supported: text, json");
+}
+
+AnalysisMode Parser::ParseAnalysisMode(const std::string& str)
+{
+    std::string lower = str;
+    
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    
+    if (lower == "exact") {
+        return AnalysisMode::Exact;
+    } else if (lower == "chunks") {
+        return AnalysisMode::Chunks;
+    } else if (lower == "similar") {
+        return AnalysisMode::Similar;
+    }
+    
+    throw std::runtime_error("Unknown mode: " + str + ". Supported: exact, chunks, similar");
 }
 
 Config Parser::Parse(int argc, char* argv[])
 {
     Config config;
+    bool no_verify = false;
     
     po::options_description desc("Utility for finding duplicate files\nAllowed options");
     
@@ -50,7 +165,82 @@ Config Parser::Parse(int argc, char* argv[])
          "block size for reading files")
 
         ("hash", po::value<std::string>()->default_value("crc32"),
-         "hash algorithm: crc32 or md5")
+         "hash algorithm: crc32, md5 or sha256tree (SHA-256 Merkle tree, needs a --block of 1 KiB times a power of two)")
+
+        ("io", po::value<std::string>()->default_value("buffered"),
+         "I/O mode: buffered or direct (bypasses the page cache)")
+
+        ("schedule", po::value<std::string>()->default_value("auto"),
+         "read order within a round: auto, path or physical (auto = physical on rotational disks)")
+
+        ("io-threads", po::value<size_t>(&config.io.ssd_threads)->default_value(8),
+         "concurrent reads per solid-state device")
+
+        ("hdd-threads", po::value<size_t>(&config.io.hdd_threads)->default_value(1),
+         "concurrent reads per rotational device")
+
+        ("prefetch", po::value<size_t>(&config.prefetch_blocks)->default_value(4),
+         "blocks to prefetch ahead for candidate files (0 = disabled)")
+
+        ("action", po::value<std::string>()->default_value("none"),
+         "action on duplicates, the first file of a group is kept: none, hardlink, reflink, dedupe or delete")
+
+        ("dry-run", po::bool_switch(&config.dry_run),
+         "only print what --action would do")
+
+        ("no-verify", po::bool_switch(&no_verify),
+         "let --action replace or delete files on matching hashes alone, without a byte-for-byte comparison (not with --hash crc32)")
+
+        ("format", po::value<std::string>()->default_value("text"),
+         "output format: text, json, jsonl or binary")
+
+        ("digests", po::bool_switch(&config.digests),
+         "include a whole-file digest per group (json, jsonl, binary)")
+
+        ("stats", po::value<std::string>()->default_value("none")->implicit_value("text"),
+         "print run statistics to stderr: text or json")
+
+        ("trace", po::value<std::string>(&config.trace_file),
+         "write a Chrome trace (Perfetto) of phases and I/O to the file")
+
+        ("progress", po::bool_switch(&config.progress),
+         "show scan rate, hashing throughput and ETA on stderr")
+
+        ("progress-file", po::value<std::string>(&config.progress_file),
+         "rewrite the file with the progress as JSON every second")
+
+        ("dirs", po::bool_switch(&config.dirs),
+         "report identical directory trees once instead of every file inside them")
+
+        ("mode", po::value<std::string>()->default_value("exact"),
+         "analysis: exact (identical files), chunks (files sharing content-defined chunks) or similar (near-duplicates by MinHash)")
+
+        ("chunk-size", po::value<size_t>(&config.chunk_size)->default_value(8192),
+         "average chunk size for --mode chunks and similar, a power of two")
+
+        ("similarity", po::value<double>(&config.similarity)->default_value(50.0),
+         "minimum share of content (chunks) or estimated Jaccard similarity (similar) in percent for a pair to be reported")
+
+        ("build-index", po::value<std::string>(&config.build_index),
+         "hash every scanned file into a reference index file instead of searching duplicates")
+
+        ("index", po::value<std::string>(&config.reference_index),
+         "report scanned files whose content is already in the reference index")
+
+        ("partial", po::value<std::string>(&config.partial),
+         "write this shard's sizes and local duplicates to a partial file for --merge")
+
+        ("work", po::value<std::string>(&config.work),
+         "hash the files of a work list produced by --merge into the --partial file, no scan")
+
+        ("merge", po::value<std::vector<std::string>>(&config.merge)->multitoken(),
+         "merge partial files: print duplicates or write follow-up work lists next to them")
+
+        ("checkpoint", po::value<std::string>(&config.checkpoint),
+         "journal the scan, block digests and resolved groups to a file, synced every few seconds")
+
+        ("resume", po::bool_switch(&config.resume),
+         "continue from the --checkpoint file, re-checking files by size and mtime")
     ;
     
     po::positional_options_description positional;
@@ -94,6 +284,47 @@ Config Parser::Parse(int argc, char* argv[])
         }
         
         config.hash_type = ParseHashType(vm["hash"].as<std::string>());
+        config.io.mode = ParseIoMode(vm["io"].as<std::string>());
+        config.io.schedule = ParseIoSchedule(vm["schedule"].as<std::string>());
+        config.action = ParseDedupAction(vm["action"].as<std::string>());
+        config.verify = !no_verify;
+        config.format = ParseOutputFormat(vm["format"].as<std::string>());
+        config.stats = ParseStatsFormat(vm["stats"].as<std::string>());
+        config.mode = ParseAnalysisMode(vm["mode"].as<std::string>());
+        
+        if (config.mode != AnalysisMode::Exact && config.format == OutputFormat::Binary) {
+            throw std::runtime_error("Binary output is only supported for --mode exact");
+        }
+        
+        if (config.mode != AnalysisMode::Exact && (config.action != DedupAction::None || config.dirs)) {
+            throw std::runtime_error("--action and --dirs are only supported for --mode exact");
+        }
+        
+        // a 32-bit block hash is too weak to delete or replace files on
+        bool destructive = config.action == DedupAction::Hardlink || config.action == DedupAction::Reflink ||
+                           config.action == DedupAction::Delete;
+        if (destructive && !config.verify && config.hash_type == HashType::CRC32) {
+            throw std::runtime_error("--no-verify cannot be used with --hash crc32 for this --action");
+        }
+        
+        int runs = (config.build_index.empty() ? 0 : 1) + (config.reference_index.empty() ? 0 : 1) +
+                   (config.partial.empty() ? 0 : 1) + (config.merge.empty() ? 0 : 1);
+        if (runs > 1) {
+            throw std::runtime_error("--build-index, --index, --partial and --merge cannot be used together");
+        }
+        if (runs > 0 && (config.mode != AnalysisMode::Exact || config.action != DedupAction::None || config.dirs)) {
+            throw std::runtime_error("--build-index, --index, --partial and --merge cannot be combined with --mode, --action or --dirs");
+        }
+        if (!config.work.empty() && config.partial.empty()) {
+            throw std::runtime_error("--work needs the --partial file it belongs to");
+        }
+        
+        if (!config.checkpoint.empty() && (runs > 0 || config.mode != AnalysisMode::Exact)) {
+            throw std::runtime_error("--checkpoint is only supported for --mode exact searches");
+        }
+        if (config.resume && config.checkpoint.empty()) {
+            throw std::runtime_error("--resume needs the --checkpoint file to continue from");
+        }
         
         if (!config.Validate()) {
             throw std::runtime_error("Invalid configuration");
@@ -0,0 +1,85 @@
+#include <limits>
+#include <stdexcept>
+#include "path_tree.h"
+
+uint32_t PathTree::Add(uint32_t parent, std::string_view name)
+{
+    if (nodes_.size() >= kRoot || names_.size() + name.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many paths for the path tree");
+    }
+    if (parent != kRoot && parent >= nodes_.size()) {
+        throw std::out_of_range("Unknown parent node");
+    }
+
+    nodes_.push_back({parent, static_cast<uint32_t>(names_.size()), static_cast<uint32_t>(name.size())});
+    names_.append(name);
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+boost::filesystem::path PathTree::Path(uint32_t node) const
+{
+    return boost::filesystem::path(String(node));
+}
+
+std::string PathTree::String(uint32_t node) const
+{
+    std::vector<uint32_t> chain;
+    for (uint32_t current = node; current != kRoot; current = Parent(current)) {
+        chain.push_back(current);
+    }
+
+    std::string result;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        if (!result.empty() && result.back() != '/') {
+            result += '/';
+        }
+        result += Name(*it);
+    }
+
+    return result;
+}
+
+uint32_t PathTree::Parent(uint32_t node) const
+{
+    return nodes_.at(node).parent;
+}
+
+std::string_view PathTree::Name(uint32_t node) const
+{
+    const Node& entry = nodes_.at(node);
+    return std::string_view(names_).substr(entry.offset, entry.length);
+}
+
+size_t PathTree::Size() const
+{
+    return nodes_.size();
+}
+
+void PathTree::ShrinkToFit()
+{
+    nodes_.shrink_to_fit();
+    names_.shrink_to_fit();
+}
+
+size_t PathTree::MemoryUsage() const
+{
+    return nodes_.capacity() * sizeof(Node) + names_.capacity();
+}
+
+uint32_t PathTree::Copy(const PathTree& other, uint32_t node, std::vector<uint32_t>& remap)
+{
+    if (remap.size() < other.Size()) {
+        remap.resize(other.Size(), kRoot);
+    }
+    if (remap[node] != kRoot) {
+        return remap[node];
+    }
+
+    uint32_t parent = other.Parent(node);
+    if (parent != kRoot) {
+        parent = Copy(other, parent, remap);
+    }
+
+    remap[node] = Add(parent, other.Name(node));
+    return remap[node];
+}
@@ -0,0 +1,205 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include "progress.h"
+
+ProgressCounters Progress::global_;
+thread_local ProgressCounters* Progress::current_ = nullptr;
+
+namespace
+{
+    struct Rates
+    {
+        double entries_per_second;
+        double bytes_per_second;
+        uint64_t remaining_bytes;
+        double eta_seconds;
+    };
+
+    Rates ComputeRates(const ProgressSnapshot& now, const ProgressSnapshot& previous, double interval_seconds)
+    {
+        Rates rates{};
+        
+        if (interval_seconds > 0) {
+            rates.entries_per_second = static_cast<double>(now.entries - previous.entries) / interval_seconds;
+            rates.bytes_per_second = static_cast<double>(now.bytes_hashed - previous.bytes_hashed) / interval_seconds;
+        }
+        
+        uint64_t done = now.bytes_hashed + now.bytes_skipped;
+        rates.remaining_bytes = now.candidate_bytes > done ? now.candidate_bytes - done : 0;
+        
+        // resolved bytes include skipped tails of files that dropped out, they also shorten the ETA
+        double resolved_per_second = interval_seconds > 0
+            ? static_cast<double>(done - previous.bytes_hashed - previous.bytes_skipped) / interval_seconds
+            : 0;
+        rates.eta_seconds = resolved_per_second > 0 ? static_cast<double>(rates.remaining_bytes) / resolved_per_second : -1;
+        
+        return rates;
+    }
+
+    std::string FormatBytes(double bytes)
+    {
+        static const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB", "PiB"};
+        size_t unit = 0;
+        
+        while (bytes >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+            bytes /= 1024;
+            ++unit;
+        }
+        
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.1f %s", bytes, units[unit]);
+        return text;
+    }
+
+    std::string FormatDuration(double seconds)
+    {
+        if (seconds < 0) {
+            return "--:--:--";
+        }
+        
+        uint64_t total = static_cast<uint64_t>(seconds + 0.5);
+        char text[32];
+        std::snprintf(text, sizeof(text), "%02llu:%02llu:%02llu",
+                      static_cast<unsigned long long>(total / 3600),
+                      static_cast<unsigned long long>(total / 60 % 60),
+                      static_cast<unsigned long long>(total % 60));
+        return text;
+    }
+}
+
+ProgressSnapshot ProgressCounters::Snapshot() const
+{
+    ProgressSnapshot snapshot;
+    snapshot.entries = entries.load(std::memory_order_relaxed);
+    snapshot.candidate_bytes = candidate_bytes.load(std::memory_order_relaxed);
+    snapshot.bytes_hashed = bytes_hashed.load(std::memory_order_relaxed);
+    snapshot.bytes_skipped = bytes_skipped.load(std::memory_order_relaxed);
+    snapshot.groups_total = groups_total.load(std::memory_order_relaxed);
+    snapshot.groups_resolved = groups_resolved.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void ProgressCounters::Reset()
+{
+    entries = 0;
+    candidate_bytes = 0;
+    bytes_hashed = 0;
+    bytes_skipped = 0;
+    groups_total = 0;
+    groups_resolved = 0;
+}
+
+ProgressSnapshot Progress::Snapshot()
+{
+    return Current().Snapshot();
+}
+
+void Progress::Reset()
+{
+    Current().Reset();
+}
+
+ProgressReporter::ProgressReporter(bool to_stderr, std::string status_file, std::chrono::milliseconds interval)
+    : to_stderr_(to_stderr), tty_(::isatty(STDERR_FILENO) != 0), status_file_(std::move(status_file)), interval_(interval)
+{
+    if (to_stderr_ || !status_file_.empty()) {
+        ticker_ = std::thread(&ProgressReporter::Run, this);
+    }
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    
+    if (ticker_.joinable()) {
+        ticker_.join();
+    }
+}
+
+void ProgressReporter::Run()
+{
+    ProgressSnapshot previous = Progress::Snapshot();
+    auto previous_time = std::chrono::steady_clock::now();
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (true) {
+        bool stopping = wake_.wait_for(lock, interval_, [this]() { return stop_; });
+        
+        auto now_time = std::chrono::steady_clock::now();
+        ProgressSnapshot now = Progress::Snapshot();
+        std::chrono::duration<double> elapsed = now_time - previous_time;
+        
+        Report(now, previous, elapsed.count(), stopping);
+        
+        if (stopping) {
+            break;
+        }
+        
+        previous = now;
+        previous_time = now_time;
+    }
+}
+
+void ProgressReporter::Report(const ProgressSnapshot& now, const ProgressSnapshot& previous, double interval_seconds, bool final)
+{
+    if (to_stderr_) {
+        std::string line = FormatLine(now, previous, interval_seconds);
+        
+        if (tty_) {
+            std::cerr << "\r\033[K" << line << (final ? "\n" : "") << std::flush;
+        } else {
+            std::cerr << line << "\n";
+        }
+    }
+    
+    if (!status_file_.empty()) {
+        std::string temp = status_file_ + ".tmp";
+        {
+            std::ofstream out(temp, std::ios::trunc);
+            out << FormatJson(now, previous, interval_seconds);
+        }
+        std::rename(temp.c_str(), status_file_.c_str());
+    }
+}
+
+std::string ProgressReporter::FormatLine(const ProgressSnapshot& now, const ProgressSnapshot& previous, double interval_seconds)
+{
+    Rates rates = ComputeRates(now, previous, interval_seconds);
+    
+    char text[256];
+    std::snprintf(text, sizeof(text), "scanned %llu (%.0f/s) | hashed %s of %s (%s/s) | groups %llu/%llu | ETA %s",
+                  static_cast<unsigned long long>(now.entries), rates.entries_per_second,
+                  FormatBytes(static_cast<double>(now.bytes_hashed)).c_str(),
+                  FormatBytes(static_cast<double>(now.candidate_bytes)).c_str(),
+                  FormatBytes(rates.bytes_per_second).c_str(),
+                  static_cast<unsigned long long>(now.groups_resolved),
+                  static_cast<unsigned long long>(now.groups_total),
+                  FormatDuration(rates.eta_seconds).c_str());
+    return text;
+}
+
+std::string ProgressReporter::FormatJson(const ProgressSnapshot& now, const ProgressSnapshot& previous, double interval_seconds)
+{
+    Rates rates = ComputeRates(now, previous, interval_seconds);
+    
+    char text[512];
+    std::snprintf(text, sizeof(text),
+                  "{\"entries\":%llu,\"entries_per_second\":%.1f,\"candidate_bytes\":%llu,\"bytes_hashed\":%llu,"
+                  "\"bytes_per_second\":%.1f,\"remaining_bytes\":%llu,\"groups_total\":%llu,\"groups_resolved\":%llu,"
+                  "\"eta_seconds\":%.0f}\n",
+                  static_cast<unsigned long long>(now.entries), rates.entries_per_second,
+                  static_cast<unsigned long long>(now.candidate_bytes),
+                  static_cast<unsigned long long>(now.bytes_hashed), rates.bytes_per_second,
+                  static_cast<unsigned long long>(rates.remaining_bytes),
+                  static_cast<unsigned long long>(now.groups_total),
+                  static_cast<unsigned long long>(now.groups_resolved),
+                  rates.eta_seconds);
+    return text;
+}
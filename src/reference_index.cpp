@@ -0,0 +1,355 @@
+#include <boost/uuid/detail/md5.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "reference_index.h"
+#include "binary_io.h"
+#include "parallel.h"
+#include "progress.h"
+#include "stats.h"
+#include "trace.h"
+
+namespace
+{
+    using Md5 = boost::uuids::detail::md5;
+    
+    const char kMagic[4] = {'B', 'A', 'Y', 'I'};
+    
+    ReferenceIndex::Digest Finish(Md5 md5)
+    {
+        Md5::digest_type raw;
+        md5.get_digest(raw);
+        
+        ReferenceIndex::Digest digest;
+        std::memcpy(digest.data(), &raw, digest.size());
+        return digest;
+    }
+}
+
+std::vector<uintmax_t> ReferenceIndex::PrefixOffsets(uintmax_t size)
+{
+    std::vector<uintmax_t> offsets;
+    for (uintmax_t offset = kFirstPrefix; offset < size; offset *= kPrefixGrowth) {
+        offsets.push_back(offset);
+    }
+    return offsets;
+}
+
+size_t ReferenceIndex::Levels(uintmax_t size)
+{
+    return PrefixOffsets(size).size() + 1;
+}
+
+std::vector<ReferenceIndex::Digest> ReferenceIndex::ProgressiveDigests(const boost::filesystem::path& file, uintmax_t size, size_t levels)
+{
+    std::vector<Digest> digests;
+    if (levels == 0) {
+        return digests;
+    }
+    
+    Digest digest;
+    uintmax_t bytes_read = 0;
+    bool complete = HashFile(file, size, [&digests, levels](size_t, const Digest& prefix) {
+        digests.push_back(prefix);
+        return digests.size() < levels;
+    }, digest, bytes_read);
+    
+    if (complete) {
+        digests.push_back(digest);
+    }
+    
+    return digests;
+}
+
+bool ReferenceIndex::HashFile(const boost::filesystem::path& file, uintmax_t size,
+                              const std::function<bool(size_t, const Digest&)>& on_prefix, Digest& digest, uintmax_t& bytes_read)
+{
+    TRACE_SPAN("index_file");
+    
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + file.string() + ": " + std::strerror(errno));
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    
+    std::vector<uintmax_t> offsets = PrefixOffsets(size);
+    std::vector<char> buffer(kReadSize);
+    Md5 md5;
+    uintmax_t done = 0;
+    size_t next_prefix = 0;
+    
+    while (true) {
+        // reads stop at the next prefix offset so its digest can be taken
+        uintmax_t limit = next_prefix < offsets.size() ? offsets[next_prefix] : size + 1;
+        size_t want = static_cast<size_t>(std::min<uintmax_t>(buffer.size(), limit - done));
+        
+        ssize_t n = ::read(fd, buffer.data(), want);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Read failed for " + file.string() + ": " + std::strerror(error));
+        }
+        if (n == 0) {
+            break;
+        }
+        
+        md5.process_bytes(buffer.data(), static_cast<size_t>(n));
+        done += static_cast<uintmax_t>(n);
+        bytes_read += static_cast<uintmax_t>(n);
+        Stats::Add(Counter::BytesRead, static_cast<uint64_t>(n));
+        Progress::AddBytesHashed(static_cast<uint64_t>(n));
+        
+        if (next_prefix < offsets.size() && done == offsets[next_prefix]) {
+            if (!on_prefix(next_prefix, Finish(md5))) {
+                ::close(fd);
+                return false;
+            }
+            ++next_prefix;
+        }
+    }
+    
+    ::close(fd);
+    
+    if (done != size) {
+        throw std::runtime_error("File " + file.string() + " changed size while being hashed");
+    }
+    
+    digest = Finish(md5);
+    return true;
+}
+
+ReferenceIndex ReferenceIndex::Build(const SizeTable& table, size_t threads)
+{
+    const auto& records = table.Records();
+    std::vector<Entry> entries(records.size());
+    // one byte per entry, the workers write neighbouring flags concurrently
+    std::vector<uint8_t> ok(records.size(), 0);
+    
+    for (const auto& record : records) {
+        Progress::AddCandidateBytes(record.size);
+    }
+    Progress::AddGroups(records.size());
+    
+    ParallelFor(records.size(), threads, [&](size_t i) {
+        Entry& entry = entries[i];
+        entry.size = records[i].size;
+        entry.file = table.File(records[i].file);
+        
+        try {
+            uintmax_t bytes_read = 0;
+            HashFile(entry.file, entry.size, [&entry](size_t, const Digest& digest) {
+                entry.prefixes.push_back(digest);
+                return true;
+            }, entry.digest, bytes_read);
+            ok[i] = 1;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error reading file " << entry.file << ", it is skipped: " << e.what() << "\n";
+        }
+        Progress::AddGroupsResolved(1);
+    });
+    
+    ReferenceIndex index;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (ok[i]) {
+            index.entries_.push_back(std::move(entries[i]));
+        }
+    }
+    
+    // the table is already sorted by size, the sort only guards direct callers
+    std::stable_sort(index.entries_.begin(), index.entries_.end(), [](const Entry& a, const Entry& b) {
+        return a.size < b.size;
+    });
+    
+    return index;
+}
+
+void ReferenceIndex::Save(const boost::filesystem::path& file) const
+{
+    std::string out(kMagic, sizeof(kMagic));
+    PutInteger<uint32_t>(out, kVersion);
+    PutInteger<uint64_t>(out, entries_.size());
+    
+    for (const auto& entry : entries_) {
+        std::string path = entry.file.string();
+        PutInteger<uint64_t>(out, entry.size);
+        PutInteger<uint32_t>(out, path.size());
+        out += path;
+        PutInteger<uint8_t>(out, entry.prefixes.size());
+        for (const auto& prefix : entry.prefixes) {
+            out.append(reinterpret_cast<const char*>(prefix.data()), prefix.size());
+        }
+        out.append(reinterpret_cast<const char*>(entry.digest.data()), entry.digest.size());
+    }
+    
+    // written next to the target and renamed, so a failed run never leaves half an index
+    boost::filesystem::path tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream stream(tmp.string(), std::ios::binary | std::ios::trunc);
+        stream.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!stream) {
+            throw std::runtime_error("Cannot write reference index " + tmp.string());
+        }
+    }
+    boost::filesystem::rename(tmp, file);
+}
+
+ReferenceIndex ReferenceIndex::Load(const boost::filesystem::path& file)
+{
+    std::ifstream stream(file.string(), std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("Cannot open reference index " + file.string());
+    }
+    std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    
+    BinaryReader reader(data, "Reference index " + file.string());
+    if (reader.Bytes(sizeof(kMagic)) != std::string(kMagic, sizeof(kMagic))) {
+        throw std::runtime_error(file.string() + " is not a bayan reference index");
+    }
+    uint32_t version = reader.Get<uint32_t>();
+    if (version != kVersion) {
+        throw std::runtime_error("Unsupported reference index version " + std::to_string(version) + " in " + file.string());
+    }
+    
+    ReferenceIndex index;
+    uint64_t count = reader.Get<uint64_t>();
+    index.entries_.reserve(static_cast<size_t>(std::min<uint64_t>(count, data.size())));
+    
+    for (uint64_t i = 0; i < count; ++i) {
+        Entry entry;
+        entry.size = reader.Get<uint64_t>();
+        entry.file = reader.Bytes(reader.Get<uint32_t>());
+        
+        uint8_t prefixes = reader.Get<uint8_t>();
+        if (prefixes != PrefixOffsets(entry.size).size()) {
+            throw std::runtime_error("Reference index " + file.string() + " is corrupted");
+        }
+        for (uint8_t p = 0; p < prefixes; ++p) {
+            std::string bytes = reader.Bytes(sizeof(Digest));
+            Digest digest;
+            std::memcpy(digest.data(), bytes.data(), digest.size());
+            entry.prefixes.push_back(digest);
+        }
+        std::string bytes = reader.Bytes(sizeof(Digest));
+        std::memcpy(entry.digest.data(), bytes.data(), entry.digest.size());
+        
+        if (!index.entries_.empty() && index.entries_.back().size > entry.size) {
+            throw std::runtime_error("Reference index " + file.string() + " is not sorted by size");
+        }
+        index.entries_.push_back(std::move(entry));
+    }
+    
+    return index;
+}
+
+const std::vector<ReferenceIndex::Entry>& ReferenceIndex::Entries() const
+{
+    return entries_;
+}
+
+std::vector<boost::filesystem::path> ReferenceIndex::Find(const boost::filesystem::path& file, uintmax_t size, uintmax_t* bytes_read) const
+{
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), size, [](const Entry& entry, uintmax_t value) {
+        return entry.size < value;
+    });
+    
+    std::vector<const Entry*> alive;
+    for (; it != entries_.end() && it->size == size; ++it) {
+        alive.push_back(&*it);
+    }
+    
+    if (alive.empty()) {
+        return {};
+    }
+    
+    uintmax_t read = 0;
+    Digest digest;
+    bool complete = HashFile(file, size, [&alive](size_t prefix, const Digest& value) {
+        alive.erase(std::remove_if(alive.begin(), alive.end(), [&](const Entry* entry) {
+            return entry->prefixes[prefix] != value;
+        }), alive.end());
+        return !alive.empty();
+    }, digest, read);
+    
+    if (bytes_read) {
+        *bytes_read = read;
+    }
+    
+    std::vector<boost::filesystem::path> matches;
+    if (complete) {
+        for (const Entry* entry : alive) {
+            if (entry->digest == digest) {
+                matches.push_back(entry->file);
+            }
+        }
+    }
+    
+    return matches;
+}
+
+ReferenceReport ReferenceIndex::Query(const SizeTable& table, size_t threads) const
+{
+    ReferenceReport report;
+    report.files = table.FileCount();
+    
+    std::vector<SizeRecord> candidates;
+    for (const auto& record : table.Records()) {
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), record.size, [](const Entry& entry, uintmax_t size) {
+            return entry.size < size;
+        });
+        if (it != entries_.end() && it->size == record.size) {
+            candidates.push_back(record);
+            Progress::AddCandidateBytes(record.size);
+        }
+    }
+    report.candidates = candidates.size();
+    Progress::AddGroups(candidates.size());
+    
+    std::vector<std::vector<boost::filesystem::path>> matches(candidates.size());
+    std::atomic<uintmax_t> hashed{0};
+    
+    ParallelFor(candidates.size(), threads, [&](size_t i) {
+        const auto& file = table.File(candidates[i].file);
+        uintmax_t read = 0;
+        
+        try {
+            auto found = Find(file, candidates[i].size, &read);
+            if (!found.empty()) {
+                matches[i].push_back(file);
+                matches[i].insert(matches[i].end(), found.begin(), found.end());
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error reading file " << file << ", it is skipped: " << e.what() << "\n";
+        }
+        
+        hashed += read;
+        Progress::AddBytesSkipped(candidates[i].size - std::min(read, candidates[i].size));
+        Progress::AddGroupsResolved(1);
+    });
+    
+    for (auto& group : matches) {
+        if (!group.empty()) {
+            report.matches.push_back(std::move(group));
+        }
+    }
+    
+    report.bytes_hashed = hashed;
+    for (const auto& record : candidates) {
+        report.bytes_skipped += record.size;
+    }
+    report.bytes_skipped -= std::min(report.bytes_skipped, report.bytes_hashed);
+    
+    return report;
+}
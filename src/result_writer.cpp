@@ -0,0 +1,355 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+#include "result_writer.h"
+
+namespace
+{
+    // length of the well-formed UTF-8 sequence at s, 0 if the bytes do not start one
+    size_t Utf8Length(const unsigned char* s, size_t size)
+    {
+        size_t length;
+        uint32_t min;
+        uint32_t code;
+        
+        if (s[0] < 0x80) {
+            return 1;
+        } else if ((s[0] & 0xE0) == 0xC0) {
+            length = 2;
+            min = 0x80;
+            code = s[0] & 0x1F;
+        } else if ((s[0] & 0xF0) == 0xE0) {
+            length = 3;
+            min = 0x800;
+            code = s[0] & 0x0F;
+        } else if ((s[0] & 0xF8) == 0xF0) {
+            length = 4;
+            min = 0x10000;
+            code = s[0] & 0x07;
+        } else {
+            return 0;
+        }
+        
+        if (size < length) {
+            return 0;
+        }
+        for (size_t i = 1; i < length; ++i) {
+            if ((s[i] & 0xC0) != 0x80) {
+                return 0;
+            }
+            code = code << 6 | (s[i] & 0x3F);
+        }
+        
+        // overlong forms, surrogates and code points past Unicode are not UTF-8
+        if (code < min || (code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF) {
+            return 0;
+        }
+        return length;
+    }
+}
+
+ResultWriter::ResultWriter(OutputFormat format, int fd, size_t buffer_size) : format_(format), fd_(fd), buffer_size_(buffer_size)
+{
+    if (buffer_size_ == 0) {
+        throw std::invalid_argument("Buffer size must be greater than 0");
+    }
+    
+    // anything already queued in the stream buffers must reach the descriptor first
+    std::cout.flush();
+    std::fflush(stdout);
+    
+    buffer_.reserve(buffer_size_ + 4096);
+    
+    if (format_ == OutputFormat::Binary) {
+        buffer_.append("BAYN", 4);
+        AppendInteger<uint32_t>(kBinaryVersion);
+    } else if (format_ == OutputFormat::Json) {
+        buffer_ += '[';
+    }
+}
+
+ResultWriter::~ResultWriter()
+{
+    try {
+        Finish();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error writing results: " << e.what() << "\n";
+    }
+}
+
+void ResultWriter::WriteGroup(uintmax_t size, const std::vector<boost::filesystem::path>& files, const std::string& digest)
+{
+    switch (format_) {
+        case OutputFormat::Text:
+            WriteText(files);
+            break;
+        case OutputFormat::Json:
+        case OutputFormat::JsonLines:
+            WriteJson(size, files, digest);
+            break;
+        case OutputFormat::Binary:
+            WriteBinary(size, files, digest);
+            break;
+    }
+    
+    ++groups_;
+    MaybeFlush();
+}
+
+void ResultWriter::WritePair(double percent, const boost::filesystem::path& first, const boost::filesystem::path& second)
+{
+    const boost::filesystem::path files[] = {first, second};
+    AppendSimilar(percent, nullptr, files, 2);
+}
+
+void ResultWriter::WritePair(double percent, uintmax_t shared_bytes, const boost::filesystem::path& first, const boost::filesystem::path& second)
+{
+    const boost::filesystem::path files[] = {first, second};
+    AppendSimilar(percent, &shared_bytes, files, 2);
+}
+
+void ResultWriter::WriteSimilarGroup(double percent, const std::vector<boost::filesystem::path>& files)
+{
+    AppendSimilar(percent, nullptr, files.data(), files.size());
+}
+
+void ResultWriter::SetEmptyText(std::string text)
+{
+    empty_text_ = std::move(text);
+}
+
+void ResultWriter::Finish()
+{
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    
+    if (format_ == OutputFormat::Text && groups_ == 0) {
+        buffer_ += empty_text_;
+    } else if (format_ == OutputFormat::Json) {
+        buffer_ += groups_ == 0 ? "]\n" : "\n]\n";
+    } else if (format_ == OutputFormat::Binary) {
+        AppendInteger<uint64_t>(0);
+        AppendInteger<uint32_t>(0);
+        AppendInteger<uint64_t>(0);
+        AppendInteger<uint16_t>(0);
+    }
+    
+    Flush();
+}
+
+void ResultWriter::WriteText(const std::vector<boost::filesystem::path>& files)
+{
+    if (groups_ != 0) {
+        buffer_ += '\n';
+    }
+    
+    for (const auto& file : files) {
+        AppendQuoted(file.string());
+        buffer_ += '\n';
+    }
+}
+
+void ResultWriter::WriteJson(uintmax_t size, const std::vector<boost::filesystem::path>& files, const std::string& digest)
+{
+    if (format_ == OutputFormat::Json) {
+        buffer_ += groups_ == 0 ? "\n" : ",\n";
+    }
+    
+    uintmax_t wasted = files.empty() ? 0 : size * (files.size() - 1);
+    
+    buffer_ += "{\"size\":";
+    AppendInteger(size);
+    buffer_ += ",\"count\":";
+    AppendInteger(files.size());
+    buffer_ += ",\"wasted\":";
+    AppendInteger(wasted);
+    
+    if (!digest.empty()) {
+        buffer_ += ",\"digest\":";
+        AppendJsonString(digest);
+    }
+    
+    buffer_ += ",\"files\":[";
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (i != 0) {
+            buffer_ += ',';
+        }
+        AppendJsonString(files[i].string());
+    }
+    buffer_ += "]}";
+    
+    if (format_ == OutputFormat::JsonLines) {
+        buffer_ += '\n';
+    }
+}
+
+void ResultWriter::WriteBinary(uintmax_t size, const std::vector<boost::filesystem::path>& files, const std::string& digest)
+{
+    uintmax_t wasted = files.empty() ? 0 : size * (files.size() - 1);
+    
+    AppendInteger<uint64_t>(size);
+    AppendInteger<uint32_t>(static_cast<uint32_t>(files.size()));
+    AppendInteger<uint64_t>(wasted);
+    AppendInteger<uint16_t>(static_cast<uint16_t>(digest.size()));
+    buffer_ += digest;
+    
+    for (const auto& file : files) {
+        const std::string& native = file.native();
+        AppendInteger<uint32_t>(static_cast<uint32_t>(native.size()));
+        buffer_ += native;
+    }
+}
+
+void ResultWriter::AppendSimilar(double percent, const uintmax_t* shared_bytes, const boost::filesystem::path* files, size_t count)
+{
+    if (format_ == OutputFormat::Binary) {
+        throw std::invalid_argument("Similar files have no binary format");
+    }
+    
+    char digits[32];
+    int length = std::snprintf(digits, sizeof(digits), "%.1f", percent);
+    
+    if (format_ == OutputFormat::Text) {
+        buffer_.append(digits, static_cast<size_t>(length));
+        buffer_ += "% ";
+        if (shared_bytes) {
+            AppendInteger(*shared_bytes);
+            buffer_ += ' ';
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (i != 0) {
+                buffer_ += ' ';
+            }
+            AppendQuoted(files[i].string());
+        }
+        buffer_ += '\n';
+    } else {
+        if (format_ == OutputFormat::Json) {
+            buffer_ += groups_ == 0 ? "\n" : ",\n";
+        }
+        
+        buffer_ += "{\"similarity\":";
+        buffer_.append(digits, static_cast<size_t>(length));
+        if (shared_bytes) {
+            buffer_ += ",\"shared\":";
+            AppendInteger(*shared_bytes);
+        }
+        buffer_ += ",\"files\":[";
+        for (size_t i = 0; i < count; ++i) {
+            if (i != 0) {
+                buffer_ += ',';
+            }
+            AppendJsonString(files[i].string());
+        }
+        buffer_ += "]}";
+        
+        if (format_ == OutputFormat::JsonLines) {
+            buffer_ += '\n';
+        }
+    }
+    
+    ++groups_;
+    MaybeFlush();
+}
+
+void ResultWriter::AppendQuoted(const std::string& s)
+{
+    // same escaping as operator<< for boost::filesystem::path
+    buffer_ += '"';
+    for (char c : s) {
+        if (c == '"' || c == '&') {
+            buffer_ += '&';
+        }
+        buffer_ += c;
+    }
+    buffer_ += '"';
+}
+
+void ResultWriter::AppendJsonString(const std::string& s)
+{
+    static const char* hex = "0123456789abcdef";
+    
+    auto bytes = reinterpret_cast<const unsigned char*>(s.data());
+    
+    buffer_ += '"';
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        unsigned char u = bytes[i];
+        
+        if (u >= 0x80) {
+            size_t length = Utf8Length(bytes + i, s.size() - i);
+            if (length == 0) {
+                // a byte of a name that is not UTF-8 becomes the Latin-1 character of its value
+                buffer_ += "\\u00";
+                buffer_ += hex[u >> 4];
+                buffer_ += hex[u & 0xF];
+            } else {
+                buffer_.append(s, i, length);
+                i += length - 1;
+            }
+        } else if (c == '"' || c == '\\') {
+            buffer_ += '\\';
+            buffer_ += c;
+        } else if (c == '\n') {
+            buffer_ += "\\n";
+        } else if (c == '\t') {
+            buffer_ += "\\t";
+        } else if (u < 0x20) {
+            buffer_ += "\\u00";
+            buffer_ += hex[u >> 4];
+            buffer_ += hex[u & 0xF];
+        } else {
+            buffer_ += c;
+        }
+    }
+    buffer_ += '"';
+}
+
+template <typename T>
+void ResultWriter::AppendInteger(T value)
+{
+    if (format_ == OutputFormat::Binary) {
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            buffer_ += static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+        }
+        return;
+    }
+    
+    char digits[24];
+    int length = std::snprintf(digits, sizeof(digits), "%ju", static_cast<uintmax_t>(value));
+    buffer_.append(digits, static_cast<size_t>(length));
+}
+
+void ResultWriter::MaybeFlush()
+{
+    if (buffer_.size() >= buffer_size_) {
+        Flush();
+    }
+}
+
+void ResultWriter::Flush()
+{
+    const char* data = buffer_.data();
+    size_t left = buffer_.size();
+    
+    while (left > 0) {
+        ssize_t n = ::write(fd_, data, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            buffer_.clear();
+            throw std::runtime_error(std::strerror(errno));
+        }
+        data += n;
+        left -= static_cast<size_t>(n);
+    }
+    
+    buffer_.clear();
+}
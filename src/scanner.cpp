@@ -1,14 +1,35 @@
 #include <iostream>
 #include "scanner.h"
+#include "progress.h"
+#include "stats.h"
+#include "trace.h"
 
-Scanner::Scanner(const Config& config) : config_(config), filter_(config.masks)
+Scanner::Scanner(const Config& config) : config_(config), filter_(config.masks), excludes_(config.exclude_dirs)
 {
 }
 
 std::map<uintmax_t, std::vector<boost::filesystem::path>> Scanner::Scan()
 {
-    std::map<uintmax_t, std::vector<boost::filesystem::path>> result;
-    seen_paths_.clear();
+    SizeTable table = Collect();
+    table.Finalize(false);
+    return table.ToMap();
+}
+
+SizeTable Scanner::ScanTable(bool drop_singletons)
+{
+    SizeTable table = Collect();
+    table.Finalize(drop_singletons);
+    return table;
+}
+
+void Scanner::SetStopCondition(std::function<bool()> stop)
+{
+    stop_ = std::move(stop);
+}
+
+SizeTable Scanner::Collect()
+{
+    SizeTable result;
     
     for (const auto& dir : config_.include_dirs) {
         if (!boost::filesystem::exists(dir) || 
@@ -17,8 +38,22 @@ std::map<uintmax_t, std::vector<boost::filesystem::path>> Scanner::Scan()
             continue;
         }
         
+        size_t cursor = excludes_.Start(dir);
+        if (excludes_.Excluded(cursor)) {
+            continue;
+        }
+        
+        // symlinks below the root are skipped, so only the root needs resolving
+        boost::filesystem::path canonical_dir;
+        try {
+            canonical_dir = boost::filesystem::canonical(dir);
+        }
+        catch (...) {
+            canonical_dir = boost::filesystem::absolute(dir);
+        }
+        
         try {
-            ScanDirectory(dir, 0, result);
+            ScanDirectory(dir, result.AddDirectory(PathTree::kRoot, canonical_dir.native()), 0, cursor, result);
         }
         catch (const std::exception& e) {
             std::cerr << "Error scanning directory " << dir << ": " << e.what() << "\n";
@@ -33,70 +68,71 @@ bool Scanner::ScanSubdirectory(size_t current_depth) const
     return (current_depth + 1) <= config_.depth;
 }
 
-void Scanner::ScanDirectory(const boost::filesystem::path& root, size_t current_depth, std::map<uintmax_t, std::vector<boost::filesystem::path>>& result)
+void Scanner::ScanDirectory(const boost::filesystem::path& root, uint32_t node, size_t current_depth, size_t exclude_cursor, SizeTable& result)
 {
     if (!boost::filesystem::exists(root) || 
         !boost::filesystem::is_directory(root)) {
         return;
     }
     
-    if (IsExcluded(root)) {
-        return;
-    }
+    TRACE_SPAN("scan_directory");
+    Stats::Add(Counter::DirectoriesVisited);
     
     try {
         boost::filesystem::directory_iterator end;
         
         for (boost::filesystem::directory_iterator it(root); it != end; ++it) {
+            if (stop_ && stop_()) {
+                return;
+            }
+            
             const auto& path = it->path();
             
+            std::string_view name(path.native());
+            name.remove_prefix(name.rfind('/') + 1);
+            
+            size_t cursor = excludes_.Descend(exclude_cursor, name);
+            if (excludes_.Excluded(cursor)) {
+                continue;
+            }
+            
             try {
+                Stats::Add(Counter::StatCalls);
                 if (boost::filesystem::is_symlink(path)) {
                     continue;
                 }
                 
+                Stats::Add(Counter::StatCalls);
                 if (boost::filesystem::is_directory(path)) {
                     if (!ScanSubdirectory(current_depth)) {
                         continue;
                     }
                     
-                    ScanDirectory(path, current_depth + 1, result);
+                    ScanDirectory(path, result.AddDirectory(node, name), current_depth + 1, cursor, result);
                     continue;
                 }
                 
+                Stats::Add(Counter::StatCalls);
                 if (!boost::filesystem::is_regular_file(path)) {
                     continue;
                 }
                 
-                if (IsExcluded(path)) {
-                    continue;
-                }
+                Stats::Add(Counter::FilesScanned);
+                Progress::AddEntries(1);
 
                 boost::system::error_code ec{};
+                Stats::Add(Counter::StatCalls);
                 uintmax_t size = boost::filesystem::file_size(path, ec);
                 if (ec || size <= config_.min_file_size) {
                     continue;
                 }               
                 
-                if (!filter_.Match(path.filename().string())) {
+                if (!filter_.Match(name)) {
                     continue;
                 }
                 
-                std::string canonical_path;
-                try {
-                    canonical_path = boost::filesystem::canonical(path).string();
-                }
-                catch (...) {
-                    canonical_path = boost::filesystem::absolute(path).string();
-                }
-                
-                if (seen_paths_.count(canonical_path)) {
-                    continue;
-                }
-                
-                seen_paths_.insert(canonical_path);
-                
-                result[size].push_back(canonical_path);
+                // a path reached twice through overlapping include dirs is dropped by SizeTable
+                result.Add(size, node, name);
                 
             }
             catch (const std::exception& e) {
@@ -109,39 +145,4 @@ void Scanner::ScanDirectory(const boost::filesystem::path& root, size_t current_
         std::cerr << "Skipping directories with access errors. Error: " << e.what() << "\n";
         return;
     }
-}
-
-bool Scanner::IsExcluded(const boost::filesystem::path& path) const
-{
-        if (config_.exclude_dirs.empty()) {
-        return false;
-    }
-    
-    try {
-        boost::filesystem::path abs_path = boost::filesystem::absolute(path).lexically_normal();
-        
-        for (const auto& ex_dir : config_.exclude_dirs) {
-            try {
-                boost::filesystem::path abs_ex_dir = boost::filesystem::absolute(ex_dir).lexically_normal();
-                
-                auto relative = abs_path.lexically_relative(abs_ex_dir);
-                
-                if (!relative.empty() && relative.native()[0] != '.') {
-                    return true; 
-                }
-                
-                if (relative == ".") {
-                    return true; 
-                }
-            }
-            catch (...) {
-                continue; 
-            }
-        }
-    }
-    catch (...) {
-        return false; 
-    }
-    
-    return false;
 }
\ No newline at end of file
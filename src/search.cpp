@@ -0,0 +1,197 @@
+#include <stdexcept>
+#include <thread>
+#include "block_cache.h"
+#include "duplicate_finder.h"
+#include "hasher.h"
+#include "scanner.h"
+#include "search.h"
+#include "trace.h"
+
+namespace
+{
+    // marks the engine as busy on the calling thread for the lifetime of a run
+    class EngineOwner
+    {
+    public:
+        explicit EngineOwner(std::atomic<std::thread::id>& owner) : owner_(owner) { owner_ = std::this_thread::get_id(); }
+        ~EngineOwner() { owner_ = std::thread::id(); }
+        
+        EngineOwner(const EngineOwner&) = delete;
+        EngineOwner& operator=(const EngineOwner&) = delete;
+        
+    private:
+        std::atomic<std::thread::id>& owner_;
+    };
+}
+
+SearchRun::SearchRun(SearchEngine& engine, SearchOptions options) : engine_(engine), options_(std::move(options))
+{
+}
+
+void SearchRun::OnGroup(GroupCallback callback)
+{
+    on_group_ = std::move(callback);
+}
+
+void SearchRun::OnProgress(ProgressCallback callback, std::chrono::milliseconds interval)
+{
+    on_progress_ = std::move(callback);
+    progress_interval_ = interval;
+}
+
+bool SearchRun::Poll()
+{
+    if (status_ != SearchStatus::Completed) {
+        return true;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    
+    if (token_ && token_->Cancelled()) {
+        status_ = SearchStatus::Cancelled;
+    } else if (options_.time_limit.count() > 0 && now - started_ >= options_.time_limit) {
+        status_ = SearchStatus::TimeLimit;
+    } else {
+        // runs between directories, size groups and read rounds, where the cache may go
+        EnforceMemoryLimit();
+    }
+    
+    if (on_progress_ && now - last_progress_ >= progress_interval_) {
+        last_progress_ = now;
+        on_progress_(progress_.Snapshot());
+    }
+    
+    return status_ != SearchStatus::Completed;
+}
+
+void SearchRun::EnforceMemoryLimit()
+{
+    DuplicateFinder& finder = *engine_.finder_;
+    
+    // digests of resolved groups are only kept for later searches, so they go first
+    if (options_.memory_limit > 0 && table_bytes_ + finder.MemoryUsage() > options_.memory_limit) {
+        finder.Cache().Clear();
+        finder.ClearSharedGroups();
+    }
+}
+
+SearchResult SearchRun::Execute(const CancellationToken* token)
+{
+    if (engine_.RunningOnThisThread()) {
+        throw std::logic_error("A search cannot be started from a callback of a search on the same engine");
+    }
+    
+    std::lock_guard<std::mutex> lock(engine_.mutex_);
+    EngineOwner owner(engine_.owner_);
+    TRACE_SPAN("search");
+    
+    Config config;
+    config.include_dirs = options_.include_dirs;
+    config.exclude_dirs = options_.exclude_dirs;
+    config.depth = options_.depth;
+    config.min_file_size = options_.min_file_size;
+    config.masks = options_.masks;
+    if (config.include_dirs.empty()) {
+        throw std::invalid_argument("A search needs at least one directory to scan");
+    }
+    
+    token_ = token;
+    status_ = SearchStatus::Completed;
+    started_ = std::chrono::steady_clock::now();
+    last_progress_ = started_;
+    table_bytes_ = 0;
+    progress_.Reset();
+    ScopedProgress scoped_progress(progress_);
+    
+    DuplicateFinder& finder = *engine_.finder_;
+    BlockCache& cache = finder.Cache();
+    cache.DropChanged();
+    // nothing reads them through the engine, they would only pile up across searches
+    finder.ClearSharedGroups();
+    
+    SearchResult result;
+    SizeTable files;
+    
+    if (!Poll()) {
+        Scanner scanner(config);
+        scanner.SetStopCondition([this]() { return Poll(); });
+        files = scanner.ScanTable(true);
+        result.files = files.FileCount();
+    }
+    
+    table_bytes_ = files.MemoryUsage();
+    if (status_ == SearchStatus::Completed && options_.memory_limit > 0 && table_bytes_ > options_.memory_limit) {
+        status_ = SearchStatus::MemoryLimit;
+    }
+    
+    if (status_ == SearchStatus::Completed) {
+        finder.SetStopCondition([this]() { return Poll(); });
+        
+        try {
+            finder.Find(files, [&](std::vector<boost::filesystem::path>&& group) {
+                ++result.groups;
+                if (on_group_) {
+                    on_group_(group);
+                }
+                
+                EnforceMemoryLimit();
+                return true;
+            });
+        }
+        catch (...) {
+            finder.SetStopCondition(nullptr);
+            throw;
+        }
+        
+        finder.SetStopCondition(nullptr);
+    }
+    
+    ProgressSnapshot snapshot = progress_.Snapshot();
+    if (on_progress_) {
+        on_progress_(snapshot);
+    }
+    
+    result.status = status_;
+    result.bytes_hashed = snapshot.bytes_hashed;
+    token_ = nullptr;
+    return result;
+}
+
+SearchEngine::SearchEngine(size_t block_size, HashType hash_type, const IoOptions& io, size_t prefetch_blocks)
+{
+    auto hasher = std::make_unique<Hasher>(hash_type, io.ssd_threads);
+    auto cache = std::make_unique<BlockCache>(block_size, std::move(hasher), io);
+    finder_ = std::make_unique<DuplicateFinder>(std::move(cache), prefetch_blocks);
+}
+
+SearchEngine::~SearchEngine() = default;
+
+bool SearchEngine::RunningOnThisThread() const
+{
+    return owner_.load() == std::this_thread::get_id();
+}
+
+size_t SearchEngine::CacheMemoryUsage()
+{
+    // a callback of the running search already holds the lock, and the pipeline is paused
+    if (RunningOnThisThread()) {
+        return finder_->MemoryUsage();
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finder_->MemoryUsage();
+}
+
+void SearchEngine::ClearCache()
+{
+    // callbacks run between directories, size groups and read rounds, where clearing is safe
+    if (RunningOnThisThread()) {
+        finder_->Cache().Clear();
+        finder_->ClearSharedGroups();
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    finder_->Cache().Clear();
+    finder_->ClearSharedGroups();
+}
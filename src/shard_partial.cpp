@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include "shard_partial.h"
+#include "binary_io.h"
+#include "parallel.h"
+#include "progress.h"
+#include "trace.h"
+
+namespace
+{
+    const char kMagic[4] = {'B', 'A', 'Y', 'P'};
+    
+    // a local duplicate group or a single file of one partial
+    struct Unit
+    {
+        size_t partial;
+        uint32_t representative;
+        std::vector<uint32_t> members;
+    };
+    
+    class Resolver
+    {
+    public:
+        Resolver(const std::vector<ShardPartial>& partials, MergeResult& result) : partials_(partials), result_(result) {}
+        
+        void Resolve(std::vector<Unit> units, size_t level, size_t levels)
+        {
+            bool one_shard = std::all_of(units.begin(), units.end(), [&](const Unit& unit) {
+                return unit.partial == units.front().partial;
+            });
+            
+            // the shard already compared these files, so the units are known to differ
+            if (one_shard) {
+                for (const auto& unit : units) {
+                    Emit({unit});
+                }
+                return;
+            }
+            
+            if (level == levels) {
+                Emit(units);
+                return;
+            }
+            
+            bool missing = false;
+            for (const auto& unit : units) {
+                if (Entry(unit).digests.size() <= level) {
+                    // the first round reads the smallest prefix only, the second the whole file
+                    size_t want = level == 0 ? 1 : levels;
+                    result_.work[unit.partial].push_back({unit.representative, static_cast<uint32_t>(want)});
+                    missing = true;
+                }
+            }
+            if (missing) {
+                return;
+            }
+            
+            std::map<ReferenceIndex::Digest, std::vector<Unit>> classes;
+            for (auto& unit : units) {
+                ReferenceIndex::Digest digest = Entry(unit).digests[level];
+                classes[digest].push_back(std::move(unit));
+            }
+            
+            for (auto& [digest, members] : classes) {
+                Resolve(std::move(members), level + 1, levels);
+            }
+        }
+        
+    private:
+        const std::vector<ShardPartial>& partials_;
+        MergeResult& result_;
+        
+        const PartialEntry& Entry(const Unit& unit) const
+        {
+            return partials_[unit.partial].Entries()[unit.representative];
+        }
+        
+        void Emit(const std::vector<Unit>& units)
+        {
+            std::vector<boost::filesystem::path> group;
+            for (const auto& unit : units) {
+                for (uint32_t member : unit.members) {
+                    group.push_back(partials_[unit.partial].Entries()[member].file);
+                }
+            }
+            
+            if (group.size() > 1) {
+                result_.duplicates.push_back(std::move(group));
+            }
+        }
+    };
+}
+
+size_t MergeResult::PendingFiles() const
+{
+    size_t pending = 0;
+    for (const auto& items : work) {
+        pending += items.size();
+    }
+    return pending;
+}
+
+ShardPartial ShardPartial::FromScan(const SizeTable& table, const std::vector<std::vector<boost::filesystem::path>>& local_duplicates)
+{
+    std::unordered_map<std::string, uint32_t> groups;
+    for (size_t g = 0; g < local_duplicates.size(); ++g) {
+        for (const auto& file : local_duplicates[g]) {
+            groups[file.string()] = static_cast<uint32_t>(g + 1);
+        }
+    }
+    
+    ShardPartial partial;
+    partial.entries_.reserve(table.Records().size());
+    
+    for (const auto& record : table.Records()) {
+        const auto& file = table.File(record.file);
+        boost::system::error_code ec;
+        std::time_t mtime = boost::filesystem::last_write_time(file, ec);
+        
+        auto it = groups.find(file.string());
+        partial.entries_.push_back({record.size, ec ? 0 : mtime, it == groups.end() ? 0 : it->second, file, {}});
+    }
+    
+    return partial;
+}
+
+void ShardPartial::Save(const boost::filesystem::path& file) const
+{
+    std::string out(kMagic, sizeof(kMagic));
+    PutInteger<uint32_t>(out, kVersion);
+    PutInteger<uint64_t>(out, entries_.size());
+    
+    for (const auto& entry : entries_) {
+        std::string path = entry.file.string();
+        PutInteger<uint64_t>(out, entry.size);
+        PutInteger<int64_t>(out, entry.mtime);
+        PutInteger<uint32_t>(out, entry.group);
+        PutInteger<uint32_t>(out, path.size());
+        out += path;
+        PutInteger<uint8_t>(out, entry.digests.size());
+        for (const auto& digest : entry.digests) {
+            out.append(reinterpret_cast<const char*>(digest.data()), digest.size());
+        }
+    }
+    
+    boost::filesystem::path tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream stream(tmp.string(), std::ios::binary | std::ios::trunc);
+        stream.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!stream) {
+            throw std::runtime_error("Cannot write partial " + tmp.string());
+        }
+    }
+    boost::filesystem::rename(tmp, file);
+}
+
+ShardPartial ShardPartial::Load(const boost::filesystem::path& file)
+{
+    std::ifstream stream(file.string(), std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("Cannot open partial " + file.string());
+    }
+    std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    
+    BinaryReader reader(data, "Partial " + file.string());
+    if (reader.Bytes(sizeof(kMagic)) != std::string(kMagic, sizeof(kMagic))) {
+        throw std::runtime_error(file.string() + " is not a bayan partial");
+    }
+    uint32_t version = reader.Get<uint32_t>();
+    if (version != kVersion) {
+        throw std::runtime_error("Unsupported partial version " + std::to_string(version) + " in " + file.string());
+    }
+    
+    ShardPartial partial;
+    uint64_t count = reader.Get<uint64_t>();
+    partial.entries_.reserve(static_cast<size_t>(std::min<uint64_t>(count, data.size())));
+    
+    for (uint64_t i = 0; i < count; ++i) {
+        PartialEntry entry;
+        entry.size = reader.Get<uint64_t>();
+        entry.mtime = static_cast<std::time_t>(reader.Get<int64_t>());
+        entry.group = reader.Get<uint32_t>();
+        entry.file = reader.Bytes(reader.Get<uint32_t>());
+        
+        uint8_t digests = reader.Get<uint8_t>();
+        for (uint8_t d = 0; d < digests; ++d) {
+            std::string bytes = reader.Bytes(sizeof(ReferenceIndex::Digest));
+            ReferenceIndex::Digest digest;
+            std::memcpy(digest.data(), bytes.data(), digest.size());
+            entry.digests.push_back(digest);
+        }
+        
+        if (!partial.entries_.empty() && partial.entries_.back().size > entry.size) {
+            throw std::runtime_error("Partial " + file.string() + " is not sorted by size");
+        }
+        partial.entries_.push_back(std::move(entry));
+    }
+    
+    return partial;
+}
+
+const std::vector<PartialEntry>& ShardPartial::Entries() const
+{
+    return entries_;
+}
+
+std::vector<WorkItem> ShardPartial::LoadWork(const boost::filesystem::path& file)
+{
+    std::ifstream stream(file.string());
+    if (!stream) {
+        throw std::runtime_error("Cannot open work list " + file.string());
+    }
+    
+    std::vector<WorkItem> work;
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        
+        std::istringstream fields(line);
+        WorkItem item;
+        if (!(fields >> item.levels >> item.entry)) {
+            throw std::runtime_error("Malformed line in work list " + file.string() + ": " + line);
+        }
+        work.push_back(item);
+    }
+    
+    return work;
+}
+
+void ShardPartial::SaveWork(const boost::filesystem::path& file, const std::vector<WorkItem>& work) const
+{
+    std::ofstream stream(file.string(), std::ios::trunc);
+    for (const auto& item : work) {
+        stream << item.levels << ' ' << item.entry << ' ' << entries_.at(item.entry).file.string() << '\n';
+    }
+    
+    if (!stream) {
+        throw std::runtime_error("Cannot write work list " + file.string());
+    }
+}
+
+void ShardPartial::HashWork(const std::vector<WorkItem>& work, size_t threads)
+{
+    for (const auto& item : work) {
+        if (item.entry >= entries_.size()) {
+            throw std::runtime_error("Work list does not match the partial: entry " + std::to_string(item.entry) + " is out of range");
+        }
+        Progress::AddCandidateBytes(entries_[item.entry].size);
+    }
+    Progress::AddGroups(work.size());
+    
+    // one byte per entry, the workers write neighbouring flags concurrently
+    std::vector<uint8_t> changed(entries_.size(), 0);
+    
+    ParallelFor(work.size(), threads, [&](size_t i) {
+        PartialEntry& entry = entries_[work[i].entry];
+        
+        try {
+            boost::system::error_code ec;
+            uintmax_t size = boost::filesystem::file_size(entry.file, ec);
+            std::time_t mtime = ec ? 0 : boost::filesystem::last_write_time(entry.file, ec);
+            
+            if (ec || size != entry.size || mtime != entry.mtime) {
+                throw std::runtime_error("file changed since the shard was scanned");
+            }
+            
+            entry.digests = ReferenceIndex::ProgressiveDigests(entry.file, entry.size, work[i].levels);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error hashing file " << entry.file << ", it is dropped from the partial: " << e.what() << "\n";
+            changed[work[i].entry] = 1;
+        }
+        Progress::AddGroupsResolved(1);
+    });
+    
+    // the rest of a local group stands for the dropped file; a later round hashes it
+    size_t kept = 0;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (changed[i]) {
+            continue;
+        }
+        if (kept != i) {
+            entries_[kept] = std::move(entries_[i]);
+        }
+        ++kept;
+    }
+    entries_.resize(kept);
+}
+
+MergeResult ShardPartial::Merge(const std::vector<ShardPartial>& partials)
+{
+    TRACE_SPAN("merge");
+    
+    MergeResult result;
+    result.work.resize(partials.size());
+    
+    std::map<uintmax_t, std::vector<Unit>> sizes;
+    for (size_t p = 0; p < partials.size(); ++p) {
+        const auto& entries = partials[p].Entries();
+        std::unordered_map<uint32_t, size_t> group_units;
+        
+        for (size_t i = 0; i < entries.size(); ++i) {
+            auto& units = sizes[entries[i].size];
+            
+            if (entries[i].group != 0) {
+                auto it = group_units.find(entries[i].group);
+                if (it != group_units.end() && units.size() > it->second && units[it->second].partial == p) {
+                    units[it->second].members.push_back(static_cast<uint32_t>(i));
+                    continue;
+                }
+                group_units[entries[i].group] = units.size();
+            }
+            
+            units.push_back({p, static_cast<uint32_t>(i), {static_cast<uint32_t>(i)}});
+        }
+    }
+    
+    Resolver resolver(partials, result);
+    for (auto& [size, units] : sizes) {
+        resolver.Resolve(std::move(units), 0, ReferenceIndex::Levels(size));
+    }
+    
+    return result;
+}
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include "size_table.h"
+
+uint32_t SizeTable::AddDirectory(uint32_t parent, std::string_view name)
+{
+    return paths_.Add(parent, name);
+}
+
+uint32_t SizeTable::Add(uintmax_t size, uint32_t directory, std::string_view name)
+{
+    if (nodes_.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many files for the size table");
+    }
+    
+    uint32_t id = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(paths_.Add(directory, name));
+    records_.push_back({size, id});
+    return id;
+}
+
+uint32_t SizeTable::Add(uintmax_t size, const boost::filesystem::path& file)
+{
+    const std::string& native = file.native();
+    size_t slash = native.rfind('/');
+    
+    if (slash == std::string::npos) {
+        return Add(size, PathTree::kRoot, native);
+    }
+    
+    std::string_view directory(native.data(), slash == 0 ? 1 : slash);
+    if (last_directory_node_ == PathTree::kRoot || directory != last_directory_) {
+        last_directory_.assign(directory);
+        last_directory_node_ = AddDirectory(PathTree::kRoot, directory);
+    }
+    
+    return Add(size, last_directory_node_, std::string_view(native).substr(slash + 1));
+}
+
+void SizeTable::RemoveRepeatedPaths(size_t begin, size_t end, std::vector<bool>& removed) const
+{
+    if (end - begin == 2) {
+        if (paths_.String(nodes_[records_[begin].file]) == paths_.String(nodes_[records_[begin + 1].file])) {
+            removed[begin + 1] = true;
+        }
+        return;
+    }
+    
+    std::vector<std::string> paths;
+    paths.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        paths.push_back(paths_.String(nodes_[records_[i].file]));
+    }
+    
+    std::unordered_set<std::string_view> seen;
+    seen.reserve(end - begin);
+    
+    for (size_t i = begin; i < end; ++i) {
+        if (!seen.insert(paths[i - begin]).second) {
+            removed[i] = true;
+        }
+    }
+}
+
+void SizeTable::Finalize(bool drop_singletons)
+{
+    // ids grow in scan order, so sorting by (size, id) keeps the first occurrence first
+    std::sort(records_.begin(), records_.end(), [](const SizeRecord& a, const SizeRecord& b) {
+        return a.size != b.size ? a.size < b.size : a.file < b.file;
+    });
+    
+    std::vector<bool> removed(records_.size(), false);
+    
+    for (size_t begin = 0; begin < records_.size();) {
+        size_t end = begin + 1;
+        while (end < records_.size() && records_[end].size == records_[begin].size) {
+            ++end;
+        }
+        
+        if (end - begin > 1) {
+            RemoveRepeatedPaths(begin, end, removed);
+        }
+        
+        if (drop_singletons) {
+            size_t kept = static_cast<size_t>(std::count(removed.begin() + static_cast<std::ptrdiff_t>(begin),
+                                                         removed.begin() + static_cast<std::ptrdiff_t>(end), false));
+            if (kept < 2) {
+                std::fill(removed.begin() + static_cast<std::ptrdiff_t>(begin),
+                          removed.begin() + static_cast<std::ptrdiff_t>(end), true);
+            }
+        }
+        
+        begin = end;
+    }
+    
+    // renumber the survivors in record order; when most files were dropped their paths are
+    // copied to a new tree, otherwise the tree is kept as it is
+    size_t kept = static_cast<size_t>(std::count(removed.begin(), removed.end(), false));
+    bool compact = kept * 2 < records_.size();
+    
+    std::vector<SizeRecord> records;
+    std::vector<uint32_t> nodes;
+    PathTree paths;
+    std::vector<uint32_t> remap;
+    records.reserve(kept);
+    nodes.reserve(kept);
+    
+    for (size_t i = 0; i < records_.size(); ++i) {
+        if (removed[i]) {
+            continue;
+        }
+        uint32_t node = nodes_[records_[i].file];
+        records.push_back({records_[i].size, static_cast<uint32_t>(nodes.size())});
+        nodes.push_back(compact ? paths.Copy(paths_, node, remap) : node);
+    }
+    
+    records_ = std::move(records);
+    nodes_ = std::move(nodes);
+    if (compact) {
+        paths_ = std::move(paths);
+    }
+    paths_.ShrinkToFit();
+    last_directory_.clear();
+    last_directory_node_ = PathTree::kRoot;
+}
+
+std::vector<SizeTable::Group> SizeTable::Groups() const
+{
+    std::vector<Group> groups;
+    
+    for (size_t begin = 0; begin < records_.size();) {
+        size_t end = begin + 1;
+        while (end < records_.size() && records_[end].size == records_[begin].size) {
+            ++end;
+        }
+        groups.push_back({records_[begin].size, begin, end});
+        begin = end;
+    }
+    
+    return groups;
+}
+
+std::vector<boost::filesystem::path> SizeTable::GroupFiles(const Group& group) const
+{
+    std::vector<boost::filesystem::path> files;
+    files.reserve(group.end - group.begin);
+    
+    for (size_t i = group.begin; i < group.end; ++i) {
+        files.push_back(paths_.Path(nodes_[records_[i].file]));
+    }
+    
+    return files;
+}
+
+const std::vector<SizeRecord>& SizeTable::Records() const
+{
+    return records_;
+}
+
+boost::filesystem::path SizeTable::File(uint32_t id) const
+{
+    return paths_.Path(nodes_.at(id));
+}
+
+std::vector<boost::filesystem::path> SizeTable::Files() const
+{
+    std::vector<boost::filesystem::path> files;
+    files.reserve(nodes_.size());
+    
+    for (uint32_t node : nodes_) {
+        files.push_back(paths_.Path(node));
+    }
+    
+    return files;
+}
+
+size_t SizeTable::FileCount() const
+{
+    return nodes_.size();
+}
+
+size_t SizeTable::MemoryUsage() const
+{
+    return records_.capacity() * sizeof(SizeRecord) + nodes_.capacity() * sizeof(uint32_t) +
+           paths_.MemoryUsage() + last_directory_.capacity();
+}
+
+std::map<uintmax_t, std::vector<boost::filesystem::path>> SizeTable::ToMap() const
+{
+    std::map<uintmax_t, std::vector<boost::filesystem::path>> result;
+    
+    for (const auto& group : Groups()) {
+        result.emplace(group.size, GroupFiles(group));
+    }
+    
+    return result;
+}
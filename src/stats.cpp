@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <mutex>
+#include "stats.h"
+
+namespace
+{
+    constexpr size_t kCounterCount = static_cast<size_t>(Counter::Count);
+
+    bool IsPeak(size_t index)
+    {
+        return index == static_cast<size_t>(Counter::OpenFilesPeak);
+    }
+
+    struct ThreadCounters;
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<ThreadCounters*> live;
+        uint64_t retired[kCounterCount] = {};
+        uint64_t size_groups = 0;
+        std::map<uint64_t, uint64_t> group_histogram;
+        std::vector<PhaseTime> phases;
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    struct ThreadCounters
+    {
+        std::atomic<uint64_t> values[kCounterCount] = {};
+
+        ThreadCounters()
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.live.push_back(this);
+        }
+
+        ~ThreadCounters()
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            
+            for (size_t i = 0; i < kCounterCount; ++i) {
+                uint64_t value = values[i].load(std::memory_order_relaxed);
+                registry.retired[i] = IsPeak(i) ? std::max(registry.retired[i], value) : registry.retired[i] + value;
+            }
+            
+            registry.live.erase(std::remove(registry.live.begin(), registry.live.end(), this), registry.live.end());
+        }
+    };
+
+    ThreadCounters& Local()
+    {
+        thread_local ThreadCounters counters;
+        return counters;
+    }
+
+    double ProcessCpuSeconds()
+    {
+        timespec ts{};
+        ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+    }
+
+    uint64_t HistogramBucket(uint64_t files)
+    {
+        uint64_t bucket = 1;
+        while (bucket < files) {
+            bucket <<= 1;
+        }
+        return bucket;
+    }
+}
+
+void Stats::Add(Counter counter, uint64_t value)
+{
+    auto& slot = Local().values[static_cast<size_t>(counter)];
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void Stats::Peak(Counter counter, uint64_t value)
+{
+    auto& slot = Local().values[static_cast<size_t>(counter)];
+    if (value > slot.load(std::memory_order_relaxed)) {
+        slot.store(value, std::memory_order_relaxed);
+    }
+}
+
+void Stats::RecordSizeGroup(uint64_t files)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    
+    ++registry.size_groups;
+    ++registry.group_histogram[HistogramBucket(files)];
+}
+
+void Stats::RecordPhase(const std::string& name, double wall_seconds, double cpu_seconds)
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    
+    registry.phases.push_back({name, wall_seconds, cpu_seconds});
+}
+
+StatsSnapshot Stats::Snapshot()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    
+    StatsSnapshot snapshot;
+    
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        uint64_t total = registry.retired[i];
+        
+        for (const ThreadCounters* counters : registry.live) {
+            uint64_t value = counters->values[i].load(std::memory_order_relaxed);
+            total = IsPeak(i) ? std::max(total, value) : total + value;
+        }
+        
+        snapshot.counters[i] = total;
+    }
+    
+    snapshot.size_groups = registry.size_groups;
+    snapshot.group_histogram = registry.group_histogram;
+    snapshot.phases = registry.phases;
+    
+    return snapshot;
+}
+
+void Stats::Reset()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        registry.retired[i] = 0;
+        for (ThreadCounters* counters : registry.live) {
+            counters->values[i].store(0, std::memory_order_relaxed);
+        }
+    }
+    
+    registry.size_groups = 0;
+    registry.group_histogram.clear();
+    registry.phases.clear();
+}
+
+const char* Stats::CounterName(Counter counter)
+{
+    switch (counter) {
+        case Counter::FilesScanned:       return "files_scanned";
+        case Counter::DirectoriesVisited: return "directories_visited";
+        case Counter::StatCalls:          return "stat_calls";
+        case Counter::BlocksRead:         return "blocks_read";
+        case Counter::BlocksHashed:       return "blocks_hashed";
+        case Counter::BlocksSplit:        return "blocks_split";
+        case Counter::BytesRead:          return "bytes_read";
+        case Counter::CacheHits:          return "cache_hits";
+        case Counter::CacheMisses:        return "cache_misses";
+        case Counter::OpenFilesPeak:      return "open_files_peak";
+        case Counter::Comparisons:        return "comparisons";
+        case Counter::Count:              break;
+    }
+    return "unknown";
+}
+
+void Stats::PrintText(std::ostream& os, const StatsSnapshot& snapshot)
+{
+    os << "Statistics:\n";
+    
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        os << "  " << std::left << std::setw(22) << CounterName(static_cast<Counter>(i)) << snapshot.counters[i] << "\n";
+    }
+    
+    os << "  " << std::left << std::setw(22) << "size_groups" << snapshot.size_groups << "\n";
+    
+    for (const auto& [bucket, count] : snapshot.group_histogram) {
+        os << "    files <= " << std::left << std::setw(11) << bucket << count << "\n";
+    }
+    
+    for (const auto& phase : snapshot.phases) {
+        os << "  phase " << std::left << std::setw(16) << phase.name
+           << std::fixed << std::setprecision(3) << phase.wall_seconds << " s wall, "
+           << phase.cpu_seconds << " s cpu\n";
+    }
+}
+
+void Stats::PrintJson(std::ostream& os, const StatsSnapshot& snapshot)
+{
+    os << "{";
+    
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        os << "\"" << CounterName(static_cast<Counter>(i)) << "\":" << snapshot.counters[i] << ",";
+    }
+    
+    os << "\"size_groups\":" << snapshot.size_groups << ",\"group_histogram\":{";
+    
+    bool first = true;
+    for (const auto& [bucket, count] : snapshot.group_histogram) {
+        os << (first ? "" : ",") << "\"" << bucket << "\":" << count;
+        first = false;
+    }
+    
+    os << "},\"phases\":[";
+    
+    first = true;
+    for (const auto& phase : snapshot.phases) {
+        os << (first ? "" : ",") << "{\"name\":\"" << phase.name << "\""
+           << std::fixed << std::setprecision(6)
+           << ",\"wall_seconds\":" << phase.wall_seconds
+           << ",\"cpu_seconds\":" << phase.cpu_seconds << "}";
+        first = false;
+    }
+    
+    os << "]}\n";
+}
+
+ScopedPhase::ScopedPhase(std::string name) : name_(std::move(name)), wall_start_(std::chrono::steady_clock::now()), cpu_start_(ProcessCpuSeconds())
+{
+}
+
+ScopedPhase::~ScopedPhase()
+{
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start_;
+    Stats::RecordPhase(name_, wall.count(), ProcessCpuSeconds() - cpu_start_);
+}
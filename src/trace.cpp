@@ -0,0 +1,156 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "trace.h"
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char* name;
+        long tid;
+        uint64_t start_ns;
+        uint64_t end_ns;
+    };
+
+    struct ThreadRing
+    {
+        long tid = 0;
+        std::atomic<uint64_t> head{0};
+        std::unique_ptr<TraceEvent[]> events{new TraceEvent[Trace::kRingCapacity]};
+    };
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+        std::vector<ThreadRing*> free_rings;
+        std::atomic<bool> enabled{false};
+    };
+
+    Registry& GetRegistry()
+    {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    // Short-lived I/O workers hand their ring back on exit, so the next worker reuses it
+    // instead of allocating a new one; events keep the tid of the thread that wrote them.
+    struct RingOwner
+    {
+        ThreadRing* ring = nullptr;
+        
+        ~RingOwner()
+        {
+            if (ring) {
+                Registry& registry = GetRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.free_rings.push_back(ring);
+            }
+        }
+    };
+
+    ThreadRing& LocalRing()
+    {
+        thread_local RingOwner owner;
+        
+        if (!owner.ring) {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            
+            if (registry.free_rings.empty()) {
+                registry.rings.push_back(std::make_unique<ThreadRing>());
+                owner.ring = registry.rings.back().get();
+            } else {
+                owner.ring = registry.free_rings.back();
+                registry.free_rings.pop_back();
+            }
+            
+            owner.ring->tid = static_cast<long>(::syscall(SYS_gettid));
+        }
+        
+        return *owner.ring;
+    }
+}
+
+void Trace::Start()
+{
+    GetRegistry().enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::Stop()
+{
+    GetRegistry().enabled.store(false, std::memory_order_relaxed);
+}
+
+bool Trace::Enabled()
+{
+    return GetRegistry().enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t Trace::NowNs()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+void Trace::Record(const char* name, uint64_t start_ns, uint64_t end_ns)
+{
+    ThreadRing& ring = LocalRing();
+    
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.events[head % kRingCapacity] = TraceEvent{name, ring.tid, start_ns, end_ns};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Trace::WriteChromeJson(const std::string& path)
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot open trace file: " + path);
+    }
+    
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    
+    uint64_t origin = UINT64_MAX;
+    for (const auto& ring : registry.rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t first = head > kRingCapacity ? head - kRingCapacity : 0;
+        for (uint64_t i = first; i < head; ++i) {
+            origin = std::min(origin, ring->events[i % kRingCapacity].start_ns);
+        }
+    }
+    
+    long pid = static_cast<long>(::getpid());
+    bool first_event = true;
+    
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    
+    for (const auto& ring : registry.rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t first = head > kRingCapacity ? head - kRingCapacity : 0;
+        
+        for (uint64_t i = first; i < head; ++i) {
+            const TraceEvent& e = ring->events[i % kRingCapacity];
+            
+            out << (first_event ? "\n" : ",\n")
+                << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << e.tid
+                << ",\"ts\":" << (e.start_ns - origin) / 1000.0
+                << ",\"dur\":" << (e.end_ns - e.start_ns) / 1000.0 << "}";
+            first_event = false;
+        }
+    }
+    
+    out << "\n]}\n";
+    
+    if (!out) {
+        throw std::runtime_error("Cannot write trace file: " + path);
+    }
+}
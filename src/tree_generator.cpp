@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "tree_generator.h"
+
+namespace
+{
+    uint64_t SplitMix(uint64_t x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t ParseSize(const std::string& str)
+    {
+        size_t pos = 0;
+        uint64_t value = 0;
+        
+        try {
+            value = std::stoull(str, &pos);
+        }
+        catch (const std::exception&) {
+            throw std::invalid_argument("Invalid size: " + str);
+        }
+        
+        std::string suffix = str.substr(pos);
+        std::transform(suffix.begin(), suffix.end(), suffix.begin(),
+                       [](unsigned char c){ return std::tolower(c); });
+        
+        if (suffix.empty()) {
+            return value;
+        } else if (suffix == "k") {
+            return value << 10;
+        } else if (suffix == "m") {
+            return value << 20;
+        } else if (suffix == "g") {
+            return value << 30;
+        }
+        
+        throw std::invalid_argument("Invalid size suffix: " + str);
+    }
+
+    std::vector<std::string> Split(const std::string& str, char separator)
+    {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        
+        while (true) {
+            size_t end = str.find(separator, start);
+            parts.push_back(str.substr(start, end - start));
+            if (end == std::string::npos) {
+                break;
+            }
+            start = end + 1;
+        }
+        
+        return parts;
+    }
+
+    const char* kExtensions[] = {".bin", ".txt", ".jpg", ".dat", ".log", ".mp4"};
+}
+
+SizeDistribution SizeDistribution::Parse(const std::string& spec)
+{
+    auto parts = Split(spec, ':');
+    std::string kind = parts[0];
+    std::transform(kind.begin(), kind.end(), kind.begin(),
+                   [](unsigned char c){ return std::tolower(c); });
+    
+    SizeDistribution result;
+    
+    try {
+        if (kind == "fixed" && parts.size() == 2) {
+            result.kind = Kind::Fixed;
+            result.min = result.max = ParseSize(parts[1]);
+        } else if (kind == "uniform" && parts.size() == 3) {
+            result.kind = Kind::Uniform;
+            result.min = ParseSize(parts[1]);
+            result.max = ParseSize(parts[2]);
+        } else if (kind == "lognormal" && (parts.size() == 3 || parts.size() == 4)) {
+            result.kind = Kind::LogNormal;
+            result.mu = std::stod(parts[1]);
+            result.sigma = std::stod(parts[2]);
+            result.min = 0;
+            result.max = parts.size() == 4 ? ParseSize(parts[3]) : uint64_t{1} << 30;
+        } else {
+            throw std::invalid_argument("");
+        }
+    }
+    catch (const std::exception&) {
+        throw std::invalid_argument("Invalid size distribution: " + spec +
+                                    ". Supported: fixed:SIZE, uniform:MIN:MAX, lognormal:MU:SIGMA[:MAX]");
+    }
+    
+    if (result.min > result.max) {
+        throw std::invalid_argument("Invalid size distribution: " + spec + ", min is greater than max");
+    }
+    
+    return result;
+}
+
+TreeGenerator::TreeGenerator(const TreeSpec& spec) : spec_(spec), state_(spec.seed)
+{
+    double ratios = spec_.duplicate_ratio + spec_.near_duplicate_ratio + spec_.hardlink_ratio;
+    
+    if (spec_.duplicate_ratio < 0 || spec_.near_duplicate_ratio < 0 || spec_.hardlink_ratio < 0 || ratios > 1) {
+        throw std::invalid_argument("Duplicate, near-duplicate and hard link ratios must be non-negative and sum up to at most 1");
+    }
+    
+    if (spec_.sparse_ratio < 0 || spec_.sparse_ratio > 1) {
+        throw std::invalid_argument("Sparse ratio must be between 0 and 1");
+    }
+    
+    if (spec_.fanout == 0) {
+        throw std::invalid_argument("Fan-out must be greater than 0");
+    }
+}
+
+uint64_t TreeGenerator::Next()
+{
+    state_ = SplitMix(state_);
+    return state_;
+}
+
+double TreeGenerator::NextUnit()
+{
+    return static_cast<double>(Next() >> 11) * 0x1.0p-53;
+}
+
+uint64_t TreeGenerator::NextSize()
+{
+    const auto& sizes = spec_.sizes;
+    
+    switch (sizes.kind) {
+        case SizeDistribution::Kind::Fixed:
+            return sizes.min;
+        case SizeDistribution::Kind::Uniform:
+            return sizes.min + Next() % (sizes.max - sizes.min + 1);
+        case SizeDistribution::Kind::LogNormal: {
+            // Box-Muller keeps the sequence identical across standard libraries
+            constexpr double kPi = 3.14159265358979323846;
+            double u1 = std::max(NextUnit(), 1e-300);
+            double u2 = NextUnit();
+            double normal = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * kPi * u2);
+            double size = std::exp(sizes.mu + sizes.sigma * normal);
+            return std::min<uint64_t>(static_cast<uint64_t>(size), sizes.max);
+        }
+    }
+    
+    return sizes.min;
+}
+
+std::vector<boost::filesystem::path> TreeGenerator::MakeDirectories(const boost::filesystem::path& root)
+{
+    std::vector<boost::filesystem::path> directories{root};
+    boost::filesystem::create_directories(root);
+    
+    size_t level_begin = 0;
+    
+    for (size_t level = 0; level < spec_.depth; ++level) {
+        size_t level_end = directories.size();
+        
+        for (size_t i = level_begin; i < level_end; ++i) {
+            for (size_t child = 0; child < spec_.fanout; ++child) {
+                boost::filesystem::path dir = directories[i] / ("d" + std::to_string(child));
+                boost::filesystem::create_directory(dir);
+                directories.push_back(dir);
+            }
+        }
+        
+        level_begin = level_end;
+    }
+    
+    return directories;
+}
+
+void TreeGenerator::FillChunk(const Content& content, uint64_t chunk, char* buffer)
+{
+    uint64_t x = SplitMix(content.seed ^ (chunk * 0x9e3779b97f4a7c15ULL));
+    
+    for (size_t i = 0; i < kChunkSize; i += sizeof(uint64_t)) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        std::memcpy(buffer + i, &x, sizeof(x));
+    }
+    
+    uint64_t begin = chunk * kChunkSize;
+    if (content.mutation >= begin && content.mutation < begin + kChunkSize) {
+        buffer[content.mutation - begin] ^= 0x5a;
+    }
+}
+
+void TreeGenerator::WriteContent(const boost::filesystem::path& path, const Content& content)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create " + path.string() + ": " + std::strerror(errno));
+    }
+    
+    constexpr size_t kChunksPerWrite = 256;
+    std::vector<char> buffer(kChunkSize * kChunksPerWrite);
+    uint64_t chunks = (content.size + kChunkSize - 1) / kChunkSize;
+    
+    auto write_chunks = [&](uint64_t first, uint64_t last) {
+        for (uint64_t chunk = first; chunk < last; chunk += kChunksPerWrite) {
+            uint64_t count = std::min<uint64_t>(kChunksPerWrite, last - chunk);
+            for (uint64_t i = 0; i < count; ++i) {
+                FillChunk(content, chunk + i, buffer.data() + i * kChunkSize);
+            }
+            
+            uint64_t offset = chunk * kChunkSize;
+            size_t length = static_cast<size_t>(std::min<uint64_t>(count * kChunkSize, content.size - offset));
+            
+            if (::pwrite(fd, buffer.data(), length, static_cast<off_t>(offset)) != static_cast<ssize_t>(length)) {
+                int error = errno;
+                ::close(fd);
+                throw std::runtime_error("Cannot write " + path.string() + ": " + std::strerror(error));
+            }
+        }
+    };
+    
+    if (content.sparse) {
+        // data only in the first and the last chunk, a hole in between
+        if (::ftruncate(fd, static_cast<off_t>(content.size)) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot resize " + path.string() + ": " + std::strerror(error));
+        }
+        write_chunks(0, std::min<uint64_t>(1, chunks));
+        if (chunks > 1) {
+            write_chunks(chunks - 1, chunks);
+        }
+        
+        uint64_t mutated = content.mutation / kChunkSize;
+        if (content.mutation < content.size && mutated > 0 && mutated + 1 < chunks) {
+            char flipped = 0x5a;
+            if (::pwrite(fd, &flipped, 1, static_cast<off_t>(content.mutation)) != 1) {
+                int error = errno;
+                ::close(fd);
+                throw std::runtime_error("Cannot write " + path.string() + ": " + std::strerror(error));
+            }
+        }
+    } else {
+        write_chunks(0, chunks);
+    }
+    
+    ::close(fd);
+}
+
+GeneratedTree TreeGenerator::Generate(const boost::filesystem::path& root)
+{
+    state_ = spec_.seed;
+    GeneratedTree tree;
+    
+    auto directories = MakeDirectories(root);
+    tree.directories = directories.size();
+    
+    std::vector<Content> originals;
+    std::vector<boost::filesystem::path> original_paths;
+    
+    for (size_t i = 0; i < spec_.files; ++i) {
+        boost::filesystem::path path = directories[Next() % directories.size()] /
+            ("f" + std::to_string(i) + kExtensions[Next() % (sizeof(kExtensions) / sizeof(kExtensions[0]))]);
+        
+        double roll = NextUnit();
+        size_t source = originals.empty() ? 0 : Next() % originals.size();
+        
+        if (!originals.empty() && roll < spec_.duplicate_ratio) {
+            WriteContent(path, originals[source]);
+            tree.bytes += originals[source].size;
+            ++tree.duplicates;
+        } else if (!originals.empty() && roll < spec_.duplicate_ratio + spec_.near_duplicate_ratio) {
+            // same size and prefix, one byte differs somewhere in the second half
+            Content near = originals[source];
+            near.mutation = near.size == 0 ? UINT64_MAX : near.size / 2 + Next() % (near.size - near.size / 2);
+            WriteContent(path, near);
+            tree.bytes += near.size;
+            ++tree.near_duplicates;
+        } else if (!originals.empty() && roll < spec_.duplicate_ratio + spec_.near_duplicate_ratio + spec_.hardlink_ratio) {
+            boost::filesystem::create_hard_link(original_paths[source], path);
+            ++tree.hardlinks;
+        } else {
+            Content content{Next(), NextSize(), UINT64_MAX, NextUnit() < spec_.sparse_ratio};
+            WriteContent(path, content);
+            tree.bytes += content.size;
+            tree.sparse += content.sparse ? 1 : 0;
+            
+            originals.push_back(content);
+            original_paths.push_back(path);
+        }
+        
+        ++tree.files;
+    }
+    
+    return tree;
+}
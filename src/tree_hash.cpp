@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "parallel.h"
+#include "tree_hash.h"
+
+namespace
+{
+    constexpr uint32_t kSha256Rounds[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    
+    uint32_t RotateRight(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+    
+    class Sha256
+    {
+    public:
+        void Update(const uint8_t* data, size_t size)
+        {
+            length_ += size;
+            
+            if (filled_ > 0) {
+                size_t take = std::min(size, sizeof(buffer_) - filled_);
+                std::memcpy(buffer_ + filled_, data, take);
+                filled_ += take;
+                data += take;
+                size -= take;
+                if (filled_ < sizeof(buffer_)) {
+                    return;
+                }
+                Compress(buffer_);
+                filled_ = 0;
+            }
+            
+            for (; size >= 64; data += 64, size -= 64) {
+                Compress(data);
+            }
+            
+            std::memcpy(buffer_, data, size);
+            filled_ = size;
+        }
+        
+        TreeHash::Node Final()
+        {
+            uint64_t bits = length_ * 8;
+            uint8_t padding[72] = {0x80};
+            size_t pad = (filled_ < 56 ? 56 : 120) - filled_;
+            for (size_t i = 0; i < 8; ++i) {
+                padding[pad + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+            }
+            Update(padding, pad + 8);
+            
+            TreeHash::Node digest;
+            for (size_t w = 0; w < 8; ++w) {
+                for (size_t i = 0; i < 4; ++i) {
+                    digest[4 * w + i] = static_cast<uint8_t>(state_[w] >> (24 - 8 * i));
+                }
+            }
+            return digest;
+        }
+    
+    private:
+        uint32_t state_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                              0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        uint8_t buffer_[64];
+        size_t filled_ = 0;
+        uint64_t length_ = 0;
+        
+        void Compress(const uint8_t* block)
+        {
+            uint32_t w[64];
+            for (size_t i = 0; i < 16; ++i) {
+                w[i] = uint32_t{block[4 * i]} << 24 | uint32_t{block[4 * i + 1]} << 16 |
+                       uint32_t{block[4 * i + 2]} << 8 | uint32_t{block[4 * i + 3]};
+            }
+            for (size_t i = 16; i < 64; ++i) {
+                uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+            
+            uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+            uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+            
+            for (size_t i = 0; i < 64; ++i) {
+                uint32_t t1 = h + (RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25)) +
+                              ((e & f) ^ (~e & g)) + kSha256Rounds[i] + w[i];
+                uint32_t t2 = (RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22)) +
+                              ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            
+            state_[0] += a;
+            state_[1] += b;
+            state_[2] += c;
+            state_[3] += d;
+            state_[4] += e;
+            state_[5] += f;
+            state_[6] += g;
+            state_[7] += h;
+        }
+    };
+    
+    // largest power of two below count, count > 1
+    size_t LeftCount(size_t count)
+    {
+        size_t left = 1;
+        while (left * 2 < count) {
+            left *= 2;
+        }
+        return left;
+    }
+}
+
+TreeHash::Node TreeHash::Hash(const char* data, size_t size, size_t threads)
+{
+    return Split(reinterpret_cast<const uint8_t*>(data), size, threads, nullptr);
+}
+
+TreeHash::Node TreeHash::Hash(const char* data, size_t size, size_t threads, WorkerPool& pool)
+{
+    return Split(reinterpret_cast<const uint8_t*>(data), size, threads, &pool);
+}
+
+TreeHash::Node TreeHash::Split(const uint8_t* bytes, size_t size, size_t threads, WorkerPool* pool)
+{
+    if (threads <= 1 || size < kParallelMin) {
+        return Subtree(bytes, size);
+    }
+    
+    // aligned power-of-two runs, a few per thread so uneven workers still finish together
+    size_t run = kChunkSize;
+    while (run * 4 * threads < size) {
+        run *= 2;
+    }
+    
+    std::vector<Node> roots((size + run - 1) / run);
+    auto hash_run = [&](size_t i) {
+        size_t begin = i * run;
+        roots[i] = Subtree(bytes + begin, std::min(run, size - begin));
+    };
+    if (pool) {
+        ParallelFor(roots.size(), threads, hash_run, *pool);
+    } else {
+        ParallelFor(roots.size(), threads, hash_run);
+    }
+    
+    return Combine(roots);
+}
+
+TreeHash::Node TreeHash::Combine(const std::vector<Node>& nodes)
+{
+    if (nodes.empty()) {
+        return Subtree(reinterpret_cast<const uint8_t*>(""), 0);
+    }
+    
+    std::function<Node(size_t, size_t)> join = [&](size_t begin, size_t count) {
+        if (count == 1) {
+            return nodes[begin];
+        }
+        size_t left = LeftCount(count);
+        return Parent(join(begin, left), join(begin + left, count - left));
+    };
+    
+    return join(0, nodes.size());
+}
+
+TreeHash::Node TreeHash::Subtree(const uint8_t* data, size_t size)
+{
+    if (size <= kChunkSize) {
+        Sha256 leaf;
+        uint8_t flag = 0x00;
+        leaf.Update(&flag, 1);
+        leaf.Update(data, size);
+        return leaf.Final();
+    }
+    
+    size_t left = LeftCount((size + kChunkSize - 1) / kChunkSize) * kChunkSize;
+    return Parent(Subtree(data, left), Subtree(data + left, size - left));
+}
+
+TreeHash::Node TreeHash::Parent(const Node& left, const Node& right)
+{
+    Sha256 parent;
+    uint8_t flag = 0x01;
+    parent.Update(&flag, 1);
+    parent.Update(left.data(), left.size());
+    parent.Update(right.data(), right.size());
+    return parent.Final();
+}
@@ -1,21 +1,123 @@
 #include "utilities.h"
+#include "result_writer.h"
+#include "stats.h"
+#include <cstdio>
 
 void PrintResults(const std::vector<std::vector<boost::filesystem::path>>& duplicates)
 {
-    if (duplicates.empty()) {
-        std::cout << "No duplicate files found.\n";
-        return;
+    ResultWriter writer(OutputFormat::Text);
+    
+    for (const auto& group : duplicates) {
+        writer.WriteGroup(0, group);
     }
     
-    bool first_group = true;
+    writer.Finish();
+}
+
+void WriteResults(const std::vector<std::vector<boost::filesystem::path>>& duplicates, OutputFormat format, const std::function<std::string(const boost::filesystem::path&)>& digest)
+{
+    ResultWriter writer(format);
+    
     for (const auto& group : duplicates) {
-        if (!first_group) {
-            std::cout << '\n';
+        boost::system::error_code ec;
+        uintmax_t size = group.empty() ? 0 : boost::filesystem::file_size(group.front(), ec);
+        if (ec) {
+            size = 0;
+        }
+        
+        writer.WriteGroup(size, group, digest && !group.empty() ? digest(group.front()) : std::string());
+    }
+    
+    writer.Finish();
+}
+
+void WriteResults(const DirectoryGroups& groups, OutputFormat format, const std::function<std::string(const boost::filesystem::path&)>& digest)
+{
+    ResultWriter writer(format);
+    
+    // directory groups come first, their paths end with a separator
+    for (size_t i = 0; i < groups.directories.size(); ++i) {
+        writer.WriteGroup(groups.directory_sizes[i], groups.directories[i]);
+    }
+    
+    for (const auto& group : groups.files) {
+        boost::system::error_code ec;
+        uintmax_t size = group.empty() ? 0 : boost::filesystem::file_size(group.front(), ec);
+        if (ec) {
+            size = 0;
         }
-        first_group = false;
         
+        writer.WriteGroup(size, group, digest && !group.empty() ? digest(group.front()) : std::string());
+    }
+    
+    writer.Finish();
+}
+
+void WriteChunkReport(const ChunkReport& report, OutputFormat format)
+{
+    ResultWriter writer(format);
+    writer.SetEmptyText("No files sharing content found.\n");
+    
+    for (const auto& pair : report.similar) {
+        writer.WritePair(pair.percent, pair.shared_bytes, pair.first, pair.second);
+    }
+    
+    writer.Finish();
+    
+    char percent[32];
+    double saved = report.total_bytes == 0 ? 0 : 100.0 * static_cast<double>(report.SavedBytes()) / static_cast<double>(report.total_bytes);
+    std::snprintf(percent, sizeof(percent), "%.1f", saved);
+    
+    std::cerr << "Chunks: " << report.chunks << " in " << report.files << " files, " << report.unique_chunks << " distinct; "
+              << report.SavedBytes() << " of " << report.total_bytes << " bytes (" << percent << "%) could be saved by chunk deduplication\n";
+}
+
+void WriteSimilarityReport(const SimilarityReport& report, OutputFormat format)
+{
+    ResultWriter writer(format);
+    writer.SetEmptyText("No similar files found.\n");
+    
+    // equal signatures, the estimate for each of their pairs is 100%
+    for (const auto& copies : report.copies) {
+        writer.WriteSimilarGroup(100.0, copies);
+    }
+    for (const auto& pair : report.similar) {
+        writer.WritePair(pair.percent, pair.first, pair.second);
+    }
+    
+    writer.Finish();
+    
+    std::cerr << "Similarity: " << report.files << " files, " << report.copies.size() << " sets of copies, "
+              << report.candidates << " candidate pairs, " << report.similar.size() << " similar\n";
+}
+
+void PrintSharedGroups(const std::vector<std::vector<boost::filesystem::path>>& shared)
+{
+    if (shared.empty()) {
+        return;
+    }
+    
+    std::cerr << "Already sharing extents (reflinks or hard links), no data was read:\n";
+    
+    for (const auto& group : shared) {
+        std::cerr << '\n';
         for (const auto& file : group) {
-            std::cout << file << '\n';
+            std::cerr << file << '\n';
         }
     }
+}
+
+void PrintStats(StatsFormat format)
+{
+    if (format == StatsFormat::None) {
+        return;
+    }
+    
+    StatsSnapshot snapshot = Stats::Snapshot();
+    
+    if (format == StatsFormat::Json) {
+        Stats::PrintJson(std::cerr, snapshot);
+    } else {
+        Stats::PrintText(std::cerr, snapshot);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include <stdexcept>
+#include "worker_pool.h"
+#include "progress.h"
+
+WorkerPool::WorkerPool(size_t threads) : capacity_(threads)
+{
+    if (capacity_ == 0) {
+        throw std::invalid_argument("Worker pool needs at least one thread");
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkerPool::Start(size_t workers, std::function<void(size_t)> job)
+{
+    if (workers == 0 || workers > capacity_) {
+        throw std::invalid_argument("Worker count must be between 1 and the pool size");
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (remaining_ != 0) {
+            throw std::logic_error("Worker pool is already running a job");
+        }
+        
+        while (threads_.size() < workers) {
+            size_t index = threads_.size();
+            threads_.emplace_back([this, index]() { Work(index); });
+        }
+        
+        job_ = std::move(job);
+        progress_ = &Progress::Current();
+        workers_ = workers;
+        remaining_ = workers;
+        error_ = nullptr;
+        ++generation_;
+    }
+    wake_.notify_all();
+}
+
+void WorkerPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return remaining_ == 0; });
+    
+    job_ = nullptr;
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkerPool::Work(size_t index)
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    for (;;) {
+        wake_.wait(lock, [&]() { return stop_ || (generation_ != seen && index < workers_); });
+        if (stop_) {
+            return;
+        }
+        seen = generation_;
+        
+        // job_ stays untouched until Wait sees every worker done
+        lock.unlock();
+        std::exception_ptr error;
+        Progress::Attach(progress_);
+        try {
+            job_(index);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        Progress::Attach(nullptr);
+        lock.lock();
+        
+        if (error && !error_) {
+            error_ = error;
+        }
+        if (--remaining_ == 0) {
+            done_.notify_all();
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include "block_cache.h"
 #include "hasher.h"
+#include "stats.h"
 #include <boost/filesystem.hpp>
 #include <fstream>
 #include <memory>
@@ -209,21 +210,24 @@ TEST_F(BlockCacheTest, DifferentHashTypes) {
 }
 
 TEST_F(BlockCacheTest, BlockKeyHash) {
-    BlockKey key1{"file1", 0};
-    BlockKey key2{"file1", 0};
-    BlockKey key3{"file1", 1};
-    BlockKey key4{"file2", 0};
+    BlockKey key1{1, 0};
+    BlockKey key2{1, 0};
+    BlockKey key3{1, 1};
+    BlockKey key4{2, 0};
     
     BlockKeyHash hasher;
 
     EXPECT_EQ(hasher(key1), hasher(key2));
+    EXPECT_NE(hasher(key1), hasher(key3));
+    EXPECT_NE(hasher(key1), hasher(key4));
+    EXPECT_NE(hasher(key3), hasher(key4));
 }
 
 TEST_F(BlockCacheTest, BlockKeyEquality) {
-    BlockKey key1{"file1", 0};
-    BlockKey key2{"file1", 0};
-    BlockKey key3{"file1", 1};
-    BlockKey key4{"file2", 0};
+    BlockKey key1{1, 0};
+    BlockKey key2{1, 0};
+    BlockKey key3{1, 1};
+    BlockKey key4{2, 0};
     
     EXPECT_TRUE(key1 == key2);
     EXPECT_FALSE(key1 == key3);
@@ -254,4 +258,141 @@ TEST_F(BlockCacheTest, ReadEmptyFile) {
         std::string hash = cache.GetBlockHash(file, 0);
         EXPECT_FALSE(hash.empty());
     });
-}
\ No newline at end of file
+}
+
+TEST_F(BlockCacheTest, DirectIoMatchesBuffered) {
+    BlockCache buffered(4096, std::make_unique<Hasher>(HashType::CRC32));
+    BlockCache direct(4096, std::make_unique<Hasher>(HashType::CRC32), IoOptions{IoMode::Direct});
+    
+    auto file = GetTestFilePath("test_diff_blocks.bin");
+    
+    EXPECT_EQ(buffered.GetBlockHash(file, 0), direct.GetBlockHash(file, 0));
+    EXPECT_EQ(buffered.GetBlockHash(file, 1), direct.GetBlockHash(file, 1));
+    EXPECT_EQ(buffered.GetBlockHash(file, 2), direct.GetBlockHash(file, 2));
+}
+
+TEST_F(BlockCacheTest, DirectIoUnalignedBlockSize) {
+    BlockCache buffered(1000, std::make_unique<Hasher>(HashType::CRC32));
+    BlockCache direct(1000, std::make_unique<Hasher>(HashType::CRC32), IoOptions{IoMode::Direct});
+    
+    auto file = GetTestFilePath("test_diff_blocks.bin");
+    
+    for (size_t i = 0; i < direct.GetBlockCount(file); ++i) {
+        EXPECT_EQ(buffered.GetBlockHash(file, i), direct.GetBlockHash(file, i));
+    }
+}
+
+TEST_F(BlockCacheTest, LoadBlocksPhysicalOrder) {
+    BlockCache path_order(4096, std::make_unique<Hasher>(HashType::CRC32), IoOptions{IoMode::Buffered, IoSchedule::Path});
+    BlockCache physical_order(4096, std::make_unique<Hasher>(HashType::CRC32), IoOptions{IoMode::Buffered, IoSchedule::Physical});
+    
+    std::vector<fs::path> files = {
+        GetTestFilePath("test_diff_blocks.bin"),
+        GetTestFilePath("same1.bin"),
+        GetTestFilePath("non_existent_file.bin"),
+        GetTestFilePath("diff.bin")
+    };
+    
+    EXPECT_NO_THROW(path_order.LoadBlocks(files, 0));
+    EXPECT_NO_THROW(physical_order.LoadBlocks(files, 0));
+    
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (i == 2) {
+            EXPECT_THROW(physical_order.GetBlockHash(files[i], 0), std::runtime_error);
+            continue;
+        }
+        EXPECT_EQ(path_order.GetBlockHash(files[i], 0), physical_order.GetBlockHash(files[i], 0));
+    }
+}
+
+TEST_F(BlockCacheTest, ConstructorInvalidThreadCount) {
+    IoOptions io;
+    io.ssd_threads = 0;
+    EXPECT_THROW(BlockCache(4096, std::make_unique<Hasher>(HashType::CRC32), io), std::invalid_argument);
+}
+
+TEST_F(BlockCacheTest, LoadBlocksParallel) {
+    IoOptions io;
+    io.ssd_threads = 4;
+    io.hdd_threads = 4;
+    BlockCache serial(1024, std::make_unique<Hasher>(HashType::MD5));
+    BlockCache parallel(1024, std::make_unique<Hasher>(HashType::MD5), io);
+    
+    std::vector<fs::path> files;
+    for (int i = 0; i < 16; ++i) {
+        std::string name = "parallel" + std::to_string(i) + ".bin";
+        CreateTestFile(name, std::string(3000, static_cast<char>('a' + i % 4)));
+        files.push_back(GetTestFilePath(name));
+    }
+    
+    for (size_t block = 0; block < 3; ++block) {
+        parallel.LoadBlocks(files, block);
+        for (const auto& file : files) {
+            EXPECT_EQ(serial.GetBlockHash(file, block), parallel.GetBlockHash(file, block));
+        }
+    }
+}
+
+TEST_F(BlockCacheTest, LoadBlocksSplitsLargeTreeBlocks) {
+    const size_t block = 1 << 20;
+    std::string content(2 * block + 5000, '\0');
+    for (size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>(i * 131 + i / 4096);
+    }
+    CreateTestFile("tree1.bin", content);
+    CreateTestFile("tree2.bin", content);
+    std::vector<fs::path> files = {GetTestFilePath("tree1.bin"), GetTestFilePath("tree2.bin")};
+    
+    IoOptions io;
+    io.ssd_threads = 4;
+    io.hdd_threads = 4;
+    BlockCache cache(block, std::make_unique<Hasher>(HashType::SHA256Tree, 4), io);
+    
+    // two files leave the readers two spare threads each, a whole group would leave none
+    Stats::Reset();
+    for (size_t index = 0; index < 3; ++index) {
+        cache.LoadBlocks(files, index);
+    }
+    EXPECT_GE(Stats::Snapshot().Get(Counter::BlocksSplit), 2u);
+    
+    Hasher single(HashType::SHA256Tree);
+    std::string root = single.HashDigests({single.HashBlock(content.data(), content.size())});
+    for (const auto& file : files) {
+        EXPECT_EQ(cache.GetBlockHash(file, 0), single.HashBlock(content.data(), block));
+        // the tail block holds only the file's bytes, so the digest is the root of the file
+        EXPECT_EQ(cache.GetFileDigest(file), root);
+    }
+}
+
+TEST_F(BlockCacheTest, ForgetDropsDigests) {
+    auto hasher = std::make_unique<Hasher>(HashType::CRC32);
+    BlockCache cache(4096, std::move(hasher));
+    fs::path file = GetTestFilePath("test_diff_blocks.bin");
+    
+    size_t hashed = 0;
+    cache.SetDigestObserver([&hashed](const fs::path&, size_t, const std::string&) { ++hashed; });
+    
+    std::string first = cache.GetBlockHash(file, 1);
+    cache.GetBlockHash(file, 1);
+    EXPECT_EQ(hashed, 1u);
+    
+    cache.Forget(file);
+    EXPECT_EQ(cache.GetBlockHash(file, 1), first);
+    EXPECT_EQ(hashed, 2u);
+    EXPECT_EQ(cache.GetBlockCount(file), 2u);
+}
+
+TEST_F(BlockCacheTest, LoadedBlockCountsOneMiss) {
+    BlockCache cache(4096, std::make_unique<Hasher>(HashType::CRC32));
+    fs::path file = GetTestFilePath("test_diff_blocks.bin");
+    Stats::Reset();
+    
+    cache.LoadBlocks({file}, 0);
+    cache.GetBlockHash(file, 0);
+    cache.GetBlockHash(file, 0);
+    
+    StatsSnapshot snapshot = Stats::Snapshot();
+    EXPECT_EQ(snapshot.Get(Counter::CacheMisses), 1u);
+    EXPECT_EQ(snapshot.Get(Counter::CacheHits), 1u);
+    Stats::Reset();
+}
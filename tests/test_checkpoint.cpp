@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include "test_helpers.h"
+#include "checkpoint.h"
+#include "duplicate_finder.h"
+#include "hasher.h"
+#include "stats.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace fs = boost::filesystem;
+
+class CheckpointTest : public TempDirTest {
+protected:
+    void SetUp() override {
+        TempDirTest::SetUp();
+        fs::create_directories(root / "data");
+        journal = root / "run.ckpt";
+        config.block_size = 4096;
+        config.hash_type = HashType::MD5;
+    }
+    
+    std::unique_ptr<DuplicateFinder> Finder() {
+        return std::make_unique<DuplicateFinder>(std::make_unique<BlockCache>(config.block_size, std::make_unique<Hasher>(config.hash_type)));
+    }
+    
+    static std::vector<std::vector<fs::path>> Sorted(std::vector<std::vector<fs::path>> groups) {
+        std::sort(groups.begin(), groups.end());
+        return groups;
+    }
+    
+    fs::path journal;
+    Config config;
+};
+
+TEST_F(CheckpointTest, ResumeReusesGroupsAndDigests) {
+    std::string same = RandomData(40000, 1);
+    auto a = Write("data/a", same);
+    auto b = Write("data/b", same);
+    auto c = Write("data/c", RandomData(50000, 2));
+    std::string other = RandomData(50000, 3);
+    auto d = Write("data/d", other);
+    
+    std::vector<std::vector<fs::path>> expected;
+    {
+        Checkpoint checkpoint(journal, config, false);
+        SizeTable table = Table({a, b, c, d}, true);
+        checkpoint.RecordScan(table);
+        
+        auto finder = Finder();
+        finder->SetCheckpoint(&checkpoint);
+        expected = finder->Find(table);
+    }
+    ASSERT_EQ(expected.size(), 1u);
+    
+    Stats::Reset();
+    {
+        Checkpoint checkpoint(journal, config, true);
+        ASSERT_TRUE(checkpoint.HasScan());
+        SizeTable table = checkpoint.RestoreScan(true);
+        EXPECT_EQ(table.FileCount(), 4u);
+        
+        auto finder = Finder();
+        finder->SetCheckpoint(&checkpoint);
+        EXPECT_EQ(Sorted(finder->Find(table)), Sorted(expected));
+    }
+    
+    EXPECT_EQ(Stats::Snapshot().Get(Counter::BytesRead), 0u);
+}
+
+TEST_F(CheckpointTest, ChangedFilesAreCheckedAgain) {
+    std::string same = RandomData(40000, 4);
+    auto a = Write("data/a", same);
+    auto b = Write("data/b", same);
+    auto c = Write("data/c", RandomData(40000, 5));
+    
+    {
+        Checkpoint checkpoint(journal, config, false);
+        SizeTable table = Table({a, b, c}, true);
+        checkpoint.RecordScan(table);
+        
+        auto finder = Finder();
+        finder->SetCheckpoint(&checkpoint);
+        ASSERT_EQ(finder->Find(table).size(), 1u);
+    }
+    
+    // same size, new content and a new mtime
+    Write("data/c", same);
+    fs::last_write_time(c, fs::last_write_time(c) + 10);
+    fs::remove(b);
+    
+    Checkpoint checkpoint(journal, config, true);
+    SizeTable table = checkpoint.RestoreScan(true);
+    EXPECT_EQ(table.FileCount(), 2u);
+    
+    auto finder = Finder();
+    finder->SetCheckpoint(&checkpoint);
+    EXPECT_EQ(finder->Find(table), std::vector<std::vector<fs::path>>({{a, c}}));
+}
+
+TEST_F(CheckpointTest, RewriteWithinTheSameSecondIsCheckedAgain) {
+    std::string same = RandomData(40000, 8);
+    auto a = Write("data/a", same);
+    auto b = Write("data/b", same);
+    
+    struct stat before{};
+    ASSERT_EQ(::stat(b.c_str(), &before), 0);
+    {
+        Checkpoint checkpoint(journal, config, false);
+        SizeTable table = Table({a, b}, true);
+        checkpoint.RecordScan(table);
+        
+        auto finder = Finder();
+        finder->SetCheckpoint(&checkpoint);
+        ASSERT_EQ(finder->Find(table).size(), 1u);
+    }
+    
+    // same size and the same whole second, only the nanoseconds tell the rewrite apart
+    Write("data/b", RandomData(40000, 9));
+    timespec times[2] = {before.st_atim, before.st_mtim};
+    times[1].tv_nsec = (times[1].tv_nsec + 1) % 1000000000;
+    ASSERT_EQ(::utimensat(AT_FDCWD, b.c_str(), times, 0), 0);
+    
+    Checkpoint checkpoint(journal, config, true);
+    SizeTable table = checkpoint.RestoreScan(true);
+    
+    auto finder = Finder();
+    finder->SetCheckpoint(&checkpoint);
+    EXPECT_TRUE(finder->Find(table).empty());
+}
+
+TEST_F(CheckpointTest, ResolvedGroupNeedsTheSameFiles) {
+    auto a = Write("data/a", "same content");
+    auto b = Write("data/b", "same content");
+    auto c = Write("data/c", "same content");
+    
+    {
+        Checkpoint checkpoint(journal, config, false);
+        checkpoint.RecordScan(Table({a, b}, true));
+        checkpoint.RecordGroup(12, {a, b}, {{a, b}});
+    }
+    
+    Checkpoint checkpoint(journal, config, true);
+    checkpoint.RestoreScan(true);
+    
+    Checkpoint::Groups groups;
+    EXPECT_TRUE(checkpoint.Resolved(12, {b, a}, groups));
+    EXPECT_EQ(groups, Checkpoint::Groups({{a, b}}));
+    EXPECT_FALSE(checkpoint.Resolved(12, {a, b, c}, groups));
+    EXPECT_FALSE(checkpoint.Resolved(12, {a, c}, groups));
+}
+
+TEST_F(CheckpointTest, TruncatedTailIsIgnored) {
+    auto a = Write("data/a", "same content");
+    auto b = Write("data/b", "same content");
+    
+    {
+        Checkpoint checkpoint(journal, config, false);
+        SizeTable table = Table({a, b}, true);
+        checkpoint.RecordScan(table);
+        checkpoint.RecordGroup(12, {a, b}, {{a, b}});
+        checkpoint.Flush();
+    }
+    
+    fs::resize_file(journal, fs::file_size(journal) - 2);
+    
+    Checkpoint checkpoint(journal, config, true);
+    ASSERT_TRUE(checkpoint.HasScan());
+    EXPECT_EQ(checkpoint.RestoreScan(true).FileCount(), 2u);
+    
+    Checkpoint::Groups groups;
+    EXPECT_FALSE(checkpoint.Resolved(12, {a, b}, groups));
+}
+
+TEST_F(CheckpointTest, StartsOverWithoutResume) {
+    auto a = Write("data/a", "x");
+    {
+        Checkpoint checkpoint(journal, config, false);
+        checkpoint.RecordScan(Table({a}, true));
+    }
+    
+    EXPECT_FALSE(Checkpoint(journal, config, false).HasScan());
+    EXPECT_FALSE(Checkpoint(journal, config, true).HasScan());
+}
+
+TEST_F(CheckpointTest, RejectsOtherBlockSize) {
+    auto a = Write("data/a", "x");
+    {
+        Checkpoint checkpoint(journal, config, false);
+        checkpoint.RecordScan(Table({a}, true));
+    }
+    
+    Config other = config;
+    other.block_size = 8192;
+    EXPECT_THROW(Checkpoint(journal, other, true), std::runtime_error);
+}
+
+TEST_F(CheckpointTest, DigestsOfUnfinishedGroupsAreSeeded) {
+    auto a = Write("data/a", RandomData(10000, 6));
+    auto b = Write("data/b", RandomData(10000, 7));
+    
+    {
+        Checkpoint checkpoint(journal, config, false);
+        checkpoint.RecordScan(Table({a, b}, true));
+        checkpoint.RecordDigest(a, 0, "digest-a0");
+    }
+    
+    Checkpoint checkpoint(journal, config, true);
+    checkpoint.RestoreScan(true);
+    
+    BlockCache cache(config.block_size, std::make_unique<Hasher>(config.hash_type));
+    checkpoint.Attach(cache);
+    
+    Stats::Reset();
+    EXPECT_EQ(cache.GetBlockHash(a, 0), "digest-a0");
+    EXPECT_EQ(Stats::Snapshot().Get(Counter::BytesRead), 0u);
+}
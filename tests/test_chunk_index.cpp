@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "test_helpers.h"
+#include "chunk_index.h"
+
+namespace fs = boost::filesystem;
+
+class ChunkIndexTest : public TempDirTest {};
+
+TEST_F(ChunkIndexTest, FindsShiftedSharedContent) {
+    std::string shared = RandomData(3 << 20, 1);
+    auto a = Write("a.log", shared);
+    auto b = Write("b.log", RandomData(5000, 2) + shared.substr(0, 2 << 20) + RandomData(100, 3) + shared.substr(2 << 20));
+    auto c = Write("c.log", RandomData(3 << 20, 4));
+    
+    ChunkIndex index(4096, 2);
+    ChunkReport report = index.Analyze({a, b, c}, 50.0);
+    
+    ASSERT_EQ(report.similar.size(), 1u);
+    EXPECT_EQ(report.similar[0].first, a);
+    EXPECT_EQ(report.similar[0].second, b);
+    EXPECT_GT(report.similar[0].percent, 95.0);
+    
+    EXPECT_EQ(report.files, 3u);
+    EXPECT_EQ(report.total_bytes, fs::file_size(a) + fs::file_size(b) + fs::file_size(c));
+    EXPECT_GT(report.SavedBytes(), uintmax_t{3} << 20 * 95 / 100);
+    EXPECT_LT(report.SavedBytes(), uintmax_t{3} << 20);
+}
+
+TEST_F(ChunkIndexTest, ThresholdFiltersPairs) {
+    std::string shared = RandomData(1 << 20, 5);
+    auto a = Write("a", shared + RandomData(1 << 20, 6));
+    auto b = Write("b", shared + RandomData(1 << 20, 7));
+    
+    ChunkIndex index(4096, 1);
+    
+    auto low = index.Analyze({a, b}, 30.0);
+    ASSERT_EQ(low.similar.size(), 1u);
+    EXPECT_NEAR(low.similar[0].percent, 50.0, 5.0);
+    
+    EXPECT_TRUE(index.Analyze({a, b}, 70.0).similar.empty());
+}
+
+TEST_F(ChunkIndexTest, UnreadableFilesAreSkipped) {
+    auto a = Write("a", RandomData(10000, 8));
+    
+    ChunkIndex index(4096, 2);
+    ChunkReport report = index.Analyze({a, root / "missing"}, 0.0);
+    
+    EXPECT_EQ(report.files, 1u);
+    EXPECT_TRUE(report.similar.empty());
+    EXPECT_EQ(report.SavedBytes(), 0u);
+}
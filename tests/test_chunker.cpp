@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include "chunker.h"
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+    std::vector<uint8_t> RandomData(size_t size, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> data(size);
+        for (auto& byte : data) {
+            byte = static_cast<uint8_t>(rng());
+        }
+        return data;
+    }
+    
+    std::vector<size_t> Cuts(const Chunker& chunker, const std::vector<uint8_t>& data) {
+        std::vector<size_t> cuts;
+        size_t pos = 0;
+        while (pos < data.size()) {
+            pos += chunker.NextCut(data.data() + pos, data.size() - pos);
+            cuts.push_back(pos);
+        }
+        return cuts;
+    }
+}
+
+TEST(ChunkerTest, RejectsInvalidAverage) {
+    EXPECT_THROW(Chunker(1000), std::invalid_argument);
+    EXPECT_THROW(Chunker(32), std::invalid_argument);
+    EXPECT_NO_THROW(Chunker(4096));
+}
+
+TEST(ChunkerTest, ChunkSizesStayWithinBounds) {
+    Chunker chunker(4096);
+    auto data = RandomData(1 << 20, 1);
+    
+    size_t previous = 0;
+    auto cuts = Cuts(chunker, data);
+    for (size_t i = 0; i < cuts.size(); ++i) {
+        size_t length = cuts[i] - previous;
+        EXPECT_LE(length, chunker.MaxSize());
+        if (i + 1 < cuts.size()) {
+            EXPECT_GT(length, chunker.MinSize());
+        }
+        previous = cuts[i];
+    }
+    
+    double average = static_cast<double>(data.size()) / static_cast<double>(cuts.size());
+    EXPECT_GT(average, 4096 * 0.5);
+    EXPECT_LT(average, 4096 * 2.0);
+}
+
+TEST(ChunkerTest, ShortInputIsOneChunk) {
+    Chunker chunker(4096);
+    auto data = RandomData(100, 2);
+    
+    EXPECT_EQ(chunker.NextCut(data.data(), data.size()), 100u);
+}
+
+TEST(ChunkerTest, CutsSurviveInsertedPrefix) {
+    Chunker chunker(4096);
+    auto data = RandomData(1 << 20, 3);
+    auto shifted = RandomData(777, 4);
+    shifted.insert(shifted.end(), data.begin(), data.end());
+    
+    std::set<size_t> original;
+    for (size_t cut : Cuts(chunker, data)) {
+        original.insert(cut);
+    }
+    
+    size_t same = 0;
+    auto moved = Cuts(chunker, shifted);
+    for (size_t cut : moved) {
+        if (cut >= 777 && original.count(cut - 777)) {
+            ++same;
+        }
+    }
+    
+    EXPECT_GT(same, moved.size() * 9 / 10);
+}
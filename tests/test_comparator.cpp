@@ -4,6 +4,7 @@
 #include "hasher.h"
 #include <boost/filesystem.hpp>
 #include <fstream>
+#include <unistd.h>
 
 namespace fs = boost::filesystem;
 
@@ -248,4 +249,76 @@ TEST_F(ComparatorTest, DifferentBlockSizes) {
             GetTestFilePath("file1.bin"), 
             GetTestFilePath("file2.bin")));
     }
-}
\ No newline at end of file
+}
+
+TEST_F(ComparatorTest, FindDuplicatesDifferInLaterBlock) {
+    auto hasher = std::make_unique<Hasher>(HashType::CRC32);
+    auto cache = std::make_unique<BlockCache>(4, std::move(hasher));
+    Comparator comparator(*cache, 2);
+    
+    CreateTestFile("multi1.bin", "AAAABBBBCCCCDDDD");
+    CreateTestFile("multi2.bin", "AAAABBBBCCCCDDDD");
+    CreateTestFile("multi3.bin", "AAAABBBBCCCCXXXX");
+    CreateTestFile("multi4.bin", "AAAAXXXXCCCCDDDD");
+    
+    std::vector<boost::filesystem::path> files = {
+        GetTestFilePath("multi3.bin"),
+        GetTestFilePath("multi1.bin"),
+        GetTestFilePath("multi4.bin"),
+        GetTestFilePath("multi2.bin")
+    };
+    
+    auto result = comparator.FindDuplicates(files);
+    
+    ASSERT_EQ(result.size(), 1);
+    ASSERT_EQ(result[0].size(), 2);
+    EXPECT_EQ(result[0][0], GetTestFilePath("multi1.bin"));
+    EXPECT_EQ(result[0][1], GetTestFilePath("multi2.bin"));
+}
+
+TEST_F(ComparatorTest, FindDuplicatesSkipsUnreadableFiles) {
+    auto hasher = std::make_unique<Hasher>(HashType::CRC32);
+    auto cache = std::make_unique<BlockCache>(4096, std::move(hasher));
+    Comparator comparator(*cache, 0);
+    
+    std::vector<boost::filesystem::path> files = {
+        GetTestFilePath("nonexistent.bin"),
+        GetTestFilePath("file1.bin"),
+        GetTestFilePath("file2.bin")
+    };
+    
+    auto result = comparator.FindDuplicates(files);
+    
+    ASSERT_EQ(result.size(), 1);
+    EXPECT_EQ(result[0].size(), 2);
+}
+
+TEST_F(ComparatorTest, FindDuplicatesSharedExtents) {
+    auto hasher = std::make_unique<Hasher>(HashType::CRC32);
+    auto cache = std::make_unique<BlockCache>(4096, std::move(hasher));
+    Comparator comparator(*cache);
+    
+    CreateTestFile("linked.bin", std::string(10000, 'L'));
+    fs::create_hard_link(GetTestFilePath("linked.bin"), GetTestFilePath("link.bin"));
+    ::sync();
+    
+    if (cache->GetExtentSignature(GetTestFilePath("linked.bin")).empty()) {
+        GTEST_SKIP() << "filesystem does not report stable extents";
+    }
+    
+    std::vector<boost::filesystem::path> files = {
+        GetTestFilePath("linked.bin"),
+        GetTestFilePath("file1.bin"),
+        GetTestFilePath("link.bin")
+    };
+    
+    auto result = comparator.FindDuplicates(files);
+    
+    ASSERT_EQ(result.size(), 1);
+    ASSERT_EQ(result[0].size(), 2);
+    EXPECT_EQ(result[0][0], GetTestFilePath("linked.bin"));
+    EXPECT_EQ(result[0][1], GetTestFilePath("link.bin"));
+    
+    ASSERT_EQ(comparator.SharedGroups().size(), 1);
+    EXPECT_EQ(comparator.SharedGroups()[0].size(), 2);
+}
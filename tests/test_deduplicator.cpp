@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "deduplicator.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sys/stat.h>
+
+namespace fs = boost::filesystem;
+
+class DeduplicatorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        temp_dir = fs::temp_directory_path() / "deduplicator_test";
+        fs::create_directories(temp_dir);
+        
+        CreateTestFile("a.bin", "Duplicate content");
+        CreateTestFile("b.bin", "Duplicate content");
+        CreateTestFile("c.bin", "Duplicate content");
+    }
+    
+    void TearDown() override {
+        try {
+            fs::remove_all(temp_dir);
+        } catch (...) {
+        }
+    }
+    
+    void CreateTestFile(const std::string& filename, const std::string& content) {
+        std::ofstream file((temp_dir / filename).string(), std::ios::binary);
+        file.write(content.data(), content.size());
+    }
+    
+    std::vector<std::vector<fs::path>> Groups() {
+        return {{temp_dir / "a.bin", temp_dir / "b.bin", temp_dir / "c.bin"}};
+    }
+    
+    static ino_t Inode(const fs::path& p) {
+        struct stat st{};
+        ::stat(p.c_str(), &st);
+        return st.st_ino;
+    }
+    
+    fs::path temp_dir;
+};
+
+TEST_F(DeduplicatorTest, ConstructorInvalidThreads) {
+    EXPECT_THROW(Deduplicator(DedupAction::Delete, false, true, 0), std::invalid_argument);
+}
+
+TEST_F(DeduplicatorTest, DryRunChangesNothing) {
+    Deduplicator deduplicator(DedupAction::Delete, true);
+    
+    DedupReport report = deduplicator.Apply(Groups());
+    
+    EXPECT_EQ(report.replaced, 2);
+    EXPECT_EQ(report.failed, 0);
+    EXPECT_TRUE(fs::exists(temp_dir / "b.bin"));
+    EXPECT_TRUE(fs::exists(temp_dir / "c.bin"));
+}
+
+TEST_F(DeduplicatorTest, DeleteKeepsFirst) {
+    Deduplicator deduplicator(DedupAction::Delete, false);
+    
+    DedupReport report = deduplicator.Apply(Groups());
+    
+    EXPECT_EQ(report.replaced, 2);
+    EXPECT_EQ(report.bytes, 2 * std::string("Duplicate content").size());
+    EXPECT_TRUE(fs::exists(temp_dir / "a.bin"));
+    EXPECT_FALSE(fs::exists(temp_dir / "b.bin"));
+    EXPECT_FALSE(fs::exists(temp_dir / "c.bin"));
+}
+
+TEST_F(DeduplicatorTest, HardlinkReplacesFiles) {
+    Deduplicator deduplicator(DedupAction::Hardlink, false);
+    
+    DedupReport report = deduplicator.Apply(Groups());
+    
+    EXPECT_EQ(report.replaced, 2);
+    EXPECT_EQ(Inode(temp_dir / "a.bin"), Inode(temp_dir / "b.bin"));
+    EXPECT_EQ(Inode(temp_dir / "a.bin"), Inode(temp_dir / "c.bin"));
+    EXPECT_EQ(fs::hard_link_count(temp_dir / "a.bin"), 3);
+    
+    DedupReport second = deduplicator.Apply(Groups());
+    EXPECT_EQ(second.replaced, 0);
+}
+
+TEST_F(DeduplicatorTest, ChangedSizeIsSkipped) {
+    CreateTestFile("c.bin", "Duplicate content, modified after the scan");
+    
+    Deduplicator deduplicator(DedupAction::Delete, false);
+    DedupReport report = deduplicator.Apply(Groups());
+    
+    EXPECT_EQ(report.replaced, 1);
+    EXPECT_EQ(report.failed, 1);
+    EXPECT_TRUE(fs::exists(temp_dir / "c.bin"));
+}
+
+TEST_F(DeduplicatorTest, DifferentContentIsKept) {
+    // same size and, as far as a weak hash goes, the same group
+    CreateTestFile("c.bin", "Duplicate cONTENT");
+    
+    Deduplicator deduplicator(DedupAction::Delete, false);
+    DedupReport report = deduplicator.Apply(Groups());
+    
+    EXPECT_EQ(report.replaced, 1);
+    EXPECT_EQ(report.failed, 1);
+    EXPECT_FALSE(fs::exists(temp_dir / "b.bin"));
+    EXPECT_TRUE(fs::exists(temp_dir / "c.bin"));
+}
+
+TEST_F(DeduplicatorTest, SameInodeIsSkipped) {
+    fs::remove(temp_dir / "b.bin");
+    fs::create_hard_link(temp_dir / "a.bin", temp_dir / "b.bin");
+    
+    Deduplicator deduplicator(DedupAction::Delete, false);
+    DedupReport report = deduplicator.Apply({{temp_dir / "a.bin", temp_dir / "b.bin"}});
+    
+    EXPECT_EQ(report.replaced, 0);
+    EXPECT_EQ(report.failed, 0);
+    EXPECT_TRUE(fs::exists(temp_dir / "b.bin"));
+}
+
+TEST_F(DeduplicatorTest, ReflinkFailureKeepsFiles) {
+    Deduplicator deduplicator(DedupAction::Reflink, false);
+    
+    DedupReport report = deduplicator.Apply(Groups());
+    
+    EXPECT_EQ(report.replaced + report.failed, 2);
+    EXPECT_TRUE(fs::exists(temp_dir / "b.bin"));
+    EXPECT_TRUE(fs::exists(temp_dir / "c.bin"));
+    EXPECT_EQ(fs::file_size(temp_dir / "b.bin"), fs::file_size(temp_dir / "a.bin"));
+    
+    size_t leftovers = 0;
+    for (const auto& entry : fs::directory_iterator(temp_dir)) {
+        if (entry.path().string().find(".bayan-") != std::string::npos) {
+            ++leftovers;
+        }
+    }
+    EXPECT_EQ(leftovers, 0);
+}
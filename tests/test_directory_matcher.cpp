@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "directory_matcher.h"
+#include "block_cache.h"
+#include "duplicate_finder.h"
+#include "hasher.h"
+#include "scanner.h"
+#include <algorithm>
+#include <fstream>
+
+namespace fs = boost::filesystem;
+
+class DirectoryMatcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        root = fs::temp_directory_path() / "directory_matcher_test";
+        fs::remove_all(root);
+        
+        for (const char* copy : {"a", "b"}) {
+            CreateFile(fs::path(copy) / "x.txt", "one");
+            CreateFile(fs::path(copy) / "y.txt", "two");
+            CreateFile(fs::path(copy) / "sub" / "z.txt", "three");
+        }
+        CreateFile("c/x.txt", "one");
+        CreateFile("c/u.txt", "unique");
+        CreateFile("d/sub/z.txt", "three");
+        
+        root = fs::canonical(root);
+    }
+    
+    void TearDown() override {
+        fs::remove_all(root);
+    }
+    
+    fs::path Dir(const std::string& name, const std::string& sub = {}) {
+        return fs::path((sub.empty() ? root / name : root / name / sub).string() + "/");
+    }
+    
+    void CreateFile(const fs::path& relative, const std::string& content) {
+        fs::create_directories((root / relative).parent_path());
+        std::ofstream(( root / relative).string()) << content;
+    }
+    
+    DirectoryGroups Run() {
+        Config config;
+        config.include_dirs.push_back(root);
+        config.depth = 5;
+        
+        Scanner scanner(config);
+        SizeTable table = scanner.ScanTable(false);
+        
+        DuplicateFinder finder(std::make_unique<BlockCache>(4096, std::make_unique<Hasher>(HashType::MD5)));
+        auto duplicates = finder.Find(table);
+        
+        DirectoryMatcher matcher(config.include_dirs);
+        return matcher.Match(table, duplicates);
+    }
+    
+    fs::path root;
+};
+
+TEST_F(DirectoryMatcherTest, ReportsMaximalSubtrees) {
+    DirectoryGroups groups = Run();
+    
+    ASSERT_EQ(groups.directories.size(), 2u);
+    EXPECT_EQ(groups.directories[0], (std::vector<fs::path>{Dir("a"), Dir("b")}));
+    EXPECT_EQ(groups.directory_sizes[0], 11u);
+    
+    // b/sub is implied by a == b, but d/sub has no duplicated parent
+    EXPECT_EQ(groups.directories[1], (std::vector<fs::path>{Dir("a", "sub"), Dir("b", "sub"), Dir("d", "sub")}));
+    EXPECT_EQ(groups.directory_sizes[1], 5u);
+}
+
+TEST_F(DirectoryMatcherTest, FilesInsideCopiesAreNotRepeated) {
+    DirectoryGroups groups = Run();
+    
+    ASSERT_EQ(groups.files.size(), 1u);
+    std::sort(groups.files[0].begin(), groups.files[0].end());
+    EXPECT_EQ(groups.files[0], (std::vector<fs::path>{root / "a" / "x.txt", root / "c" / "x.txt"}));
+}
+
+TEST_F(DirectoryMatcherTest, NamesMatter) {
+    fs::rename(root / "b" / "y.txt", root / "b" / "renamed.txt");
+    
+    DirectoryGroups groups = Run();
+    
+    ASSERT_EQ(groups.directories.size(), 1u);
+    EXPECT_EQ(groups.directories[0].size(), 3u);
+    EXPECT_EQ(groups.files.size(), 2u);
+}
+
+TEST_F(DirectoryMatcherTest, UniqueFileBreaksAncestors) {
+    CreateFile("b/sub/extra.txt", "only here");
+    
+    DirectoryGroups groups = Run();
+    
+    ASSERT_EQ(groups.directories.size(), 1u);
+    EXPECT_EQ(groups.directories[0], (std::vector<fs::path>{Dir("a", "sub"), Dir("d", "sub")}));
+}
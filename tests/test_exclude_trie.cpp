@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include "exclude_trie.h"
+
+namespace fs = boost::filesystem;
+
+TEST(ExcludeTrieTest, EmptyNeverExcludes) {
+    ExcludeTrie trie({});
+    
+    size_t cursor = trie.Start("/tmp");
+    EXPECT_EQ(cursor, ExcludeTrie::kOutside);
+    EXPECT_FALSE(trie.Excluded(trie.Descend(cursor, "x")));
+}
+
+TEST(ExcludeTrieTest, DescendToExcludedDirectory) {
+    ExcludeTrie trie({"/data/photos/cache", "/data/tmp"});
+    
+    size_t data = trie.Start("/data");
+    EXPECT_FALSE(trie.Excluded(data));
+    
+    size_t photos = trie.Descend(data, "photos");
+    EXPECT_FALSE(trie.Excluded(photos));
+    EXPECT_TRUE(trie.Excluded(trie.Descend(photos, "cache")));
+    EXPECT_TRUE(trie.Excluded(trie.Descend(data, "tmp")));
+    
+    size_t other = trie.Descend(data, "music");
+    EXPECT_EQ(other, ExcludeTrie::kOutside);
+    EXPECT_FALSE(trie.Excluded(trie.Descend(other, "tmp")));
+}
+
+TEST(ExcludeTrieTest, StartInsideExcludedDirectory) {
+    ExcludeTrie trie({"/data/tmp"});
+    
+    EXPECT_TRUE(trie.Excluded(trie.Start("/data/tmp")));
+    EXPECT_TRUE(trie.Excluded(trie.Start("/data/tmp/a/b")));
+    EXPECT_FALSE(trie.Excluded(trie.Start("/data/tmpfile")));
+}
+
+TEST(ExcludeTrieTest, NormalizesPaths) {
+    ExcludeTrie trie({"/data/./photos/../tmp/"});
+    
+    EXPECT_TRUE(trie.Excluded(trie.Descend(trie.Start("/data"), "tmp")));
+    EXPECT_TRUE(trie.Excluded(trie.Start("/data/photos/../tmp")));
+}
+
+TEST(ExcludeTrieTest, RelativeExcludesUseCurrentDirectory) {
+    ExcludeTrie trie({"build"});
+    
+    size_t cwd = trie.Start(fs::current_path());
+    EXPECT_TRUE(trie.Excluded(trie.Descend(cwd, "build")));
+    EXPECT_TRUE(trie.Excluded(trie.Start("build")));
+    EXPECT_FALSE(trie.Excluded(trie.Start("src")));
+}
+
+TEST(ExcludeTrieTest, HiddenEntriesInsideExcludedDirectory) {
+    ExcludeTrie trie({"/data"});
+    
+    EXPECT_TRUE(trie.Excluded(trie.Start("/data/.hidden")));
+}
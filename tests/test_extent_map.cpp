@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include "extent_map.h"
+#include <limits>
+
+TEST(ExtentMapTest, PhysicalOffsetInsideExtent) {
+    std::vector<Extent> extents = {
+        {0, 100000, 4096, 0},
+        {4096, 50000, 8192, 0}
+    };
+    
+    EXPECT_EQ(PhysicalOffset(extents, 0), 100000);
+    EXPECT_EQ(PhysicalOffset(extents, 100), 100100);
+    EXPECT_EQ(PhysicalOffset(extents, 4096), 50000);
+    EXPECT_EQ(PhysicalOffset(extents, 8192), 54096);
+}
+
+TEST(ExtentMapTest, PhysicalOffsetUnmapped) {
+    std::vector<Extent> extents = {
+        {4096, 50000, 4096, 0}
+    };
+    
+    EXPECT_EQ(PhysicalOffset(extents, 0), std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(PhysicalOffset(extents, 8192), std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(PhysicalOffset({}, 0), std::numeric_limits<uint64_t>::max());
+}
+
+TEST(ExtentMapTest, SignatureRejectsUnstableExtents) {
+    std::vector<Extent> stable = {{0, 100000, 4096, 0}};
+    std::vector<Extent> delayed = {{0, 0, 4096, 0x4}};
+    
+    EXPECT_FALSE(ExtentSignature(1, 4096, stable).empty());
+    EXPECT_EQ(ExtentSignature(1, 4096, stable), ExtentSignature(1, 4096, stable));
+    EXPECT_NE(ExtentSignature(1, 4096, stable), ExtentSignature(2, 4096, stable));
+    EXPECT_NE(ExtentSignature(1, 4096, stable), ExtentSignature(1, 4000, stable));
+    EXPECT_TRUE(ExtentSignature(1, 4096, delayed).empty());
+    EXPECT_TRUE(ExtentSignature(1, 4096, {}).empty());
+}
@@ -115,4 +115,52 @@ TEST(FilterTest, FixedFilename) {
     EXPECT_TRUE(filter.Match("readme.md"));
     EXPECT_FALSE(filter.Match("Makefile.txt"));
     EXPECT_FALSE(filter.Match("README.txt"));
-}
\ No newline at end of file
+}
+
+TEST(FilterTest, PrefixAndSuffixForms) {
+    std::vector<std::string> masks = {"*.tar.gz", "IMG_*", "*"};
+    Filter all(masks);
+    EXPECT_TRUE(all.Match("anything"));
+    
+    Filter filter({"*.tar.gz", "IMG_*"});
+    EXPECT_TRUE(filter.Match("backup.TAR.GZ"));
+    EXPECT_TRUE(filter.Match(".tar.gz"));
+    EXPECT_TRUE(filter.Match("img_0001.jpg"));
+    EXPECT_TRUE(filter.Match("IMG_"));
+    EXPECT_FALSE(filter.Match("backup.gz"));
+    EXPECT_FALSE(filter.Match("my_img_1.jpg"));
+}
+
+TEST(FilterTest, MixedMaskKinds) {
+    Filter filter({"*.jpg", "*.png", "*.jpeg", "report-??.*", "*backup*", "notes.txt"});
+    
+    EXPECT_TRUE(filter.Match("photo.JPEG"));
+    EXPECT_TRUE(filter.Match("report-01.pdf"));
+    EXPECT_TRUE(filter.Match("old_backup_2020.zip"));
+    EXPECT_TRUE(filter.Match("Notes.TXT"));
+    EXPECT_FALSE(filter.Match("report-001.pdf"));
+    EXPECT_FALSE(filter.Match("notes.txt.bak"));
+    EXPECT_FALSE(filter.Match("photo.jp"));
+}
+
+TEST(FilterTest, LongNames) {
+    Filter filter({"*.txt", "a*b?"});
+    std::string name(1000, 'A');
+    
+    EXPECT_TRUE(filter.Match(name + ".TXT"));
+    EXPECT_TRUE(filter.Match(name + "bc"));
+    EXPECT_FALSE(filter.Match(name));
+}
+
+TEST(FilterTest, CopiesKeepMatching) {
+    Filter copy({"*.txt"});
+    {
+        Filter original({"*.log", "data_*"});
+        copy = original;
+    }
+    Filter moved(std::move(copy));
+    
+    EXPECT_TRUE(moved.Match("server.log"));
+    EXPECT_TRUE(moved.Match("DATA_1.bin"));
+    EXPECT_FALSE(moved.Match("notes.txt"));
+}
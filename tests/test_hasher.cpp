@@ -2,6 +2,7 @@
 #include "hasher.h"
 #include <string>
 #include <cstring>
+#include <vector>
 
 TEST(HasherTest, Constructor) {
     EXPECT_NO_THROW(Hasher(HashType::CRC32));
@@ -28,4 +29,73 @@ TEST(HasherTest, HashBlockMd5) {
     
     auto hash2 = hasher.HashBlock(test_data.c_str(), test_data.size());
     EXPECT_EQ(hash, hash2);
-}
\ No newline at end of file
+}
+
+TEST(HasherTest, Md5MatchesRfc1321) {
+    // the test suite of RFC 1321, appendix A.5
+    const std::vector<std::pair<std::string, std::string>> vectors = {
+        {"", "d41d8cd98f00b204e9800998ecf8427e"},
+        {"a", "0cc175b9c0f1b6a831c399e269772661"},
+        {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+        {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+        {"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+        {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f"},
+        {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a"},
+    };
+    Hasher hasher(HashType::MD5);
+    
+    std::vector<BlockView> views;
+    for (const auto& [message, digest] : vectors) {
+        EXPECT_EQ(hasher.HashBlock(message.data(), message.size()), digest) << message;
+        views.push_back({message.data(), message.size()});
+    }
+    
+    std::vector<std::string> digests(views.size());
+    hasher.HashBlocks(views.data(), views.size(), digests.data());
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        EXPECT_EQ(digests[i], vectors[i].second) << vectors[i].first;
+    }
+}
+
+TEST(HasherTest, HashBlocksMatchesHashBlock) {
+    for (HashType type : {HashType::CRC32, HashType::MD5}) {
+        Hasher hasher(type);
+        
+        // every padding case: empty, tails shorter and longer than 56 bytes, exact chunks
+        std::vector<std::string> data;
+        for (size_t size : {0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000, 4096, 4097, 70000}) {
+            std::string block(size, '\0');
+            for (size_t i = 0; i < size; ++i) {
+                block[i] = static_cast<char>(i * 131 + size);
+            }
+            data.push_back(block);
+        }
+        
+        std::vector<BlockView> views;
+        for (const auto& block : data) {
+            views.push_back({block.data(), block.size()});
+        }
+        
+        std::vector<std::string> digests(views.size());
+        hasher.HashBlocks(views.data(), views.size(), digests.data());
+        
+        for (size_t i = 0; i < data.size(); ++i) {
+            EXPECT_EQ(digests[i], hasher.HashBlock(data[i].data(), data[i].size())) << data[i].size();
+        }
+    }
+}
+
+TEST(HasherTest, HashBlocksMd5ShortMessages) {
+    Hasher hasher(HashType::MD5);
+    
+    std::string empty;
+    std::string fox = "The quick brown fox jumps over the lazy dog";
+    std::vector<BlockView> views = {{empty.data(), 0}, {fox.data(), fox.size()}, {fox.data(), fox.size()}};
+    std::vector<std::string> digests(views.size());
+    
+    hasher.HashBlocks(views.data(), views.size(), digests.data());
+    
+    EXPECT_EQ(digests[0], hasher.HashBlock(empty.data(), 0));
+    EXPECT_EQ(digests[1], hasher.HashBlock(fox.data(), fox.size()));
+    EXPECT_EQ(digests[2], digests[1]);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "size_table.h"
+
+// Fixture for tests that work on real files. Every test gets an empty directory of its own,
+// named uniquely, so test processes running in parallel never share files.
+class TempDirTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        root = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("bayan-test-%%%%-%%%%-%%%%-%%%%");
+        boost::filesystem::create_directories(root);
+    }
+    
+    void TearDown() override {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(root, ec);
+    }
+    
+    static std::string RandomData(size_t size, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::string data(size, '\0');
+        for (auto& c : data) {
+            c = static_cast<char>(rng());
+        }
+        return data;
+    }
+    
+    // name is relative to root, its directory must exist
+    boost::filesystem::path Write(const std::string& name, const std::string& content) {
+        std::ofstream out((root / name).string(), std::ios::binary);
+        out << content;
+        return root / name;
+    }
+    
+    static SizeTable Table(const std::vector<boost::filesystem::path>& files, bool drop_singletons) {
+        SizeTable table;
+        for (const auto& file : files) {
+            table.Add(boost::filesystem::file_size(file), file);
+        }
+        table.Finalize(drop_singletons);
+        return table;
+    }
+    
+    boost::filesystem::path root;
+};
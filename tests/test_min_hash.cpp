@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "test_helpers.h"
+#include "min_hash.h"
+#include <cmath>
+
+namespace fs = boost::filesystem;
+
+class MinHashTest : public TempDirTest {};
+
+TEST_F(MinHashTest, SignatureEstimatesJaccard) {
+    MinHashIndex index(1024, 1, 512);
+    
+    std::vector<uint64_t> a, b;
+    for (uint64_t i = 0; i < 3000; ++i) {
+        a.push_back(i);
+    }
+    for (uint64_t i = 1000; i < 4000; ++i) {
+        b.push_back(i);
+    }
+    
+    // |a & b| = 2000, |a | b| = 4000
+    EXPECT_NEAR(MinHashIndex::Similarity(index.Sign(a), index.Sign(b)), 0.5, 0.07);
+    EXPECT_DOUBLE_EQ(MinHashIndex::Similarity(index.Sign(a), index.Sign(a)), 1.0);
+    EXPECT_TRUE(index.Sign({}).empty());
+    EXPECT_DOUBLE_EQ(MinHashIndex::Similarity({}, {}), 0.0);
+}
+
+TEST_F(MinHashTest, ChooseBandsKeepsRecallAtThreshold) {
+    for (double threshold : {0.3, 0.5, 0.8, 0.95}) {
+        auto [bands, rows] = MinHashIndex::ChooseBands(128, threshold);
+        
+        EXPECT_LE(bands * rows, 128u);
+        double found = 1.0 - std::pow(1.0 - std::pow(threshold, rows), bands);
+        EXPECT_GE(found, 0.95) << threshold;
+    }
+    
+    EXPECT_GT(MinHashIndex::ChooseBands(128, 0.9).second, MinHashIndex::ChooseBands(128, 0.5).second);
+}
+
+TEST_F(MinHashTest, FindsEditedCopies) {
+    std::string base = RandomData(1 << 20, 1);
+    std::string edited = base.substr(0, 300000) + "inserted text" + base.substr(300000, 400000) + base.substr(710000);
+    
+    auto a = Write("a.txt", base);
+    auto b = Write("b.txt", edited);
+    auto c = Write("c.txt", RandomData(1 << 20, 2));
+    auto d = Write("d.txt", "");
+    
+    MinHashIndex index(1024, 2);
+    SimilarityReport report = index.Find({a, b, c, d, root / "missing"}, 80.0);
+    
+    EXPECT_EQ(report.files, 3u);
+    ASSERT_EQ(report.similar.size(), 1u);
+    EXPECT_EQ(report.similar[0].first, a);
+    EXPECT_EQ(report.similar[0].second, b);
+    EXPECT_GT(report.similar[0].percent, 90.0);
+    EXPECT_LT(report.similar[0].percent, 100.0);
+}
+
+TEST_F(MinHashTest, CopiesAreReportedOnce) {
+    std::string base = RandomData(1 << 20, 6);
+    std::string edited = base.substr(0, 300000) + "inserted text" + base.substr(300000, 400000) + base.substr(710000);
+    
+    auto a = Write("a", base);
+    auto b = Write("b", base);
+    auto c = Write("c", base);
+    auto d = Write("d", edited);
+    
+    MinHashIndex index(1024, 1);
+    SimilarityReport report = index.Find({a, b, c, d}, 80.0);
+    
+    ASSERT_EQ(report.copies.size(), 1u);
+    EXPECT_EQ(report.copies[0], (std::vector<fs::path>{a, b, c}));
+    ASSERT_EQ(report.similar.size(), 1u);
+    EXPECT_EQ(report.similar[0].first, a);
+    EXPECT_EQ(report.similar[0].second, d);
+    EXPECT_EQ(report.candidates, 1u);
+}
+
+TEST_F(MinHashTest, ThresholdFiltersPairs) {
+    std::string shared = RandomData(1 << 20, 3);
+    auto a = Write("a", shared + RandomData(1 << 20, 4));
+    auto b = Write("b", shared + RandomData(1 << 20, 5));
+    
+    MinHashIndex index(4096, 1);
+    
+    // half of each file is shared, so the chunk sets have Jaccard about 1/3
+    auto low = index.Find({a, b}, 20.0);
+    ASSERT_EQ(low.similar.size(), 1u);
+    EXPECT_NEAR(low.similar[0].percent, 33.3, 12.0);
+    
+    EXPECT_TRUE(index.Find({a, b}, 70.0).similar.empty());
+}
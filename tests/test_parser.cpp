@@ -262,6 +262,17 @@ TEST_F(ParserTest, ParseHashType) {
     config = parser.Parse(argc, argv);
     EXPECT_EQ(config.hash_type, HashType::MD5);
 
+    args = {"./bayan", "--hash", "sha256tree"};
+    argv = CreateArgv(args);
+    
+    config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.hash_type, HashType::SHA256Tree);
+
+    args = {"./bayan", "--hash", "sha256tree", "--block", "3072"};
+    argv = CreateArgv(args);
+    
+    EXPECT_THROW(parser.Parse(argc, argv), std::runtime_error);
+
     args = {"./bayan"};
     argv = CreateArgv(args);
     
@@ -288,6 +299,27 @@ TEST_F(ParserTest, ParseHashTypeInvalid) {
     EXPECT_THROW(parser.Parse(argc, argv), std::runtime_error);
 }
 
+TEST_F(ParserTest, ParseIoMode) {
+    Parser parser;
+
+    std::vector<std::string> args = {"./bayan"};
+    char** argv = CreateArgv(args);
+    
+    Config config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.io.mode, IoMode::Buffered);
+
+    args = {"./bayan", "--io", "direct"};
+    argv = CreateArgv(args);
+    
+    config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.io.mode, IoMode::Direct);
+
+    args = {"./bayan", "--io", "mmap"};
+    argv = CreateArgv(args);
+    
+    EXPECT_THROW(parser.Parse(argc, argv), std::runtime_error);
+}
+
 TEST_F(ParserTest, ParseComplexCommand) {
     Parser parser;
     
@@ -495,4 +527,104 @@ TEST_F(ParserTest, ParseDuplicateOptions) {
     EXPECT_EQ(config.block_size, 2048);
     EXPECT_EQ(config.hash_type, HashType::MD5);
     EXPECT_TRUE(config.Validate());
-}
\ No newline at end of file
+}
+
+TEST_F(ParserTest, ParseAction) {
+    Parser parser;
+
+    std::vector<std::string> args = {"./bayan"};
+    char** argv = CreateArgv(args);
+    
+    Config config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.action, DedupAction::None);
+    EXPECT_FALSE(config.dry_run);
+
+    args = {"./bayan", "--action", "hardlink", "--dry-run"};
+    argv = CreateArgv(args);
+    
+    config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.action, DedupAction::Hardlink);
+    EXPECT_TRUE(config.dry_run);
+
+    args = {"./bayan", "--action", "symlink"};
+    argv = CreateArgv(args);
+    
+    EXPECT_THROW(parser.Parse(argc, argv), std::runtime_error);
+}
+
+TEST_F(ParserTest, ParseNoVerify) {
+    Parser parser;
+
+    std::vector<std::string> args = {"./bayan", "--action", "delete"};
+    char** argv = CreateArgv(args);
+    
+    Config config = parser.Parse(argc, argv);
+    EXPECT_TRUE(config.verify);
+
+    args = {"./bayan", "--action", "delete", "--hash", "md5", "--no-verify"};
+    argv = CreateArgv(args);
+    
+    config = parser.Parse(argc, argv);
+    EXPECT_FALSE(config.verify);
+
+    args = {"./bayan", "--action", "dedupe", "--no-verify"};
+    argv = CreateArgv(args);
+    
+    EXPECT_NO_THROW(parser.Parse(argc, argv));
+
+    args = {"./bayan", "--action", "delete", "--no-verify"};
+    argv = CreateArgv(args);
+    
+    EXPECT_THROW(parser.Parse(argc, argv), std::runtime_error);
+}
+
+TEST_F(ParserTest, ParseOutputFormat) {
+    Parser parser;
+
+    std::vector<std::string> args = {"./bayan"};
+    char** argv = CreateArgv(args);
+    
+    Config config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.format, OutputFormat::Text);
+    EXPECT_FALSE(config.digests);
+
+    args = {"./bayan", "--format", "jsonl", "--digests"};
+    argv = CreateArgv(args);
+    
+    config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.format, OutputFormat::JsonLines);
+    EXPECT_TRUE(config.digests);
+
+    args = {"./bayan", "--format", "xml"};
+    argv = CreateArgv(args);
+    
+    EXPECT_THROW(parser.Parse(argc, argv), std::runtime_error);
+}
+
+TEST_F(ParserTest, ParseAnalysisMode) {
+    Parser parser;
+
+    std::vector<std::string> args = {"./bayan"};
+    char** argv = CreateArgv(args);
+    
+    Config config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.mode, AnalysisMode::Exact);
+
+    args = {"./bayan", "--mode", "similar", "--chunk-size", "1024", "--similarity", "80"};
+    argv = CreateArgv(args);
+    
+    config = parser.Parse(argc, argv);
+    EXPECT_EQ(config.mode, AnalysisMode::Similar);
+    EXPECT_EQ(config.chunk_size, 1024);
+    EXPECT_DOUBLE_EQ(config.similarity, 80.0);
+
+    args = {"./bayan", "--mode", "chunks", "--action", "delete"};
+    argv = CreateArgv(args);
+    
+    EXPECT_THROW(parser.Parse(argc, argv), std::runtime_error);
+
+    args = {"./bayan", "--mode", "fuzzy"};
+    argv = CreateArgv(args);
+    
+    EXPECT_THROW(parser.Parse(argc, argv), std::runtime_error);
+}
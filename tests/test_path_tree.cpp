@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include "path_tree.h"
+
+TEST(PathTreeTest, RebuildsPaths) {
+    PathTree tree;
+    uint32_t root = tree.Add(PathTree::kRoot, "/home/user");
+    uint32_t docs = tree.Add(root, "docs");
+    uint32_t file = tree.Add(docs, "report.txt");
+    
+    EXPECT_EQ(tree.Path(file), "/home/user/docs/report.txt");
+    EXPECT_EQ(tree.String(docs), "/home/user/docs");
+    EXPECT_EQ(tree.Name(file), "report.txt");
+    EXPECT_EQ(tree.Parent(file), docs);
+    EXPECT_EQ(tree.Parent(root), PathTree::kRoot);
+    EXPECT_EQ(tree.Size(), 3u);
+}
+
+TEST(PathTreeTest, FilesystemRootAndRelativePaths) {
+    PathTree tree;
+    uint32_t slash = tree.Add(PathTree::kRoot, "/");
+    uint32_t relative = tree.Add(PathTree::kRoot, "");
+    
+    EXPECT_EQ(tree.String(tree.Add(slash, "etc")), "/etc");
+    EXPECT_EQ(tree.String(tree.Add(relative, "file")), "file");
+}
+
+TEST(PathTreeTest, CopyTakesOnlyNeededAncestors) {
+    PathTree tree;
+    uint32_t root = tree.Add(PathTree::kRoot, "/r");
+    uint32_t a = tree.Add(root, "a");
+    tree.Add(root, "unused");
+    uint32_t f1 = tree.Add(a, "f1");
+    uint32_t f2 = tree.Add(a, "f2");
+    
+    PathTree copy;
+    std::vector<uint32_t> remap;
+    uint32_t c2 = copy.Copy(tree, f2, remap);
+    uint32_t c1 = copy.Copy(tree, f1, remap);
+    
+    EXPECT_EQ(copy.Size(), 4u);
+    EXPECT_EQ(copy.String(c1), "/r/a/f1");
+    EXPECT_EQ(copy.String(c2), "/r/a/f2");
+    EXPECT_EQ(copy.Parent(c1), copy.Parent(c2));
+}
+
+TEST(PathTreeTest, UnknownNodes) {
+    PathTree tree;
+    
+    EXPECT_THROW(tree.Add(0, "x"), std::out_of_range);
+    EXPECT_THROW(tree.Path(0), std::out_of_range);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "progress.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iterator>
+
+class ProgressTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Progress::Reset();
+    }
+    
+    void TearDown() override {
+        Progress::Reset();
+    }
+};
+
+TEST_F(ProgressTest, SnapshotCollectsCounters) {
+    Progress::AddEntries(10);
+    Progress::AddCandidateBytes(4096);
+    Progress::AddBytesHashed(1024);
+    Progress::AddBytesSkipped(512);
+    Progress::AddGroups(3);
+    Progress::AddGroupsResolved(1);
+    
+    ProgressSnapshot snapshot = Progress::Snapshot();
+    EXPECT_EQ(snapshot.entries, 10u);
+    EXPECT_EQ(snapshot.candidate_bytes, 4096u);
+    EXPECT_EQ(snapshot.bytes_hashed, 1024u);
+    EXPECT_EQ(snapshot.bytes_skipped, 512u);
+    EXPECT_EQ(snapshot.groups_total, 3u);
+    EXPECT_EQ(snapshot.groups_resolved, 1u);
+}
+
+TEST_F(ProgressTest, FormatLineShowsRatesAndEta) {
+    ProgressSnapshot previous;
+    ProgressSnapshot now;
+    now.entries = 200;
+    now.candidate_bytes = 3 * 1024 * 1024;
+    now.bytes_hashed = 1024 * 1024;
+    now.groups_total = 4;
+    now.groups_resolved = 1;
+    
+    std::string line = ProgressReporter::FormatLine(now, previous, 2.0);
+    
+    EXPECT_NE(line.find("scanned 200 (100/s)"), std::string::npos);
+    EXPECT_NE(line.find("hashed 1.0 MiB of 3.0 MiB (512.0 KiB/s)"), std::string::npos);
+    EXPECT_NE(line.find("groups 1/4"), std::string::npos);
+    EXPECT_NE(line.find("ETA 00:00:04"), std::string::npos);
+}
+
+TEST_F(ProgressTest, FormatLineWithoutProgressHasNoEta) {
+    ProgressSnapshot previous;
+    ProgressSnapshot now;
+    now.candidate_bytes = 4096;
+    
+    std::string line = ProgressReporter::FormatLine(now, previous, 1.0);
+    
+    EXPECT_NE(line.find("ETA --:--:--"), std::string::npos);
+}
+
+TEST_F(ProgressTest, SkippedBytesCountAsResolved) {
+    ProgressSnapshot previous;
+    ProgressSnapshot now;
+    now.candidate_bytes = 1000;
+    now.bytes_hashed = 100;
+    now.bytes_skipped = 900;
+    
+    std::string json = ProgressReporter::FormatJson(now, previous, 1.0);
+    
+    EXPECT_NE(json.find("\"remaining_bytes\":0"), std::string::npos);
+    EXPECT_NE(json.find("\"eta_seconds\":0"), std::string::npos);
+}
+
+TEST_F(ProgressTest, ReporterWritesStatusFile) {
+    boost::filesystem::path status = boost::filesystem::temp_directory_path() / "bayan_progress_test.json";
+    boost::filesystem::remove(status);
+    
+    Progress::AddEntries(7);
+    {
+        ProgressReporter reporter(false, status.string(), std::chrono::milliseconds(10));
+    }
+    
+    std::ifstream in(status.string());
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    boost::filesystem::remove(status);
+    
+    EXPECT_NE(content.find("\"entries\":7"), std::string::npos);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "test_helpers.h"
+#include "reference_index.h"
+
+namespace fs = boost::filesystem;
+
+class ReferenceIndexTest : public TempDirTest {
+protected:
+    void SetUp() override {
+        TempDirTest::SetUp();
+        fs::create_directories(root / "archive");
+        fs::create_directories(root / "drop");
+    }
+};
+
+TEST_F(ReferenceIndexTest, PrefixOffsetsGrowGeometrically) {
+    EXPECT_TRUE(ReferenceIndex::PrefixOffsets(64 << 10).empty());
+    EXPECT_EQ(ReferenceIndex::PrefixOffsets((64 << 10) + 1), std::vector<uintmax_t>({64 << 10}));
+    EXPECT_EQ(ReferenceIndex::PrefixOffsets(20 << 20), std::vector<uintmax_t>({64 << 10, 1 << 20, 16 << 20}));
+}
+
+TEST_F(ReferenceIndexTest, QueryFindsArchivedContent) {
+    std::string big = RandomData(3 << 20, 1);
+    auto a1 = Write("archive/big.bin", big);
+    auto a2 = Write("archive/small.txt", "hello archive");
+    auto a3 = Write("archive/other.bin", RandomData(5000, 2));
+    
+    ReferenceIndex index = ReferenceIndex::Build(Table({a1, a2, a3}, false), 2);
+    ASSERT_EQ(index.Entries().size(), 3u);
+    
+    auto q1 = Write("drop/copy.bin", big);
+    auto q2 = Write("drop/copy.txt", "hello archive");
+    auto q3 = Write("drop/new.txt", "hello ARCHIVE");
+    auto q4 = Write("drop/unique.bin", RandomData(7000, 3));
+    
+    ReferenceReport report = index.Query(Table({q1, q2, q3, q4}, false), 2);
+    
+    EXPECT_EQ(report.files, 4u);
+    EXPECT_EQ(report.candidates, 3u);
+    
+    auto matches = report.matches;
+    std::sort(matches.begin(), matches.end());
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matches[0], std::vector<fs::path>({q1, a1}));
+    EXPECT_EQ(matches[1], std::vector<fs::path>({q2, a2}));
+}
+
+TEST_F(ReferenceIndexTest, PrefixMismatchStopsHashing) {
+    std::string big = RandomData(4 << 20, 4);
+    auto archived = Write("archive/big.bin", big);
+    ReferenceIndex index = ReferenceIndex::Build(Table({archived}, false), 1);
+    
+    std::string changed = big;
+    changed[10] ^= 1;
+    auto early = Write("drop/early.bin", changed);
+    
+    uintmax_t read = 0;
+    EXPECT_TRUE(index.Find(early, changed.size(), &read).empty());
+    EXPECT_EQ(read, ReferenceIndex::kFirstPrefix);
+    
+    changed = big;
+    changed.back() ^= 1;
+    auto late = Write("drop/late.bin", changed);
+    
+    EXPECT_TRUE(index.Find(late, changed.size(), &read).empty());
+    EXPECT_EQ(read, changed.size());
+}
+
+TEST_F(ReferenceIndexTest, SaveAndLoadRoundTrip) {
+    auto a = Write("archive/a", RandomData(2 << 20, 5));
+    auto b = Write("archive/b", "b");
+    ReferenceIndex index = ReferenceIndex::Build(Table({a, b}, false), 1);
+    
+    fs::path file = root / "archive.idx";
+    index.Save(file);
+    ReferenceIndex loaded = ReferenceIndex::Load(file);
+    
+    ASSERT_EQ(loaded.Entries().size(), 2u);
+    for (size_t i = 0; i < 2; ++i) {
+        EXPECT_EQ(loaded.Entries()[i].size, index.Entries()[i].size);
+        EXPECT_EQ(loaded.Entries()[i].file, index.Entries()[i].file);
+        EXPECT_EQ(loaded.Entries()[i].prefixes, index.Entries()[i].prefixes);
+        EXPECT_EQ(loaded.Entries()[i].digest, index.Entries()[i].digest);
+    }
+    
+    auto copy = Write("drop/a", RandomData(2 << 20, 5));
+    EXPECT_EQ(loaded.Find(copy, fs::file_size(copy)), std::vector<fs::path>({a}));
+}
+
+TEST_F(ReferenceIndexTest, LoadRejectsBadFiles) {
+    EXPECT_THROW(ReferenceIndex::Load(root / "missing.idx"), std::runtime_error);
+    EXPECT_THROW(ReferenceIndex::Load(Write("bad.idx", "not an index")), std::runtime_error);
+    
+    auto a = Write("archive/a", "content");
+    fs::path file = root / "archive.idx";
+    ReferenceIndex::Build(Table({a}, false), 1).Save(file);
+    fs::resize_file(file, fs::file_size(file) - 3);
+    
+    EXPECT_THROW(ReferenceIndex::Load(file), std::runtime_error);
+}
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include "result_writer.h"
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+class ResultWriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        output = fs::temp_directory_path() / "result_writer_test.out";
+        fd = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ASSERT_GE(fd, 0);
+    }
+    
+    void TearDown() override {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fs::remove(output);
+    }
+    
+    std::string ReadOutput() {
+        std::ifstream in(output.string(), std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        return buffer.str();
+    }
+    
+    fs::path output;
+    int fd = -1;
+};
+
+TEST_F(ResultWriterTest, TextMatchesPathStreaming) {
+    std::vector<fs::path> first = {"/data/a.txt", "/data/with \"quote\" & amp.txt"};
+    std::vector<fs::path> second = {"/data/b.txt", "/data/c.txt"};
+    
+    {
+        ResultWriter writer(OutputFormat::Text, fd, 16);
+        writer.WriteGroup(10, first);
+        writer.WriteGroup(20, second);
+    }
+    
+    std::ostringstream expected;
+    expected << first[0] << '\n' << first[1] << '\n' << '\n' << second[0] << '\n' << second[1] << '\n';
+    
+    EXPECT_EQ(ReadOutput(), expected.str());
+}
+
+TEST_F(ResultWriterTest, TextEmpty) {
+    {
+        ResultWriter writer(OutputFormat::Text, fd);
+    }
+    
+    EXPECT_EQ(ReadOutput(), "No duplicate files found.\n");
+}
+
+TEST_F(ResultWriterTest, JsonGroups) {
+    {
+        ResultWriter writer(OutputFormat::Json, fd);
+        writer.WriteGroup(100, {"/a", "/b", "/c"}, "abcd");
+        writer.WriteGroup(5, {"/new\nline", "/x"});
+    }
+    
+    EXPECT_EQ(ReadOutput(),
+              "[\n"
+              "{\"size\":100,\"count\":3,\"wasted\":200,\"digest\":\"abcd\",\"files\":[\"/a\",\"/b\",\"/c\"]},\n"
+              "{\"size\":5,\"count\":2,\"wasted\":5,\"files\":[\"/new\\nline\",\"/x\"]}\n"
+              "]\n");
+}
+
+TEST_F(ResultWriterTest, JsonLinesGroups) {
+    {
+        ResultWriter writer(OutputFormat::JsonLines, fd);
+        writer.WriteGroup(7, {"/a", "/b"});
+        writer.WriteGroup(8, {"/c", "/d"});
+    }
+    
+    EXPECT_EQ(ReadOutput(),
+              "{\"size\":7,\"count\":2,\"wasted\":7,\"files\":[\"/a\",\"/b\"]}\n"
+              "{\"size\":8,\"count\":2,\"wasted\":8,\"files\":[\"/c\",\"/d\"]}\n");
+}
+
+TEST_F(ResultWriterTest, JsonNonUtf8Names) {
+    // Latin-1 names from an old archive next to UTF-8 ones; \xc3\xa9 is "e acute" in UTF-8
+    fs::path dir = fs::temp_directory_path() / fs::unique_path("bayan-test-%%%%-%%%%");
+    fs::create_directories(dir);
+    fs::path latin = dir / "caf\xe9.txt";
+    fs::path utf8 = dir / "caf\xc3\xa9.txt";
+    std::ofstream(latin.string()) << "x";
+    std::ofstream(utf8.string()) << "x";
+    ASSERT_TRUE(fs::exists(latin));
+    
+    {
+        ResultWriter writer(OutputFormat::JsonLines, fd);
+        writer.WriteGroup(1, {latin, utf8, "/cut\xc3", "/overlong\xc0\xaf", "/surrogate\xed\xa0\x80"});
+    }
+    fs::remove_all(dir);
+    
+    std::string prefix = dir.string();
+    EXPECT_EQ(ReadOutput(),
+              "{\"size\":1,\"count\":5,\"wasted\":4,\"files\":[\"" + prefix + "/caf\\u00e9.txt\",\"" + prefix + "/caf\xc3\xa9.txt\","
+              "\"/cut\\u00c3\",\"/overlong\\u00c0\\u00af\",\"/surrogate\\u00ed\\u00a0\\u0080\"]}\n");
+}
+
+TEST_F(ResultWriterTest, BinaryGroups) {
+    {
+        ResultWriter writer(OutputFormat::Binary, fd);
+        writer.WriteGroup(300, {"/a", "/bb"}, "ff");
+    }
+    
+    std::string data = ReadOutput();
+    
+    auto read_integer = [&data](size_t& pos, size_t bytes) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+        }
+        pos += bytes;
+        return value;
+    };
+    
+    ASSERT_EQ(data.substr(0, 4), "BAYN");
+    size_t pos = 4;
+    EXPECT_EQ(read_integer(pos, 4), ResultWriter::kBinaryVersion);
+    EXPECT_EQ(read_integer(pos, 8), 300);
+    EXPECT_EQ(read_integer(pos, 4), 2);
+    EXPECT_EQ(read_integer(pos, 8), 300);
+    ASSERT_EQ(read_integer(pos, 2), 2);
+    EXPECT_EQ(data.substr(pos, 2), "ff");
+    pos += 2;
+    ASSERT_EQ(read_integer(pos, 4), 2);
+    EXPECT_EQ(data.substr(pos, 2), "/a");
+    pos += 2;
+    ASSERT_EQ(read_integer(pos, 4), 3);
+    EXPECT_EQ(data.substr(pos, 3), "/bb");
+    pos += 3;
+    
+    EXPECT_EQ(read_integer(pos, 8), 0);
+    EXPECT_EQ(read_integer(pos, 4), 0);
+    EXPECT_EQ(pos + 8 + 2, data.size());
+}
+
+TEST_F(ResultWriterTest, Pairs) {
+    {
+        ResultWriter writer(OutputFormat::Json, fd);
+        writer.WritePair(75.0, 4096, "/a", "/b\"c");
+        writer.WritePair(33.333, "/c", "/d");
+    }
+    
+    EXPECT_EQ(ReadOutput(),
+              "[\n"
+              "{\"similarity\":75.0,\"shared\":4096,\"files\":[\"/a\",\"/b\\\"c\"]},\n"
+              "{\"similarity\":33.3,\"files\":[\"/c\",\"/d\"]}\n"
+              "]\n");
+}
+
+TEST_F(ResultWriterTest, PairsText) {
+    {
+        ResultWriter writer(OutputFormat::Text, fd);
+        writer.WritePair(75.0, 4096, "/a", "/b");
+    }
+    {
+        ResultWriter writer(OutputFormat::Text, fd);
+        writer.SetEmptyText("No similar files found.\n");
+    }
+    
+    EXPECT_EQ(ReadOutput(), "75.0% 4096 \"/a\" \"/b\"\nNo similar files found.\n");
+}
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include "test_helpers.h"
+#include "search.h"
+#include <algorithm>
+#include <thread>
+
+namespace fs = boost::filesystem;
+
+class SearchTest : public TempDirTest {
+protected:
+    void SetUp() override {
+        TempDirTest::SetUp();
+        fs::create_directories(root / "a");
+        fs::create_directories(root / "b");
+        
+        Write("a/one.bin", RandomData(10000, 1));
+        Write("b/one.bin", RandomData(10000, 1));
+        Write("a/two.bin", RandomData(20000, 2));
+        Write("b/two.bin", RandomData(20000, 2));
+        Write("b/other.bin", RandomData(20000, 3));
+        
+        options.include_dirs = {root};
+        options.depth = 1;
+    }
+    
+    SearchOptions options;
+};
+
+TEST_F(SearchTest, GroupsArriveThroughTheCallback) {
+    SearchEngine engine;
+    SearchRun run(engine, options);
+    
+    std::vector<std::vector<std::string>> groups;
+    run.OnGroup([&groups](const std::vector<fs::path>& group) {
+        std::vector<std::string> names;
+        for (const auto& file : group) {
+            names.push_back(file.parent_path().filename().string() + "/" + file.filename().string());
+        }
+        std::sort(names.begin(), names.end());
+        groups.push_back(names);
+    });
+    
+    size_t progress_calls = 0;
+    run.OnProgress([&progress_calls](const ProgressSnapshot&) { ++progress_calls; });
+    
+    SearchResult result = run.Execute();
+    
+    EXPECT_EQ(result.status, SearchStatus::Completed);
+    EXPECT_EQ(result.files, 5u);
+    EXPECT_EQ(result.groups, 2u);
+    std::sort(groups.begin(), groups.end());
+    EXPECT_EQ(groups, (std::vector<std::vector<std::string>>{{"a/one.bin", "b/one.bin"}, {"a/two.bin", "b/two.bin"}}));
+    EXPECT_GE(progress_calls, 1u);
+}
+
+TEST_F(SearchTest, CancelledBeforeStart) {
+    SearchEngine engine;
+    SearchRun run(engine, options);
+    size_t groups = 0;
+    run.OnGroup([&groups](const std::vector<fs::path>&) { ++groups; });
+    
+    CancellationToken token;
+    token.Cancel();
+    SearchResult result = run.Execute(&token);
+    
+    EXPECT_EQ(result.status, SearchStatus::Cancelled);
+    EXPECT_EQ(groups, 0u);
+}
+
+TEST_F(SearchTest, CancelledFromCallback) {
+    SearchEngine engine;
+    SearchRun run(engine, options);
+    
+    CancellationToken token;
+    size_t groups = 0;
+    run.OnGroup([&](const std::vector<fs::path>&) {
+        ++groups;
+        token.Cancel();
+    });
+    
+    SearchResult result = run.Execute(&token);
+    
+    EXPECT_EQ(result.status, SearchStatus::Cancelled);
+    EXPECT_EQ(groups, 1u);
+}
+
+TEST_F(SearchTest, Budgets) {
+    SearchEngine engine;
+    
+    options.memory_limit = 1;
+    EXPECT_EQ(SearchRun(engine, options).Execute().status, SearchStatus::MemoryLimit);
+    
+    options.memory_limit = 0;
+    options.time_limit = std::chrono::milliseconds(1);
+    SearchRun slow(engine, options);
+    slow.OnProgress([](const ProgressSnapshot&) { std::this_thread::sleep_for(std::chrono::milliseconds(2)); },
+                    std::chrono::milliseconds(0));
+    EXPECT_EQ(slow.Execute().status, SearchStatus::TimeLimit);
+}
+
+TEST_F(SearchTest, CallbacksMayUseTheirEngine) {
+    SearchEngine engine;
+    SearchRun run(engine, options);
+    
+    size_t group_calls = 0;
+    run.OnGroup([&](const std::vector<fs::path>&) {
+        ++group_calls;
+        EXPECT_GT(engine.CacheMemoryUsage(), 0u);
+        engine.ClearCache();
+    });
+    size_t progress_calls = 0;
+    run.OnProgress([&](const ProgressSnapshot&) {
+        ++progress_calls;
+        engine.CacheMemoryUsage();
+        engine.ClearCache();
+    }, std::chrono::milliseconds(0));
+    
+    SearchResult result = run.Execute();
+    
+    EXPECT_EQ(result.status, SearchStatus::Completed);
+    EXPECT_EQ(result.groups, 2u);
+    EXPECT_EQ(group_calls, 2u);
+    EXPECT_GT(progress_calls, 1u);
+}
+
+TEST_F(SearchTest, NoNestedSearchOnTheSameEngine) {
+    SearchEngine engine;
+    SearchRun run(engine, options);
+    run.OnGroup([&](const std::vector<fs::path>&) {
+        EXPECT_THROW(SearchRun(engine, options).Execute(), std::logic_error);
+    });
+    
+    EXPECT_EQ(run.Execute().groups, 2u);
+}
+
+TEST_F(SearchTest, MemoryLimitHoldsWithoutDuplicates) {
+    SearchEngine engine;
+    ASSERT_EQ(SearchRun(engine, options).Execute().groups, 2u);
+    size_t warm = engine.CacheMemoryUsage();
+    
+    // same sizes, different content: nothing is resolved as a group, the sink never runs
+    fs::create_directories(root / "c");
+    Write("c/one.bin", RandomData(10000, 4));
+    Write("c/two.bin", RandomData(10000, 5));
+    
+    SearchOptions unique = options;
+    unique.include_dirs = {root / "c"};
+    unique.depth = 0;
+    unique.memory_limit = warm - 1;
+    
+    SearchResult result = SearchRun(engine, unique).Execute();
+    
+    EXPECT_EQ(result.status, SearchStatus::Completed);
+    EXPECT_EQ(result.groups, 0u);
+    EXPECT_LT(engine.CacheMemoryUsage(), warm / 2);
+}
+
+TEST_F(SearchTest, WarmCacheIsReusedAndRevalidated) {
+    SearchEngine engine(4096, HashType::MD5);
+    
+    SearchResult first = SearchRun(engine, options).Execute();
+    EXPECT_EQ(first.groups, 2u);
+    EXPECT_GT(first.bytes_hashed, 0u);
+    EXPECT_GT(engine.CacheMemoryUsage(), 0u);
+    
+    // only the file that turned out unique is read again, its digests were not kept
+    SearchResult second = SearchRun(engine, options).Execute();
+    EXPECT_EQ(second.groups, 2u);
+    EXPECT_EQ(second.bytes_hashed, 4096u);
+    
+    // same size, new content and mtime: the old digests must not be used
+    Write("b/one.bin", RandomData(10000, 9));
+    fs::last_write_time(root / "b/one.bin", fs::last_write_time(root / "b/one.bin") + 10);
+    
+    SearchResult third = SearchRun(engine, options).Execute();
+    EXPECT_EQ(third.groups, 1u);
+    EXPECT_GT(third.bytes_hashed, 0u);
+    
+    size_t warm = engine.CacheMemoryUsage();
+    engine.ClearCache();
+    EXPECT_LT(engine.CacheMemoryUsage(), warm / 4);
+}
+
+TEST_F(SearchTest, NeedsADirectory) {
+    SearchEngine engine;
+    EXPECT_THROW(SearchRun(engine, SearchOptions{}).Execute(), std::invalid_argument);
+}
+
+TEST_F(SearchTest, ConcurrentSearchesCountTheirOwnProgress) {
+    SearchOptions only_b = options;
+    only_b.include_dirs = {root / "b"};
+    only_b.depth = 0;
+    
+    auto hashed = [](const SearchOptions& search) {
+        SearchEngine engine;
+        return SearchRun(engine, search).Execute().bytes_hashed;
+    };
+    uint64_t expected_all = hashed(options);
+    uint64_t expected_b = hashed(only_b);
+    ASSERT_NE(expected_all, expected_b);
+    
+    Progress::Reset();
+    for (int round = 0; round < 5; ++round) {
+        uint64_t all = 0;
+        uint64_t b = 0;
+        std::thread first([&]() { all = hashed(options); });
+        std::thread second([&]() { b = hashed(only_b); });
+        first.join();
+        second.join();
+        
+        EXPECT_EQ(all, expected_all);
+        EXPECT_EQ(b, expected_b);
+    }
+    EXPECT_EQ(Progress::Snapshot().bytes_hashed, 0u);
+}
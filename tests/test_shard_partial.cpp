@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include "test_helpers.h"
+#include "shard_partial.h"
+#include "block_cache.h"
+#include "duplicate_finder.h"
+#include "hasher.h"
+#include "scanner.h"
+#include <algorithm>
+#include <set>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+class ShardPartialTest : public TempDirTest {
+protected:
+    void SetUp() override {
+        TempDirTest::SetUp();
+        fs::create_directories(root / "s1");
+        fs::create_directories(root / "s2");
+    }
+    
+    static void WritePartial(const fs::path& dir, const fs::path& file) {
+        Config config;
+        config.include_dirs.push_back(dir);
+        SizeTable table = Scanner(config).ScanTable(false);
+        
+        DuplicateFinder finder(std::make_unique<BlockCache>(4096, std::make_unique<Hasher>(HashType::MD5)));
+        ShardPartial::FromScan(table, finder.Find(table)).Save(file);
+    }
+    
+    // every shard runs in its own process, as it would on its own machine
+    static void RunShards(const std::vector<std::pair<fs::path, fs::path>>& shards, const std::function<void(const fs::path&, const fs::path&)>& run) {
+        std::vector<pid_t> children;
+        for (const auto& [dir, file] : shards) {
+            pid_t pid = fork();
+            ASSERT_GE(pid, 0);
+            if (pid == 0) {
+                try {
+                    run(dir, file);
+                    _exit(0);
+                } catch (...) {
+                    _exit(1);
+                }
+            }
+            children.push_back(pid);
+        }
+        
+        for (pid_t pid : children) {
+            int status = 0;
+            ASSERT_EQ(waitpid(pid, &status, 0), pid);
+            ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        }
+    }
+    
+    static std::vector<std::vector<fs::path>> Sorted(std::vector<std::vector<fs::path>> groups) {
+        for (auto& group : groups) {
+            std::sort(group.begin(), group.end());
+        }
+        std::sort(groups.begin(), groups.end());
+        return groups;
+    }
+};
+
+TEST_F(ShardPartialTest, MergeResolvesCrossShardCandidates) {
+    std::string same = RandomData(100000, 1);
+    auto a = Write("s1/a", same);
+    auto a2 = Write("s1/a2", same);
+    auto b = Write("s2/b", same);
+    
+    std::string y = RandomData(100000, 2);
+    Write("s1/c", y);
+    y[10] ^= 1;
+    Write("s2/d", y);
+    
+    std::string z = RandomData(100000, 3);
+    Write("s1/e", z);
+    z.back() ^= 1;
+    Write("s2/f", z);
+    
+    auto local1 = Write("s2/local1", "only in shard two");
+    auto local2 = Write("s2/local2", "only in shard two");
+    Write("s1/unique", "size seen once");
+    
+    fs::path p1 = root / "s1.bp";
+    fs::path p2 = root / "s2.bp";
+    std::vector<std::pair<fs::path, fs::path>> shards = {{root / "s1", p1}, {root / "s2", p2}};
+    
+    RunShards(shards, WritePartial);
+    
+    std::vector<std::vector<fs::path>> expected = Sorted({{a, a2, b}, {local1, local2}});
+    size_t rounds = 0;
+    
+    while (true) {
+        std::vector<ShardPartial> partials = {ShardPartial::Load(p1), ShardPartial::Load(p2)};
+        MergeResult result = ShardPartial::Merge(partials);
+        
+        if (result.PendingFiles() == 0) {
+            EXPECT_EQ(Sorted(result.duplicates), expected);
+            break;
+        }
+        
+        ASSERT_LT(++rounds, 3u);
+        
+        // one file of the local group a/a2 is hashed, sizes seen in one shard never are
+        std::set<std::string> names;
+        for (size_t i = 0; i < partials.size(); ++i) {
+            for (const auto& item : result.work[i]) {
+                names.insert(partials[i].Entries()[item.entry].file.filename().string().substr(0, 1));
+            }
+            partials[i].SaveWork(fs::path(shards[i].second.string() + ".work"), result.work[i]);
+        }
+        EXPECT_EQ(names.size(), result.PendingFiles());
+        EXPECT_EQ(names.count("l") + names.count("u"), 0u);
+        
+        RunShards(shards, [](const fs::path&, const fs::path& file) {
+            ShardPartial partial = ShardPartial::Load(file);
+            partial.HashWork(ShardPartial::LoadWork(fs::path(file.string() + ".work")), 2);
+            partial.Save(file);
+        });
+    }
+    
+    // prefix round for all six, whole-file round for the four whose prefixes match
+    EXPECT_EQ(rounds, 2u);
+}
+
+TEST_F(ShardPartialTest, HashWorkDropsChangedFiles) {
+    auto a = Write("s1/a", "original");
+    
+    SizeTable table;
+    table.Add(fs::file_size(a), a);
+    table.Finalize(false);
+    ShardPartial partial = ShardPartial::FromScan(table, {});
+    ASSERT_EQ(partial.Entries().size(), 1u);
+    
+    Write("s1/a", "changed content");
+    partial.HashWork({{0, 1}}, 1);
+    
+    EXPECT_TRUE(partial.Entries().empty());
+}
+
+TEST_F(ShardPartialTest, SaveLoadAndWorkListRoundTrip) {
+    auto a = Write("s1/a", RandomData(200000, 4));
+    auto b = Write("s1/b", "b");
+    
+    SizeTable table;
+    table.Add(fs::file_size(a), a);
+    table.Add(fs::file_size(b), b);
+    table.Finalize(false);
+    
+    ShardPartial partial = ShardPartial::FromScan(table, {});
+    partial.HashWork({{1, 2}}, 1);
+    ASSERT_EQ(partial.Entries()[1].digests.size(), 2u);
+    
+    fs::path file = root / "p.bp";
+    partial.Save(file);
+    ShardPartial loaded = ShardPartial::Load(file);
+    
+    ASSERT_EQ(loaded.Entries().size(), 2u);
+    EXPECT_EQ(loaded.Entries()[1].file, a);
+    EXPECT_EQ(loaded.Entries()[1].mtime, partial.Entries()[1].mtime);
+    EXPECT_EQ(loaded.Entries()[1].digests, partial.Entries()[1].digests);
+    
+    loaded.SaveWork(root / "p.work", {{0, 1}, {1, 3}});
+    auto work = ShardPartial::LoadWork(root / "p.work");
+    ASSERT_EQ(work.size(), 2u);
+    EXPECT_EQ(work[1].entry, 1u);
+    EXPECT_EQ(work[1].levels, 3u);
+    
+    EXPECT_THROW(ShardPartial::Load(root / "p.work"), std::runtime_error);
+}
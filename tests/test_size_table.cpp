@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "size_table.h"
+
+TEST(SizeTableTest, GroupsAreSortedBySize) {
+    SizeTable table;
+    table.Add(300, "/c");
+    table.Add(100, "/a");
+    table.Add(300, "/d");
+    table.Add(100, "/b");
+    table.Finalize(false);
+    
+    auto groups = table.Groups();
+    ASSERT_EQ(groups.size(), 2u);
+    EXPECT_EQ(groups[0].size, 100u);
+    EXPECT_EQ(table.GroupFiles(groups[0]), (std::vector<boost::filesystem::path>{"/a", "/b"}));
+    EXPECT_EQ(groups[1].size, 300u);
+    EXPECT_EQ(table.GroupFiles(groups[1]), (std::vector<boost::filesystem::path>{"/c", "/d"}));
+}
+
+TEST(SizeTableTest, DropSingletonsFreesTheirPaths) {
+    SizeTable table;
+    table.Add(1, "/unique1");
+    table.Add(5, "/x");
+    table.Add(2, "/unique2");
+    table.Add(5, "/y");
+    table.Add(5, "/z");
+    table.Finalize(true);
+    
+    EXPECT_EQ(table.FileCount(), 3u);
+    auto groups = table.Groups();
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[0].size, 5u);
+    
+    const auto& records = table.Records();
+    for (size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(records[i].file, i);
+    }
+    EXPECT_EQ(table.File(0), "/x");
+    EXPECT_EQ(table.File(2), "/z");
+}
+
+TEST(SizeTableTest, RepeatedPathsAreKeptOnce) {
+    SizeTable table;
+    table.Add(10, "/a");
+    table.Add(10, "/a");
+    table.Add(20, "/b");
+    table.Add(20, "/c");
+    table.Add(20, "/b");
+    table.Finalize(true);
+    
+    auto map = table.ToMap();
+    EXPECT_EQ(map.count(10), 0u);
+    ASSERT_EQ(map.count(20), 1u);
+    EXPECT_EQ(map[20], (std::vector<boost::filesystem::path>{"/b", "/c"}));
+}
+
+TEST(SizeTableTest, KeepSingletonsInMap) {
+    SizeTable table;
+    table.Add(10, "/a");
+    table.Add(10, "/a");
+    table.Add(20, "/b");
+    table.Finalize(false);
+    
+    auto map = table.ToMap();
+    ASSERT_EQ(map.size(), 2u);
+    EXPECT_EQ(map[10], (std::vector<boost::filesystem::path>{"/a"}));
+    EXPECT_EQ(map[20], (std::vector<boost::filesystem::path>{"/b"}));
+}
+
+TEST(SizeTableTest, EmptyTable) {
+    SizeTable table;
+    table.Finalize(true);
+    
+    EXPECT_TRUE(table.Groups().empty());
+    EXPECT_TRUE(table.ToMap().empty());
+    EXPECT_THROW(table.File(0), std::out_of_range);
+}
+
+TEST(SizeTableTest, FilesAddedByDirectory) {
+    SizeTable table;
+    uint32_t root = table.AddDirectory(PathTree::kRoot, "/data");
+    uint32_t photos = table.AddDirectory(root, "photos");
+    uint32_t docs = table.AddDirectory(root, "docs");
+    table.Add(7, photos, "a.jpg");
+    table.Add(3, root, "lonely.txt");
+    table.Add(7, photos, "b.jpg");
+    table.Add(7, docs, "c.txt");
+    table.Finalize(true);
+    
+    auto groups = table.Groups();
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(table.GroupFiles(groups[0]), (std::vector<boost::filesystem::path>{
+        "/data/photos/a.jpg", "/data/photos/b.jpg", "/data/docs/c.txt"}));
+    EXPECT_EQ(table.Files().size(), 3u);
+}
+
+TEST(SizeTableTest, RepeatedPathsFromDifferentRoots) {
+    SizeTable table;
+    uint32_t outer = table.AddDirectory(PathTree::kRoot, "/a");
+    uint32_t inner = table.AddDirectory(PathTree::kRoot, "/a/b");
+    table.Add(5, table.AddDirectory(outer, "b"), "f");
+    table.Add(5, inner, "f");
+    table.Add(5, inner, "g");
+    table.Finalize(true);
+    
+    EXPECT_EQ(table.FileCount(), 2u);
+    EXPECT_EQ(table.File(0), "/a/b/f");
+    EXPECT_EQ(table.File(1), "/a/b/g");
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "stats.h"
+#include <sstream>
+#include <thread>
+#include <vector>
+
+class StatsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Stats::Reset();
+    }
+    
+    void TearDown() override {
+        Stats::Reset();
+    }
+};
+
+TEST_F(StatsTest, AddAggregatesThreads) {
+    Stats::Add(Counter::BlocksRead, 3);
+    
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 1000; ++i) {
+                Stats::Add(Counter::BlocksRead);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    EXPECT_EQ(Stats::Snapshot().Get(Counter::BlocksRead), 4003);
+}
+
+TEST_F(StatsTest, PeakKeepsMaximum) {
+    Stats::Peak(Counter::OpenFilesPeak, 5);
+    Stats::Peak(Counter::OpenFilesPeak, 2);
+    
+    std::thread other([]() { Stats::Peak(Counter::OpenFilesPeak, 7); });
+    other.join();
+    
+    EXPECT_EQ(Stats::Snapshot().Get(Counter::OpenFilesPeak), 7);
+}
+
+TEST_F(StatsTest, SizeGroupHistogram) {
+    Stats::RecordSizeGroup(2);
+    Stats::RecordSizeGroup(2);
+    Stats::RecordSizeGroup(3);
+    Stats::RecordSizeGroup(100);
+    
+    StatsSnapshot snapshot = Stats::Snapshot();
+    
+    EXPECT_EQ(snapshot.size_groups, 4);
+    EXPECT_EQ(snapshot.group_histogram[2], 2);
+    EXPECT_EQ(snapshot.group_histogram[4], 1);
+    EXPECT_EQ(snapshot.group_histogram[128], 1);
+}
+
+TEST_F(StatsTest, PhasesAndJson) {
+    {
+        ScopedPhase phase("scan");
+    }
+    
+    StatsSnapshot snapshot = Stats::Snapshot();
+    ASSERT_EQ(snapshot.phases.size(), 1);
+    EXPECT_EQ(snapshot.phases[0].name, "scan");
+    EXPECT_GE(snapshot.phases[0].wall_seconds, 0.0);
+    
+    std::ostringstream json;
+    Stats::PrintJson(json, snapshot);
+    EXPECT_NE(json.str().find("\"blocks_read\":0"), std::string::npos);
+    EXPECT_NE(json.str().find("\"name\":\"scan\""), std::string::npos);
+}
@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "trace.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace fs = boost::filesystem;
+
+TEST(TraceTest, DisabledRecordsNothing) {
+    Trace::Stop();
+    TraceSpan span("never");
+    EXPECT_FALSE(Trace::Enabled());
+}
+
+TEST(TraceTest, WritesChromeJson) {
+    fs::path output = fs::temp_directory_path() / "bayan_trace_test.json";
+    
+    Trace::Start();
+    {
+        TraceSpan span("main_span");
+        std::thread worker([]() { TraceSpan span("worker_span"); });
+        worker.join();
+    }
+    Trace::Stop();
+    
+    Trace::WriteChromeJson(output.string());
+    
+    std::ifstream in(output.string());
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string json = buffer.str();
+    
+    fs::remove(output);
+    
+    EXPECT_EQ(json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0);
+    EXPECT_NE(json.find("\"name\":\"main_span\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"worker_span\",\"ph\":\"X\""), std::string::npos);
+}
+
+TEST(TraceTest, WriteToInvalidPath) {
+    EXPECT_THROW(Trace::WriteChromeJson("/nonexistent_dir/trace.json"), std::runtime_error);
+}
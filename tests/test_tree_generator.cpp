@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "tree_generator.h"
+#include "block_cache.h"
+#include "duplicate_finder.h"
+#include "hasher.h"
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sys/stat.h>
+
+namespace fs = boost::filesystem;
+
+class TreeGeneratorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        root = fs::temp_directory_path() / "tree_generator_test";
+        fs::remove_all(root);
+    }
+    
+    void TearDown() override {
+        fs::remove_all(root);
+    }
+    
+    static std::map<std::string, std::string> ReadTree(const fs::path& dir) {
+        std::map<std::string, std::string> contents;
+        for (fs::recursive_directory_iterator it(dir), end; it != end; ++it) {
+            if (fs::is_regular_file(it->path())) {
+                std::ifstream in(it->path().string(), std::ios::binary);
+                contents[fs::relative(it->path(), dir).string()] =
+                    std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            }
+        }
+        return contents;
+    }
+    
+    fs::path root;
+};
+
+TEST_F(TreeGeneratorTest, SameSeedSameTree) {
+    TreeSpec spec;
+    spec.files = 50;
+    spec.depth = 2;
+    spec.fanout = 3;
+    spec.sizes = SizeDistribution::Parse("uniform:0:20K");
+    spec.seed = 42;
+    
+    TreeGenerator(spec).Generate(root / "a");
+    TreeGenerator(spec).Generate(root / "b");
+    
+    auto a = ReadTree(root / "a");
+    auto b = ReadTree(root / "b");
+    EXPECT_EQ(a.size(), 50u);
+    EXPECT_EQ(a, b);
+    
+    spec.seed = 43;
+    TreeGenerator(spec).Generate(root / "c");
+    EXPECT_NE(a, ReadTree(root / "c"));
+}
+
+TEST_F(TreeGeneratorTest, CreatesDirectoryLevels) {
+    TreeSpec spec;
+    spec.files = 1;
+    spec.depth = 2;
+    spec.fanout = 3;
+    
+    GeneratedTree tree = TreeGenerator(spec).Generate(root);
+    
+    EXPECT_EQ(tree.directories, 1u + 3u + 9u);
+    EXPECT_TRUE(fs::is_directory(root / "d2" / "d1"));
+}
+
+TEST_F(TreeGeneratorTest, DuplicatesAreFound) {
+    TreeSpec spec;
+    spec.files = 40;
+    spec.depth = 1;
+    spec.sizes = SizeDistribution::Parse("fixed:10K");
+    spec.duplicate_ratio = 0.5;
+    spec.near_duplicate_ratio = 0.5;
+    
+    GeneratedTree tree = TreeGenerator(spec).Generate(root);
+    ASSERT_GT(tree.duplicates, 0u);
+    ASSERT_GT(tree.near_duplicates, 0u);
+    
+    std::vector<fs::path> files;
+    for (fs::recursive_directory_iterator it(root), end; it != end; ++it) {
+        if (fs::is_regular_file(it->path())) {
+            files.push_back(it->path());
+        }
+    }
+    std::map<uintmax_t, std::vector<fs::path>> groups{{10240, files}};
+    
+    DuplicateFinder finder(std::make_unique<BlockCache>(4096, std::make_unique<Hasher>(HashType::MD5)));
+    size_t in_groups = 0;
+    size_t group_count = 0;
+    for (const auto& group : finder.Find(groups)) {
+        in_groups += group.size();
+        ++group_count;
+    }
+    
+    // every duplicate joins the group of its original, near-duplicates stay unique
+    EXPECT_EQ(in_groups - group_count, tree.duplicates);
+}
+
+TEST_F(TreeGeneratorTest, HardlinksShareInode) {
+    TreeSpec spec;
+    spec.files = 20;
+    spec.depth = 0;
+    spec.sizes = SizeDistribution::Parse("fixed:1K");
+    spec.duplicate_ratio = 0;
+    spec.near_duplicate_ratio = 0;
+    spec.hardlink_ratio = 0.5;
+    
+    GeneratedTree tree = TreeGenerator(spec).Generate(root);
+    ASSERT_GT(tree.hardlinks, 0u);
+    
+    size_t linked = 0;
+    for (fs::directory_iterator it(root), end; it != end; ++it) {
+        if (fs::hard_link_count(it->path()) > 1) {
+            ++linked;
+        }
+    }
+    EXPECT_GT(linked, tree.hardlinks);
+}
+
+TEST_F(TreeGeneratorTest, SparseFilesHaveHoles) {
+    TreeSpec spec;
+    spec.files = 3;
+    spec.depth = 0;
+    spec.sizes = SizeDistribution::Parse("fixed:4M");
+    spec.duplicate_ratio = 0;
+    spec.near_duplicate_ratio = 0;
+    spec.sparse_ratio = 1;
+    
+    GeneratedTree tree = TreeGenerator(spec).Generate(root);
+    EXPECT_EQ(tree.sparse, 3u);
+    
+    for (fs::directory_iterator it(root), end; it != end; ++it) {
+        struct stat st{};
+        ASSERT_EQ(::stat(it->path().c_str(), &st), 0);
+        EXPECT_EQ(st.st_size, 4 << 20);
+        EXPECT_LT(static_cast<uintmax_t>(st.st_blocks) * 512, uintmax_t{4} << 20);
+    }
+}
+
+TEST_F(TreeGeneratorTest, ParseSizeDistribution) {
+    auto fixed = SizeDistribution::Parse("fixed:4K");
+    EXPECT_EQ(fixed.kind, SizeDistribution::Kind::Fixed);
+    EXPECT_EQ(fixed.min, 4096u);
+    
+    auto uniform = SizeDistribution::Parse("Uniform:1:2M");
+    EXPECT_EQ(uniform.kind, SizeDistribution::Kind::Uniform);
+    EXPECT_EQ(uniform.max, 2u << 20);
+    
+    auto lognormal = SizeDistribution::Parse("lognormal:10:1.5:1G");
+    EXPECT_EQ(lognormal.kind, SizeDistribution::Kind::LogNormal);
+    EXPECT_DOUBLE_EQ(lognormal.sigma, 1.5);
+    EXPECT_EQ(lognormal.max, 1u << 30);
+    
+    EXPECT_THROW(SizeDistribution::Parse("normal:1:2"), std::invalid_argument);
+    EXPECT_THROW(SizeDistribution::Parse("uniform:2M:1K"), std::invalid_argument);
+    EXPECT_THROW(SizeDistribution::Parse("fixed:4X"), std::invalid_argument);
+}
+
+TEST_F(TreeGeneratorTest, RejectsInvalidRatios) {
+    TreeSpec spec;
+    spec.duplicate_ratio = 0.7;
+    spec.near_duplicate_ratio = 0.5;
+    EXPECT_THROW(TreeGenerator generator(spec), std::invalid_argument);
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "hasher.h"
+#include "stats.h"
+#include "tree_hash.h"
+
+namespace
+{
+    std::string Hex(const TreeHash::Node& node)
+    {
+        static const char* hex = "0123456789abcdef";
+        std::string result;
+        for (uint8_t byte : node) {
+            result += hex[byte >> 4];
+            result += hex[byte & 0x0F];
+        }
+        return result;
+    }
+    
+    std::string Pattern(size_t size)
+    {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>(i * 131 + 7);
+        }
+        return data;
+    }
+}
+
+TEST(TreeHashTest, KnownRoots) {
+    std::string data = Pattern(5000);
+    
+    // SHA-256(0x00 || chunk) leaves and SHA-256(0x01 || left || right) parents
+    EXPECT_EQ(Hex(TreeHash::Hash("", 0)), "6e340b9cffb37a989ca544e6bb780a2c78901d3fb33738768511a30617afa01d");
+    EXPECT_EQ(Hex(TreeHash::Hash("abc", 3)), "609f6e36d2405585188d5cfd761f407c7cc46a7d3f314c88270469dde315fcd1");
+    EXPECT_EQ(Hex(TreeHash::Hash(data.data(), data.size())), "211f69b18dc7533572671bd749258bbb36a7f21b1d4ffb101052fae2891c631f");
+}
+
+TEST(TreeHashTest, ThreadsGiveTheSameRoot) {
+    for (size_t size : {TreeHash::kParallelMin, TreeHash::kParallelMin + 1, 3 * TreeHash::kParallelMin + 777}) {
+        std::string data = Pattern(size);
+        auto expected = TreeHash::Hash(data.data(), data.size(), 1);
+        
+        for (size_t threads : {2, 3, 8}) {
+            EXPECT_EQ(TreeHash::Hash(data.data(), data.size(), threads), expected) << size << " " << threads;
+        }
+    }
+}
+
+TEST(TreeHashTest, CombineJoinsAlignedRuns) {
+    std::string data = Pattern(11 * 4096 + 100);
+    
+    std::vector<TreeHash::Node> runs;
+    for (size_t begin = 0; begin < data.size(); begin += 4096) {
+        runs.push_back(TreeHash::Hash(data.data() + begin, std::min<size_t>(4096, data.size() - begin)));
+    }
+    
+    EXPECT_EQ(TreeHash::Combine(runs), TreeHash::Hash(data.data(), data.size()));
+}
+
+TEST(TreeHashTest, HasherFileDigestIsTreeOfBlocks) {
+    Hasher hasher(HashType::SHA256Tree, 4);
+    std::string data = Pattern(5 * 4096);
+    
+    std::vector<std::string> blocks;
+    for (size_t begin = 0; begin < data.size(); begin += 4096) {
+        blocks.push_back(hasher.HashBlock(data.data() + begin, 4096));
+    }
+    
+    EXPECT_EQ(blocks[0].size(), 64u);
+    EXPECT_EQ(hasher.HashDigests(blocks), Hex(TreeHash::Hash(data.data(), data.size())));
+    EXPECT_THROW(hasher.HashDigests({"abc"}), std::invalid_argument);
+}
+
+TEST(TreeHashTest, BatchedBlocksMatchSingleBlocks) {
+    Hasher hasher(HashType::SHA256Tree, 4);
+    std::string data = Pattern(3 * TreeHash::kParallelMin);
+    
+    std::vector<BlockView> views;
+    for (size_t begin = 0; begin < data.size(); begin += TreeHash::kParallelMin) {
+        views.push_back({data.data() + begin, TreeHash::kParallelMin});
+    }
+    std::vector<std::string> digests(views.size());
+    hasher.HashBlocks(views.data(), views.size(), digests.data());
+    
+    for (size_t i = 0; i < views.size(); ++i) {
+        EXPECT_EQ(digests[i], hasher.HashBlock(views[i].data, views[i].size));
+    }
+}
+
+TEST(TreeHashTest, BatchOfOneBlockUsesSpareThreads) {
+    Hasher hasher(HashType::SHA256Tree, 4);
+    std::string data = Pattern(2 * TreeHash::kParallelMin + 100);
+    BlockView view{data.data(), data.size()};
+    std::string digest;
+    
+    Stats::Reset();
+    hasher.HashBlocks(&view, 1, &digest, 1);
+    EXPECT_EQ(Stats::Snapshot().Get(Counter::BlocksSplit), 0u);
+    
+    hasher.HashBlocks(&view, 1, &digest, 4);
+    EXPECT_EQ(Stats::Snapshot().Get(Counter::BlocksSplit), 1u);
+    EXPECT_EQ(digest, Hex(TreeHash::Hash(data.data(), data.size())));
+}
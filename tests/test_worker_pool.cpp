@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include "progress.h"
+#include "worker_pool.h"
+
+TEST(WorkerPoolTest, RunsEveryWorker) {
+    WorkerPool pool(4);
+    std::atomic<size_t> mask{0};
+
+    pool.Start(3, [&mask](size_t worker) {
+        mask |= size_t{1} << worker;
+    });
+    pool.Wait();
+
+    EXPECT_EQ(mask.load(), 7u);
+}
+
+TEST(WorkerPoolTest, ThreadsAreKeptAcrossJobs) {
+    WorkerPool pool(2);
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+
+    for (int job = 0; job < 50; ++job) {
+        pool.Start(job % 2 + 1, [&](size_t) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ids.insert(std::this_thread::get_id());
+        });
+        pool.Wait();
+    }
+
+    EXPECT_EQ(ids.size(), 2u);
+    EXPECT_EQ(ids.count(std::this_thread::get_id()), 0u);
+}
+
+TEST(WorkerPoolTest, WaitRethrowsAndPoolStaysUsable) {
+    WorkerPool pool(2);
+
+    pool.Start(2, [](size_t worker) {
+        if (worker == 1) {
+            throw std::runtime_error("worker failed");
+        }
+    });
+    EXPECT_THROW(pool.Wait(), std::runtime_error);
+
+    std::atomic<int> runs{0};
+    pool.Start(2, [&runs](size_t) { ++runs; });
+    EXPECT_NO_THROW(pool.Wait());
+    EXPECT_EQ(runs.load(), 2);
+}
+
+TEST(WorkerPoolTest, WorkersAddToTheCallersProgress) {
+    ProgressCounters counters;
+    WorkerPool pool(3);
+
+    {
+        ScopedProgress scope(counters);
+        pool.Start(3, [](size_t) { Progress::AddBytesHashed(10); });
+        pool.Wait();
+    }
+
+    EXPECT_EQ(counters.Snapshot().bytes_hashed, 30u);
+}
+
+TEST(WorkerPoolTest, InvalidWorkerCount) {
+    EXPECT_THROW(WorkerPool(0), std::invalid_argument);
+
+    WorkerPool pool(2);
+    EXPECT_THROW(pool.Start(0, [](size_t) {}), std::invalid_argument);
+    EXPECT_THROW(pool.Start(3, [](size_t) {}), std::invalid_argument);
+}
@@ -0,0 +1,61 @@
+#include <boost/program_options.hpp>
+#include <iostream>
+#include "tree_generator.h"
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[])
+{
+    try {
+        TreeSpec spec;
+        std::string sizes;
+        std::string output;
+        
+        po::options_description desc("Generates a reproducible directory tree for bayan benchmarks");
+        desc.add_options()
+            ("help,h", "show help")
+            ("output,o", po::value<std::string>(&output)->required(), "root directory of the tree")
+            ("files,n", po::value<size_t>(&spec.files)->default_value(spec.files), "number of files")
+            ("depth,d", po::value<size_t>(&spec.depth)->default_value(spec.depth), "directory depth")
+            ("fanout,f", po::value<size_t>(&spec.fanout)->default_value(spec.fanout), "subdirectories per directory")
+            ("sizes", po::value<std::string>(&sizes)->default_value("uniform:1K:1M"),
+             "size distribution: fixed:SIZE, uniform:MIN:MAX or lognormal:MU:SIGMA[:MAX]")
+            ("duplicates", po::value<double>(&spec.duplicate_ratio)->default_value(spec.duplicate_ratio),
+             "share of files that copy an earlier file")
+            ("near-duplicates", po::value<double>(&spec.near_duplicate_ratio)->default_value(spec.near_duplicate_ratio),
+             "share of files with the size and prefix of an earlier file but a different byte in the second half")
+            ("hardlinks", po::value<double>(&spec.hardlink_ratio)->default_value(spec.hardlink_ratio),
+             "share of files that are hard links to an earlier file")
+            ("sparse", po::value<double>(&spec.sparse_ratio)->default_value(spec.sparse_ratio),
+             "share of unique files written with a hole between the first and the last 4 KiB")
+            ("seed", po::value<uint64_t>(&spec.seed)->default_value(spec.seed), "random seed")
+        ;
+        
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        
+        if (vm.count("help")) {
+            std::cout << desc << "\n";
+            return 0;
+        }
+        
+        po::notify(vm);
+        spec.sizes = SizeDistribution::Parse(sizes);
+        
+        TreeGenerator generator(spec);
+        GeneratedTree tree = generator.Generate(output);
+        
+        std::cout << "directories: " << tree.directories << "\n"
+                  << "files: " << tree.files << "\n"
+                  << "duplicates: " << tree.duplicates << "\n"
+                  << "near duplicates: " << tree.near_duplicates << "\n"
+                  << "hard links: " << tree.hardlinks << "\n"
+                  << "sparse: " << tree.sparse << "\n"
+                  << "bytes: " << tree.bytes << "\n";
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}